@@ -109,15 +109,17 @@ The echo command is simply an alias to cut.
 .SS "Numeric Grouping operations"
 
 .TP "\w'\fBcountunique\fR'u+1n"
-.B sum
-sum the of values
+.B sum[:int]
+sum the of values. With \fB:int\fR, the values must be 64-bit integers
+(\-9223372036854775808 to 9223372036854775807), and the exact integer
+result is printed.
 
 .TP
-.B min
+.B min[:int]
 minimum value
 
 .TP
-.B max
+.B max[:int]
 maximum value
 
 .TP
@@ -163,6 +165,29 @@ comma-separated list of all input values
 .TP
 .B countunique
 number of unique/distinct values
+
+.TP
+.B approxcountunique[:PRECISION]
+approximate number of unique/distinct values, estimated with a HyperLogLog
+sketch of 2^\fBPRECISION\fR bytes per group (4 to 18, defaults to 14).
+The relative standard error is about 1.04/sqrt(2^\fBPRECISION\fR).
+
+.TP
+.B topk[:K]
+comma-separated list of the \fBK\fR most common values (defaults to 10),
+as value:count pairs by decreasing count
+
+.TP
+.B approxtopk[:K[:C]]
+approximate \fBK\fR most common values, as \fBtopk\fR, counting at most
+\fBC\fR distinct values per group (defaults to the larger of 100 and
+10*\fBK\fR).  The counts are low by at most 2/\fBC\fR of the number of
+values.
+
+.TP
+.B sample[:K]
+comma-separated list of \fBK\fR random values from the group
+(defaults to 10), picked without replacement
 .PP
 
 
@@ -219,6 +244,17 @@ inter-quartile range
 .B perc[:PERCENTILE]
 percentile value \fBPERCENTILE\fR (defaults to 95).
 
+.TP
+.B approxperc[:PERCENTILE[:COMPRESSION]]
+approximate percentile value \fBPERCENTILE\fR (defaults to 95), estimated
+with a t-digest of about \fBCOMPRESSION\fR centroids (defaults to 100),
+in a bounded amount of memory.  Exact for groups of up to
+2*\fBCOMPRESSION\fR values.
+
+.TP
+.B approxmedian[:COMPRESSION]
+approximate median value (as \fBapproxperc:50\fR)
+
 .TP
 .B mode
 mode value (most common value)
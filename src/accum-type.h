@@ -0,0 +1,68 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ACCUM_TYPE_H__
+#define __ACCUM_TYPE_H__
+
+/*
+ The floating-point type of parsed input values, of the running
+ accumulators (sum, mean, moments) and of the values stored by
+ multi-valued operations (median, percentile, mode...).
+
+ 'long double' by default. With './configure --with-precision-type=double'
+ it is 'double': multi-valued operations use half the memory (8 instead
+ of 16 bytes per value on x86-64), and the arithmetic uses SSE instead
+ of the x87 FPU, at the cost of precision (about 15 instead of 18
+ significant digits).
+
+ Final results (computed once per group) are still returned and printed
+ as 'long double'.
+ */
+#ifdef ACCUM_DOUBLE
+
+typedef double accum_t;
+
+# define ACCUM_MANT_DIG DBL_MANT_DIG
+
+# define accum_fabs  fabs
+# define accum_floor floor
+# define accum_ceil  ceil
+# define accum_round round
+# define accum_modf  modf
+# define accum_log   log
+# define accum_strto strtod
+
+#else
+
+typedef long double accum_t;
+
+# define ACCUM_MANT_DIG LDBL_MANT_DIG
+
+# define accum_fabs  fabsl
+# define accum_floor floorl
+# define accum_ceil  ceill
+# define accum_round roundl
+# define accum_modf  modfl
+# define accum_log   logl
+# define accum_strto strtold
+
+#endif
+
+#endif /* __ACCUM_TYPE_H__ */
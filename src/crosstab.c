@@ -32,8 +32,10 @@
 
 #include "system.h"
 #include "crosstab.h"
+#include "accum-type.h"
 #include "utils.h"
 #include "text-options.h"
+#include "output-buffer.h"
 
 
 static bool _GL_ATTRIBUTE_PURE
@@ -165,14 +167,14 @@ crosstab_print (const struct crosstab* ct)
   for (size_t c = 0; c < n_cols; ++c)
     {
       print_field_separator ();
-      fputs (cols_list[c], stdout);
+      output_str (cols_list[c]);
     }
   print_line_separator ();
 
   /* Print rows */
   for (size_t r = 0; r < n_rows; ++r)
     {
-      fputs (rows_list[r], stdout);
+      output_str (rows_list[r]);
 
       for (size_t c = 0; c < n_cols; ++c)
         {
@@ -182,7 +184,7 @@ crosstab_print (const struct crosstab* ct)
 
           const struct crosstab_datacell *dc = hash_lookup (ct->data, &curr);
           print_field_separator ();
-          fputs ((dc==NULL)?missing_field_filler:dc->data, stdout);
+          output_str ((dc==NULL)?missing_field_filler:dc->data);
         }
 
       print_line_separator ();
@@ -50,16 +50,28 @@
 #include "version-etc.h"
 #include "xalloc.h"
 #include "sh-quote.h"
+#include "xstrtol.h"
 
 #include "text-options.h"
+#include "output-buffer.h"
 #include "text-lines.h"
+#include "input-map.h"
+#include "input-threads.h"
 #include "column-headers.h"
 #include "op-defs.h"
 #include "op-parser.h"
+#include "accum-type.h"
 #include "utils.h"
+#include "tdigest.h"
+#include "hyperloglog.h"
+#include "value-counts.h"
 #include "randutils.h"
 #include "field-ops.h"
+#include "number-parser.h"
+#include "number-format.h"
 #include "crosstab.h"
+#include "group-table.h"
+#include "group-spill.h"
 
 /* The official name of this program (e.g., no 'g' prefix).  */
 #define PROGRAM_NAME "datamash"
@@ -98,6 +110,37 @@ static struct crosstab* crosstab = NULL;
 static bool pipe_through_sort = false;
 static FILE* input_stream = NULL;
 
+/* If TRUE, group unsorted input in memory (instead of piping it
+   through sort) */
+static bool hash_grouping = false;
+
+/* The memory limit without --memory-limit: grouping in memory should
+   not use much more memory than piping the input through sort */
+#define DEFAULT_MEMORY_LIMIT (32 * 1024 * 1024)
+
+/* With in-memory grouping, the maximum memory (in bytes) to use for the
+   groups before spilling lines to temporary files (--memory-limit) */
+static size_t memory_limit = DEFAULT_MEMORY_LIMIT;
+
+/* If TRUE, the memory limit was given with --memory-limit */
+static bool explicit_memory_limit = false;
+
+/* With --threads=N (N > 1), the input lines are read and split into
+   fields in background threads (N-1 workers and a reader thread) */
+static size_t num_threads = 1;
+
+/* If TRUE, the worker threads also collect the groups of their chunks of
+   the input, merged by the main thread (see group_unsorted_chunks) */
+static bool group_in_threads = false;
+
+/* If TRUE (--keep-order), print groups in the order they first appear
+   in the input, instead of sorted by key */
+static bool keep_order = false;
+
+/* If TRUE (--merge-partial), the input lines are the keys and partial
+   results printed with --emit-partial (see field_op_emit_partial) */
+static bool merge_partial = false;
+
 /* Use large buffer for normal operation (will be reduced for testing) */
 static size_t rmdup_initial_size = (1024*1024);
 
@@ -107,6 +150,9 @@ static int explicit_output_delimiter = -1;
 /* Path to default sort program */
 static const char *sort_cmd = SORT_PATH;
 
+/* TRUE if --sort-cmd was given: --sort then uses the external program */
+static bool explicit_sort_cmd = false;
+
 enum
 {
   INPUT_HEADER_OPTION = CHAR_MAX + 1,
@@ -116,6 +162,11 @@ enum
   OUTPUT_DELIMITER_OPTION,
   CUSTOM_FORMAT_OPTION,
   SORT_PROGRAM_OPTION,
+  KEEP_ORDER_OPTION,
+  MEMORY_LIMIT_OPTION,
+  THREADS_OPTION,
+  EMIT_PARTIAL_OPTION,
+  MERGE_PARTIAL_OPTION,
   VNLOG_OPTION,
   UNDOC_PRINT_INF_OPTION,
   UNDOC_PRINT_NAN_OPTION,
@@ -148,6 +199,11 @@ static struct option const long_options[] =
   {"narm", no_argument, NULL, REMOVE_NA_VALUES_OPTION},
   {"round", required_argument, NULL, 'R'},
   {"sort-cmd", required_argument, NULL, SORT_PROGRAM_OPTION},
+  {"keep-order", no_argument, NULL, KEEP_ORDER_OPTION},
+  {"memory-limit", required_argument, NULL, MEMORY_LIMIT_OPTION},
+  {"threads", required_argument, NULL, THREADS_OPTION},
+  {"emit-partial", no_argument, NULL, EMIT_PARTIAL_OPTION},
+  {"merge-partial", no_argument, NULL, MERGE_PARTIAL_OPTION},
   {GETOPT_HELP_OPTION_DECL},
   {GETOPT_VERSION_OPTION_DECL},
   /* Undocumented options */
@@ -217,15 +273,15 @@ which require a pair of fields (e.g. 'pcov 2:6').\n"), stdout);
       fputs ("  sum, min, max, absmin, absmax, range\n",stdout);
 
       fputs (_("Textual/Numeric Grouping operations:\n"),stdout);
-      fputs ("  count, first, last, rand, unique, collapse, countunique\n",
-             stdout);
+      fputs ("  count, first, last, rand, unique, collapse, countunique,\n"
+             "  approxcountunique, topk, approxtopk, sample\n", stdout);
 
       fputs (_("Statistical Grouping operations:\n"),stdout);
       fputs ("\
   mean, geomean, harmmean, trimmean, median, q1, q3, iqr, perc,\n\
   mode, antimode, pstdev, sstdev, pvar, svar, ms, rms, mad, madraw,\n\
   pskew, sskew, pkurt, skurt, dpo, jarque,\n\
-  scov, pcov, spearson, ppearson, dotprod\n\
+  scov, pcov, spearson, ppearson, dotprod, approxmedian, approxperc\n\
 \n", stdout);
       fputs ("\n", stdout);
 
@@ -266,8 +322,35 @@ which require a pair of fields (e.g. 'pcov 2:6').\n"), stdout);
                               this affects grouping, and string operations\n\
 "), stdout);
       fputs (_("\
-  -s, --sort                sort the input before grouping; this removes the\n\
-                              need to manually pipe the input through 'sort'\n\
+  -s, --sort                group unsorted input, printing the groups sorted\n\
+                              by key; this removes the need to manually\n\
+                              pipe the input through 'sort'\n\
+"), stdout);
+      fputs (_("\
+      --keep-order          like --sort, but print the groups in the order\n\
+                              they first appear in the input\n\
+"), stdout);
+      fputs (_("\
+      --memory-limit=SIZE   with --sort/--keep-order, use at most about SIZE\n\
+                              bytes of memory for the groups (default 32M),\n\
+                              and temporary files for the rest\n\
+                              (suffixes K,M,G)\n\
+"), stdout);
+      fputs (_("\
+      --threads=N           read and split the input lines in N-1 background\n\
+                              threads (plus a reading thread) while the\n\
+                              operations run; with -s, --keep-order or no\n\
+                              grouping, also group and compute in them\n\
+                              (default 1: no threads)\n\
+"), stdout);
+      fputs (_("\
+      --emit-partial        print the exact internal state of the operations\n\
+                              of each group instead of their results\n\
+"), stdout);
+      fputs (_("\
+      --merge-partial       read the output of --emit-partial (e.g. of parts\n\
+                              of the input) and print the combined results\n\
+                              of the same operations\n\
 "), stdout);
       fputs (_("\
   -S, --seed                set a seed for operations that use randomization\n\
@@ -312,7 +395,8 @@ which require a pair of fields (e.g. 'pcov 2:6').\n"), stdout);
   -z, --zero-terminated     end lines with 0 byte, not newline\n\
 "), stdout);
       fputs (_("\
-      --sort-cmd=/path/to/sort   Alternative sort(1) to use.\n\
+      --sort-cmd=/path/to/sort   with --sort, pipe the input through this\n\
+                              sort(1) program instead of grouping in memory\n\
 "), stdout);
 
       fputs (HELP_OPTION_DESCRIPTION, stdout);
@@ -402,10 +486,20 @@ different (const struct line_record_t* l1, const struct line_record_t* l2)
   return false;
 }
 
+/* Collect a field of an input line into 'op'.  With --merge-partial,
+   the field is a partial result of the op. */
+static inline enum FIELD_OP_COLLECT_RESULT
+collect_field (struct fieldop *op, const char *str, size_t len)
+{
+  if (merge_partial)
+    return field_op_load_partial (op, str, len);
+  return field_op_collect (op, str, len);
+}
+
 /* For a given line, extract all requested fields and process the associated
-   operations on them */
+   operations ('ops', with dm->num_ops elements) on them */
 static bool
-process_line (const struct line_record_t *line)
+process_line (const struct line_record_t *line, struct fieldop *ops)
 {
   const char *str = NULL;
   size_t len = 0;
@@ -414,9 +508,9 @@ process_line (const struct line_record_t *line)
 
   for (size_t i=0; i<dm->num_ops; ++i)
     {
-      struct fieldop *op = &dm->ops[i];
+      struct fieldop *op = &ops[i];
       safe_line_record_get_field (line, op->field, &str, &len);
-      flocr = field_op_collect (op, str, len);
+      flocr = collect_field (op, str, len);
       if (!field_op_ok (flocr))
         {
           char *tmp = xmalloc (len+1);
@@ -446,7 +540,7 @@ print_input_line (const struct line_record_t* lb)
       for (size_t i = 1; i <= line_record_num_fields (lb); ++i)
         {
           safe_line_record_get_field (lb, i, &str, &len);
-          ignore_value (fwrite (str, sizeof (char), len, stdout));
+          output_write (str, len);
           print_field_separator ();
         }
     }
@@ -456,7 +550,7 @@ print_input_line (const struct line_record_t* lb)
         {
           const size_t col_num = dm->grps[i].num;
           safe_line_record_get_field (lb, col_num, &str, &len);
-          ignore_value (fwrite (str,sizeof (char),len,stdout));
+          output_write (str, len);
           print_field_separator ();
         }
     }
@@ -477,14 +571,28 @@ static void
 print_column_headers ()
 {
   if ( vnlog )
-    printf ("# ");
+    output_str ("# ");
+
+  /* The results of --merge-partial are in the same columns as the
+     partial results, with the same headers */
+  if (merge_partial && input_header)
+    {
+      for (size_t n=1; n<=get_num_column_headers (); ++n)
+        {
+          output_str (get_input_field_name (n));
+          if (n != get_num_column_headers ())
+            print_field_separator ();
+        }
+      print_line_separator ();
+      return;
+    }
 
   if (print_full_line)
     {
       /* Print the headers of all the input fields */
       for (size_t n=1; n<=get_num_column_headers (); ++n)
         {
-          fputs (get_input_field_name (n), stdout);
+          output_str (get_input_field_name (n));
           print_field_separator ();
         }
     }
@@ -498,7 +606,7 @@ print_column_headers ()
           const size_t col_num = dm->grps[i].num;
           if (col_num > get_num_column_headers ())
             error_not_enough_fields (col_num, get_num_column_headers ());
-          printf ("GroupBy" "(%s)",get_input_field_name (col_num));
+          output_printf ("GroupBy" "(%s)",get_input_field_name (col_num));
           print_field_separator ();
         }
     }
@@ -513,24 +621,33 @@ print_column_headers ()
       if (op->field > get_num_column_headers ())
         error_not_enough_fields (op->field, get_num_column_headers ());
 
-      printf ("%s", get_field_operation_name (op->op));
+      output_str (get_field_operation_name (op->op));
 
       if (op->op == OP_PERCENTILE) {
-        printf (":%"PRIuMAX, (uintmax_t)op->params.percentile);
+        output_printf (":%"PRIuMAX, (uintmax_t)op->params.percentile);
       }
       if (op->op == OP_TRIMMED_MEAN) {
-        printf (":%Lg", op->params.trimmed_mean);
+        output_printf (":%Lg", op->params.trimmed_mean);
+      }
+      if (op->op == OP_APPROX_PERCENTILE) {
+        output_printf (":%"PRIuMAX, (uintmax_t)op->params.approx.percentile);
+      }
+      if (op->op == OP_TOPK || op->op == OP_APPROX_TOPK) {
+        output_printf (":%"PRIuMAX, (uintmax_t)op->params.topk.k);
+      }
+      if (op->op == OP_SAMPLE) {
+        output_printf (":%"PRIuMAX, (uintmax_t)op->params.sample_size);
       }
 
-      printf ("(%s", get_input_field_name (op->field));
+      output_printf ("(%s", get_input_field_name (op->field));
       while (dm->ops[i].slave)
         {
           /* print subsequent arguments to the same operation,
              e.g. 'pcov (x,y)' */
           ++i;
-          printf (",%s", get_input_field_name (dm->ops[i].field));
+          output_printf (",%s", get_input_field_name (dm->ops[i].field));
         }
-      printf (")");
+      output_char (')');
 
       if (i != dm->num_ops-1)
         print_field_separator ();
@@ -580,16 +697,17 @@ process_input_header (FILE *stream)
 }
 
 static void
-summarize_field_ops ()
+summarize_field_ops (struct fieldop *ops)
 {
+  field_ops_order_shared_values (ops, dm->num_ops);
   for (size_t i=0;i<dm->num_ops;++i)
     {
-      struct fieldop *p = &dm->ops[i];
+      struct fieldop *p = &ops[i];
       if (p->slave)
         continue;
 
       field_op_summarize (p);
-      fputs (p->out_buf, stdout);
+      output_str (p->out_buf);
 
       /* print field separator */
       if (i != dm->num_ops-1)
@@ -607,44 +725,110 @@ reset_field_ops ()
     field_op_reset (&dm->ops[i]);
 }
 
-/* Process a completed group of data lines
-   (all with the same 'group by' keys). */
+/* Output the results of a group, represented by 'line',
+   with the operations 'ops' */
 static void
-process_group (const struct line_record_t* line)
+print_group (const struct line_record_t* line, struct fieldop *ops)
 {
   /* TODO: dynamically re-alloc if needed */
   char col_name[512];
   char row_name[512];
 
-  if (lines_in_group>0)
+  if (crosstab_mode)
     {
-      if (crosstab_mode)
-        {
-          /* cross-tabulation mode - save results in a matrix, print later */
-          const size_t row_field = dm->grps[0].num;
-          safe_line_record_get_fieldz (line, row_field,
-                                       row_name, sizeof row_name);
+      /* cross-tabulation mode - save results in a matrix, print later */
+      const size_t row_field = dm->grps[0].num;
+      safe_line_record_get_fieldz (line, row_field,
+                                   row_name, sizeof row_name);
 
-          const size_t col_field = dm->grps[1].num;
-          safe_line_record_get_fieldz (line, col_field,
-                                       col_name, sizeof col_name);
+      const size_t col_field = dm->grps[1].num;
+      safe_line_record_get_fieldz (line, col_field,
+                                   col_name, sizeof col_name);
 
-          field_op_summarize (&dm->ops[0]);
-          const char* data = dm->ops[0].out_buf;
+      field_op_summarize (&ops[0]);
+      const char* data = ops[0].out_buf;
 
-          crosstab_add_result (crosstab, row_name, col_name, data);
-        }
-      else
-        {
-          /* group-by/per-line mode - print results once available */
-          print_input_line (line);
-          summarize_field_ops ();
-        }
+      crosstab_add_result (crosstab, row_name, col_name, data);
+    }
+  else
+    {
+      /* group-by/per-line mode - print results once available */
+      print_input_line (line);
+      summarize_field_ops (ops);
     }
+}
+
+/* Process a completed group of data lines
+   (all with the same 'group by' keys). */
+static void
+process_group (const struct line_record_t* line)
+{
+  if (lines_in_group>0)
+    print_group (line, dm->ops);
   lines_in_group = 0;
   reset_field_ops ();
 }
 
+/* Called before reading the first data line:
+   read the input header line (if any) and print the output header line */
+static void
+begin_process_file ()
+{
+  /* If there is an input header line, and it wasn't read already
+     in 'open_input' - read it now */
+  if (input_header && line_number==0)
+    process_input_header (input_stream);
+
+  /* The fields of all operations are known now (including named columns) */
+  field_ops_share_values (dm->ops, dm->num_ops);
+
+  /* Data lines need to be split only up to the last field used by the
+     groups and operations (unless the entire line is printed) */
+  if (!print_full_line)
+    {
+      size_t max_field = 0;
+      for (size_t i = 0; i < dm->num_grps; ++i)
+        max_field = MAX (max_field, dm->grps[i].num);
+      for (size_t i = 0; i < dm->num_ops; ++i)
+        max_field = MAX (max_field, dm->ops[i].field);
+      max_parsed_fields = max_field;
+    }
+
+  if (print_full_line && !line_mode)
+    fputs (_("datamash: Using -f/--full with non-linewise operations \
+is deprecated and will be disabled in a future release.\n"), stderr);
+
+  /* If there is an input header line, and the user requested an output
+     header line, and the input line was read successfully, print headers */
+  if (input_header && output_header && line_number==1)
+    print_column_headers ();
+}
+
+/* Read and split the input lines in background threads (--threads),
+   once the options used to split lines are final.  The worker threads
+   also call 'process_chunk' (if not NULL) on the lines of each chunk.
+   Returns false if the threads are not used. */
+static bool
+start_input_threads (input_threads_chunk_fn process_chunk)
+{
+  return num_threads > 1 && !vnlog
+         && input_threads_start (input_stream, num_threads - 1,
+                                 process_chunk);
+}
+
+/* If there's no input header line, and the user requested an output
+   header line, then generate output header line based on the number
+   of fields in the first (data, non-header) input line */
+static void
+first_line_headers (const struct line_record_t *line)
+{
+  if (line_number==1 && output_header && !input_header)
+    {
+      build_input_line_headers (line, false);
+      print_column_headers ();
+    }
+}
+
 /*
     Process each line in the input.
 
@@ -663,20 +847,8 @@ process_file ()
   line_record_init (thisline);
   line_record_init (group_first_line);
 
-  /* If there is an input header line, and it wasn't read already
-     in 'open_input' - read it now */
-  if (input_header && line_number==0)
-    process_input_header (input_stream);
-
-  if (print_full_line && !line_mode)
-    fputs (_("datamash: Using -f/--full with non-linewise operations \
-is deprecated and will be disabled in a future release.\n"), stderr);
-
-  /* If there is an input header line, and the user requested an output
-     header line, and the input line was read successfully, print headers */
-  if (input_header && output_header && line_number==1)
-    print_column_headers ();
-
+  begin_process_file ();
+  start_input_threads (NULL);
 
   while (line_record_fread (thisline, input_stream, eolchar,
                             skip_comments, false))
@@ -684,16 +856,7 @@ is deprecated and will be disabled in a future release.\n"), stderr);
       bool new_group = false;
 
       line_number++;
-
-      /* If there's no input header line, and the user requested an output
-         header line, then generate output header line based on the number
-         of fields in the first (data, non-header) input line */
-      if (line_number==1 && output_header && !input_header)
-        {
-          build_input_line_headers (thisline, false);
-          print_column_headers ();
-        }
-
+      first_line_headers (thisline);
 
       /* If no keys are given, the entire input is considered one group */
       if (dm->num_grps || line_mode)
@@ -714,7 +877,7 @@ is deprecated and will be disabled in a future release.\n"), stderr);
         }
 
       lines_in_group++;
-      bool keep_line = process_line (thisline);
+      bool keep_line = process_line (thisline, dm->ops);
 
       if (new_group || keep_line)
         {
@@ -729,6 +892,274 @@ is deprecated and will be disabled in a future release.\n"), stderr);
   line_record_free (&lb2);
 }
 
+/* Exit with an error if the line lacks a group-by field */
+static void
+verify_group_fields (const struct line_record_t *line)
+{
+  const char *str = NULL;
+  size_t len = 0;
+
+  for (size_t i = 0; i < dm->num_grps; ++i)
+    safe_line_record_get_field (line, dm->grps[i].num, &str, &len);
+}
+
+/* Read the next line for in-memory grouping: from the input if 'partition'
+   is NULL, otherwise from the spilled partition file. */
+static bool
+read_unsorted_line (FILE *partition, struct line_record_t *line)
+{
+  uintmax_t seq;
+
+  if (partition)
+    {
+      if (!spill_read_line (partition, line, &seq))
+        return false;
+      /* Report errors with the line number in the input */
+      line_number = seq;
+      return true;
+    }
+
+  if (!line_record_fread (line, input_stream, eolchar, skip_comments, false))
+    return false;
+
+  line_number++;
+  first_line_headers (line);
+  verify_group_fields (line);
+  return true;
+}
+
+/* Group the lines of the input (or of a spilled partition) in memory.
+
+   Once the groups use more memory than allowed (--memory-limit, or
+   DEFAULT_MEMORY_LIMIT), lines of existing groups are still processed, but lines of new groups
+   are written to partition files, each processed later (recursively,
+   at the next 'level').  The results of all such group tables are
+   written as runs, and merged at the end. */
+static void
+group_unsorted_lines (FILE *partition, size_t level, struct spill_runs *runs)
+{
+  struct line_record_t line;
+  struct spill_partitions *parts = NULL;
+  struct group_table *gt = group_table_init (dm, print_full_line);
+  bool memory_grows = false;
+
+  /* Unless the memory of an operation can grow with its values, the
+     memory of a group only changes when it is created, or its line
+     is replaced */
+  for (size_t i = 0; i < dm->num_ops; ++i)
+    memory_grows = memory_grows || field_op_memory_grows (&dm->ops[i]);
+
+  line_record_init (&line);
+
+  while (read_unsorted_line (partition, &line))
+    {
+      bool new_group = false;
+      struct group_entry *g;
+
+      if (parts == NULL)
+        g = group_table_lookup (gt, &line, line_number, &new_group);
+      else if ((g = group_table_find (gt, &line)) == NULL)
+        {
+          spill_partitions_add_line (parts, &line, line_number);
+          continue;
+        }
+
+      bool keep_line = process_line (&line, g->ops);
+
+      if (keep_line && !new_group)
+        group_table_set_line (gt, g, &line);
+
+      if (new_group || keep_line || memory_grows)
+        {
+          group_table_update_memory (gt, g);
+          if (parts == NULL && group_table_memory (gt) > memory_limit)
+            parts = spill_partitions_new (level);
+        }
+    }
+  line_record_free (&line);
+
+  const size_t n = group_table_num_entries (gt);
+  struct group_entry **groups = group_table_entries (gt, !keep_order);
+  if (crosstab_mode || (level == 0 && parts == NULL))
+    {
+      /* Nothing was spilled (or it's a crosstab, which sorts the results
+         itself) - the groups can be printed right away */
+      for (size_t i = 0; i < n; ++i)
+        print_group (&groups[i]->line, groups[i]->ops);
+    }
+  else
+    spill_runs_add (runs, groups, n, dm->num_ops);
+  group_table_free (gt);
+
+  if (parts)
+    {
+      for (size_t i = 0; i < SPILL_PARTITIONS; ++i)
+        {
+          FILE *f = spill_partitions_take (parts, i);
+          if (f == NULL)
+            continue;
+          group_unsorted_lines (f, level + 1, runs);
+          spill_close (f);
+        }
+      spill_partitions_free (parts);
+    }
+}
+
+/* The groups of one chunk of input lines, collected by a worker thread */
+struct chunk_groups
+{
+  struct group_table *gt;
+
+  /* The number of lines collected: the following lines (starting with
+     an invalid one) are left to the main thread, which reports the
+     error as usual */
+  size_t num_lines;
+};
+
+/* Collect the groups of a chunk of input lines
+   (called by the worker threads, see group_unsorted_chunks) */
+static void *
+group_chunk_lines (const struct line_record_t *lines, size_t num_lines)
+{
+  struct chunk_groups *cg = XMALLOC (struct chunk_groups);
+  size_t i;
+
+  cg->gt = group_table_init (dm, false);
+  for (i = 0; i < num_lines; ++i)
+    {
+      const struct line_record_t *line = &lines[i];
+      bool new_group = false;
+      bool keep_line = false;
+      bool ok = true;
+
+      /* All the fields used must exist (the last one is max_parsed_fields) */
+      if (line_record_num_fields (line) < max_parsed_fields)
+        break;
+
+      struct group_entry *g = group_table_lookup (cg->gt, line, i + 1,
+                                                  &new_group);
+      for (size_t j = 0; j < dm->num_ops && ok; ++j)
+        {
+          struct fieldop *op = &g->ops[j];
+          const struct field_record_t *f =
+            line_record_field_unsafe (line, op->field);
+          const enum FIELD_OP_COLLECT_RESULT flocr =
+            collect_field (op, f->buf, f->len);
+          ok = field_op_ok (flocr);
+          keep_line = keep_line || (flocr == FLOCR_OK_KEEP_LINE);
+        }
+      /* The main thread stops at this line, with the error */
+      if (!ok)
+        break;
+
+      if (keep_line && !new_group)
+        group_table_set_line (cg->gt, g, line);
+    }
+  cg->num_lines = i;
+  return cg;
+}
+
+/* Group the input lines in memory, in the worker threads (--threads):
+   each chunk of lines is grouped in its own table, and merged into
+   the main table in input order.
+   Returns false if the threads can't be used. */
+static bool
+group_unsorted_chunks ()
+{
+  const struct line_record_t *lines;
+  size_t num_lines;
+  void *result;
+
+  /* The main table is created before the workers create their own
+     (see group_table_init) */
+  struct group_table *gt = group_table_init (dm, false);
+  if (!start_input_threads (group_chunk_lines))
+    {
+      group_table_free (gt);
+      return false;
+    }
+
+  while (input_threads_read_chunk (&lines, &num_lines, &result))
+    {
+      struct chunk_groups *cg = result;
+      const uintmax_t first_line = line_number;
+
+      if (num_lines && line_number == 0)
+        {
+          line_number = 1;
+          first_line_headers (&lines[0]);
+        }
+
+      const enum FIELD_OP_COLLECT_RESULT flocr =
+        group_table_merge (gt, cg->gt, first_line);
+      if (!field_op_ok (flocr))
+        die (EXIT_FAILURE, 0, "%s",                   /* LCOV_EXCL_LINE */
+             field_op_collect_result_name (flocr));  /* LCOV_EXCL_LINE */
+      line_number = first_line + cg->num_lines;
+
+      for (size_t i = cg->num_lines; i < num_lines; ++i)
+        {
+          bool new_group;
+
+          line_number++;
+          verify_group_fields (&lines[i]);
+          struct group_entry *g = group_table_lookup (gt, &lines[i],
+                                                      line_number,
+                                                      &new_group);
+          if (process_line (&lines[i], g->ops) && !new_group)
+            group_table_set_line (gt, g, &lines[i]);
+        }
+      free (cg);
+    }
+
+  const size_t n = group_table_num_entries (gt);
+  struct group_entry **groups = group_table_entries (gt, !keep_order);
+  for (size_t i = 0; i < n; ++i)
+    print_group (&groups[i]->line, groups[i]->ops);
+  group_table_free (gt);
+  return true;
+}
+
+/*
+    Process unsorted input, keeping all groups in memory.
+
+    Each line is added to its group (found by hashing its keys),
+    and the groups are printed after the entire input was read.
+ */
+static void
+process_file_hashed ()
+{
+  struct spill_runs *runs = spill_runs_new ();
+
+  begin_process_file ();
+  if (!(group_in_threads && group_unsorted_chunks ()))
+    {
+      start_input_threads (NULL);
+      group_unsorted_lines (NULL, 0, runs);
+    }
+
+  if (spill_runs_count (runs))
+    {
+      const struct line_record_t *line;
+      const char * const *results;
+      size_t num_results;
+
+      spill_runs_merge_begin (runs, !keep_order, memory_limit);
+      while (spill_runs_merge_next (runs, &line, &results, &num_results))
+        {
+          print_input_line (line);
+          for (size_t i = 0; i < num_results; ++i)
+            {
+              if (i)
+                print_field_separator ();
+              output_str (results[i]);
+            }
+          print_line_separator ();
+        }
+    }
+  spill_runs_free (runs);
+}
+
 /*
     Transpose rows and columns in input file
  */
@@ -788,9 +1219,9 @@ transpose_file ()
           const char* str;
           size_t len;
           if (line_record_get_field (line, i, &str, &len))
-            fwrite (str, len, sizeof (char), stdout);
+            output_write (str, len);
           else
-            fputs (missing_field_filler, stdout);
+            output_str (missing_field_filler);
         }
       print_line_separator ();
     }
@@ -840,7 +1271,7 @@ reverse_fields_in_file ()
               build_input_line_headers (&lr, true);
               group_columns_find_named_columns ();
 
-              fprintf (stdout, "# ");
+              output_str ("# ");
               const size_t num_fields = line_record_num_fields (thisline);
               for (size_t i = num_fields ; i >= 1 ; --i) {
                 if (i<num_fields)
@@ -850,7 +1281,7 @@ reverse_fields_in_file ()
                 size_t len;
                 if (line_record_get_field (thisline, i, &str, &len))
                 {
-                  ignore_value (fwrite (str, len, sizeof (char), stdout));
+                  output_write (str, len);
                 }
               }
               print_line_separator ();
@@ -873,7 +1304,7 @@ reverse_fields_in_file ()
                 {
                   if (i < num_fields)
                     print_field_separator ();
-                  fputs (get_input_field_name (i), stdout);
+                  output_str (get_input_field_name (i));
                 }
               print_line_separator ();
             }
@@ -888,7 +1319,7 @@ reverse_fields_in_file ()
           const char* str = NULL;
           size_t len = 0 ;
           ignore_value (line_record_get_field (thisline, i, &str, &len));
-          fwrite (str, len, sizeof (char), stdout);
+          output_write (str, len);
         }
       print_line_separator ();
     }
@@ -913,9 +1344,8 @@ noop_file ()
 
       if (print_full_line)
         {
-          ignore_value (fwrite (line_record_buffer (thisline),
-                                line_record_length (thisline), sizeof (char),
-                                stdout));
+          output_write (line_record_buffer (thisline),
+                        line_record_length (thisline));
           print_line_separator ();
         }
     }
@@ -1002,11 +1432,11 @@ tabular_check_file ()
     }
 
   /* Print summary */
-  printf (ngettext ("%"PRIuMAX" line", "%"PRIuMAX" lines",
-          select_plural (line_number)), (uintmax_t)line_number);
-  fputs (", ", stdout);
-  printf (ngettext ("%"PRIuMAX" field", "%"PRIuMAX" fields",
-          select_plural (prev_num_fields)), (uintmax_t)prev_num_fields);
+  output_printf (ngettext ("%"PRIuMAX" line", "%"PRIuMAX" lines",
+                           select_plural (line_number)), (uintmax_t)line_number);
+  output_str (", ");
+  output_printf (ngettext ("%"PRIuMAX" field", "%"PRIuMAX" fields",
+                           select_plural (prev_num_fields)), (uintmax_t)prev_num_fields);
   print_line_separator ();
 
   line_record_free (&lb1);
@@ -1066,7 +1496,7 @@ remove_dups_in_file ()
           if (output_header)
             {
               if (vnlog)
-                fprintf (stdout, "# ");
+                output_str ("# ");
               const size_t num_fields = line_record_num_fields (thisline);
               for (size_t i = 1 ; i <= num_fields ; ++i) {
                 if (i>1)
@@ -1076,7 +1506,7 @@ remove_dups_in_file ()
                 size_t len;
                 if (line_record_get_field (thisline, i, &str, &len))
                   {
-                    ignore_value (fwrite (str, len, sizeof (char), stdout));
+                    output_write (str, len);
                   }
               }
               print_line_separator ();
@@ -1132,7 +1562,7 @@ remove_dups_in_file ()
             size_t len;
             if (line_record_get_field (thisline, i, &str, &len))
               {
-                ignore_value (fwrite (str, len, sizeof (char), stdout));
+                output_write (str, len);
               }
           }
           print_line_separator ();
@@ -1146,6 +1576,26 @@ remove_dups_in_file ()
 }
 
 
+/* Returns true if the groups can be collected in the worker threads
+   (--threads) and merged, with the same results.  Not with --full or
+   --ignore-case (where the printed line depends on which line of the
+   group was kept), --memory-limit, nor with 'rand' or 'sample' (which
+   depend on the sequence of random numbers) or 'sum:int' (which reports
+   an overflow at the line where it occurs). */
+static bool _GL_ATTRIBUTE_PURE
+can_group_in_threads ()
+{
+  if (num_threads < 2 || vnlog || print_full_line || !case_sensitive
+      || explicit_memory_limit)
+    return false;
+
+  for (size_t i = 0; i < dm->num_ops; ++i)
+    if (dm->ops[i].op == OP_RAND || dm->ops[i].op == OP_SAMPLE
+        || (dm->ops[i].op == OP_SUM && dm->ops[i].params.integer))
+      return false;
+  return true;
+}
+
 static void
 open_input ()
 {
@@ -1225,6 +1675,11 @@ open_input ()
       /* without grouping, there's no need to sort */
       input_stream = stdin;
       pipe_through_sort = false;
+
+      /* Read regular files directly from memory (vnlog needs the lines
+         NUL-terminated) */
+      if (!vnlog)
+        input_map_open (input_stream);
     }
 }
 
@@ -1233,6 +1688,9 @@ close_input ()
 {
   int i;
 
+  input_threads_stop ();
+  input_map_close ();
+
   if (ferror (input_stream))
     die (EXIT_FAILURE, errno, _("read error"));
 
@@ -1245,6 +1703,45 @@ close_input ()
     die (EXIT_FAILURE, errno, _("read error (on close)"));
 }
 
+/* Check the options used with --emit-partial/--merge-partial.
+   With --merge-partial, the groups and operations read the columns
+   printed by --emit-partial: the keys, then one state per operation. */
+static void
+init_partial_results ()
+{
+  const char *opt = merge_partial ? "--merge-partial" : "--emit-partial";
+
+  if (dm->mode != MODE_GROUPBY)
+    die (EXIT_FAILURE, 0, _("%s requires grouping operations"), opt);
+  if (print_full_line)
+    die (EXIT_FAILURE, 0, _("%s cannot be used with --full"), opt);
+
+  /* The fields of the partial results must not contain the delimiter */
+  int delim = 0;
+  if (field_op_emit_partial && field_op_partial_char (out_tab))
+    delim = out_tab;
+  else if (merge_partial && in_tab != TAB_WHITESPACE
+           && field_op_partial_char (in_tab))
+    delim = in_tab;
+  if (delim)
+    {
+      const char str[2] = { delim, '\0' };
+      die (EXIT_FAILURE, 0, _("%s cannot be used with the delimiter %s"),
+           opt, quote (str));
+    }
+
+  if (!merge_partial)
+    return;
+
+  for (size_t i = 0; i < dm->num_grps; ++i)
+    {
+      dm->grps[i].num = i + 1;
+      dm->grps[i].by_name = false;
+    }
+  field_ops_partial_columns (dm->ops, dm->num_ops, dm->num_grps + 1);
+  dm->header_required = false;
+}
+
 int main (int argc, char* argv[])
 {
   int optc;
@@ -1270,8 +1767,11 @@ int main (int argc, char* argv[])
   textdomain (PACKAGE);
 
   init_blank_table ();
+  number_parser_init ();
+  number_format_init (numeric_output_format);
 
   atexit (close_stdout);
+  output_init ();
 
   while ((optc = getopt_long (argc, argv, short_options, long_options, NULL))
          != -1)
@@ -1376,6 +1876,42 @@ int main (int argc, char* argv[])
 
         case SORT_PROGRAM_OPTION:
           sort_cmd = xstrdup (optarg);
+          explicit_sort_cmd = true;
+          break;
+
+        case KEEP_ORDER_OPTION:
+          keep_order = true;
+          break;
+
+        case MEMORY_LIMIT_OPTION:
+          {
+            uintmax_t n;
+            if (xstrtoumax (optarg, NULL, 10, &n, "kKmMgGtTPE") != LONGINT_OK
+                || n == 0 || n > SIZE_MAX)
+              die (EXIT_FAILURE, 0, _("invalid memory limit %s"),
+                   quote (optarg));
+            memory_limit = n;
+            explicit_memory_limit = true;
+          }
+          break;
+
+        case EMIT_PARTIAL_OPTION:
+          field_op_emit_partial = true;
+          break;
+
+        case MERGE_PARTIAL_OPTION:
+          merge_partial = true;
+          break;
+
+        case THREADS_OPTION:
+          {
+            uintmax_t n;
+            if (xstrtoumax (optarg, NULL, 10, &n, "") != LONGINT_OK
+                || n == 0 || n > 256)
+              die (EXIT_FAILURE, 0, _("invalid number of threads %s"),
+                   quote (optarg));
+            num_threads = n;
+          }
           break;
 
         case'c':
@@ -1429,6 +1965,9 @@ int main (int argc, char* argv[])
     dm = datamash_ops_parse_premode (premode, premode_group_spec,
                             argc - optind, (const char**)argv+optind);
 
+  if (field_op_emit_partial || merge_partial)
+    init_partial_results ();
+
   /* If using named-columns, but no input header - abort */
   if (dm->header_required && !input_header)
     die (EXIT_FAILURE, 0,
@@ -1462,6 +2001,31 @@ int main (int argc, char* argv[])
              _("vnlog processing always uses '\\n' to terminate output lines"));
     }
 
+  /* The partial results of a group can be anywhere in the input:
+     combine them in memory, in the order the groups first appear */
+  if (merge_partial && !pipe_through_sort)
+    keep_order = true;
+
+  /* Group unsorted input in memory, unless an external sort program
+     was explicitly requested. Other modes (e.g. rmdup) still use sort. */
+  if ((dm->mode == MODE_GROUPBY || dm->mode == MODE_CROSSTAB)
+      && dm->num_grps > 0
+      && (keep_order || (pipe_through_sort && !explicit_sort_cmd)))
+    {
+      hash_grouping = true;
+      pipe_through_sort = false;
+    }
+
+  /* With --threads, collect the groups in the worker threads.
+     Without group-by fields, the entire input is one group, collected
+     the same way. */
+  if (can_group_in_threads ()
+      && (hash_grouping || (dm->mode == MODE_GROUPBY && dm->num_grps == 0)))
+    {
+      hash_grouping = true;
+      group_in_threads = true;
+    }
+
   open_input ();
   switch (dm->mode)                              /* LCOV_EXCL_BR_LINE */
     {
@@ -1469,7 +2033,10 @@ int main (int argc, char* argv[])
       line_mode = true;
       /* fall through */
     case MODE_GROUPBY:
-      process_file ();
+      if (hash_grouping)
+        process_file_hashed ();
+      else
+        process_file ();
       break;
 
     case MODE_NOOP:
@@ -1493,7 +2060,10 @@ int main (int argc, char* argv[])
       assert ( dm->num_ops == 1 ); /* LCOV_EXCL_LINE */
       crosstab_mode = true;
       crosstab = crosstab_init ();
-      process_file ();
+      if (hash_grouping)
+        process_file_hashed ();
+      else
+        process_file ();
       crosstab_print (crosstab);
       crosstab_free (crosstab);
       break;
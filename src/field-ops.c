@@ -23,6 +23,7 @@
 #include <config.h>
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <locale.h>
 #include <math.h>
 #include <stdio.h>
@@ -46,13 +47,22 @@
 #include "base64.h"
 #include "xalloc.h"
 #include "hash-pjw-bare.h"
+#include "intprops.h"
+#include "c-ctype.h"
 
+#include "accum-type.h"
 #include "utils.h"
+#include "randutils.h"
+#include "tdigest.h"
+#include "hyperloglog.h"
+#include "value-counts.h"
 #include "text-options.h"
 #include "text-lines.h"
 #include "column-headers.h"
 #include "op-defs.h"
 #include "field-ops.h"
+#include "number-parser.h"
+#include "number-format.h"
 
 struct operation_data operations[] =
 {
@@ -97,29 +107,29 @@ struct operation_data operations[] =
   /* OP_PERCENTILE */
   {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_PSTDEV */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_SSTDEV */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_PVARIANCE */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_SVARIANCE */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_MAD */
   {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_MADRAW */
   {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_S_SKEWNESS */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_P_SKEWNESS */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_S_EXCESS_KURTOSIS */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_P_EXCESS_KURTOSIS */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_JARQUE_BETA */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_DP_OMNIBUS */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_MODE */
   {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_ANTIMODE */
@@ -147,15 +157,15 @@ struct operation_data operations[] =
   /* OP_SHA512 */
   {STRING_SCALAR, IGNORE_FIRST, STRING_RESULT},
   /* OP_P_COVARIANCE */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_S_COVARIANCE */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_P_PEARSON_COR */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_S_PEARSON_COR */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_DOT_PRODUCT */
-  {NUMERIC_VECTOR, IGNORE_FIRST, NUMERIC_RESULT},
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_BIN_BUCKETS */
   {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_STRBIN */
@@ -184,23 +194,30 @@ struct operation_data operations[] =
   {STRING_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
   /* OP_CUT */
   {STRING_SCALAR, IGNORE_FIRST, STRING_RESULT},
+  /* OP_APPROX_MEDIAN */
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
+  /* OP_APPROX_PERCENTILE */
+  {NUMERIC_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
+  /* OP_APPROX_COUNT_UNIQUE */
+  {STRING_SCALAR, IGNORE_FIRST, NUMERIC_RESULT},
+  /* OP_TOPK */
+  {STRING_VECTOR, IGNORE_FIRST, STRING_RESULT},
+  /* OP_APPROX_TOPK */
+  {STRING_VECTOR, IGNORE_FIRST, STRING_RESULT},
+  /* OP_SAMPLE */
+  {STRING_VECTOR, IGNORE_FIRST, STRING_RESULT},
   {0, 0, NUMERIC_RESULT}
 };
 
 //struct fieldop* field_ops = NULL;
 
-enum { VALUES_BATCH_INCREMENT = 1024 };
-
 /* Add a numeric value to the values vector, allocating memory as needed */
 static void
-field_op_add_value (struct fieldop *op, long double val)
+field_op_add_value (struct fieldop *op, accum_t val)
 {
   if (op->num_values >= op->alloc_values)
-    {
-      op->alloc_values += VALUES_BATCH_INCREMENT;
-      op->values = xnrealloc (op->values, op->alloc_values,
-                              sizeof (long double));
-    }
+    op->values = x2nrealloc (op->values, &op->alloc_values,
+                             sizeof (accum_t));
   op->values[op->num_values] = val;
   op->num_values++;
 }
@@ -239,15 +256,25 @@ field_op_to_hex ( struct fieldop* op, const char *buffer, const size_t inlen )
   *ptr = 0 ;
 }
 
-/* Add a string to the strings vector, allocating memory as needed */
+/* Ensure the string buffer has MORE than 'minsize' bytes allocated
+   (the extra byte is used by dirname/basename).
+   The buffer grows geometrically, starting small: with hash grouping
+   every group has its own field-ops, and most groups are small. */
 static void
-field_op_add_string (struct fieldop *op, const char* str, size_t slen)
+field_op_reserve_str_buf (struct fieldop *op, const size_t minsize)
 {
-  if (op->str_buf_used + slen+1 >= op->str_buf_alloc)
+  if (minsize >= op->str_buf_alloc)
     {
-      op->str_buf_alloc += MAX (VALUES_BATCH_INCREMENT,slen+1);
+      op->str_buf_alloc = MAX (op->str_buf_alloc*2, minsize+1);
       op->str_buf = xrealloc (op->str_buf, op->str_buf_alloc);
     }
+}
+
+/* Add a string to the strings vector, allocating memory as needed */
+static void
+field_op_add_string (struct fieldop *op, const char* str, size_t slen)
+{
+  field_op_reserve_str_buf (op, op->str_buf_used + slen+1);
 
   /* Copy the string to the buffer */
   memcpy (op->str_buf + op->str_buf_used, str, slen);
@@ -260,11 +287,7 @@ field_op_add_string (struct fieldop *op, const char* str, size_t slen)
 static void
 field_op_replace_string (struct fieldop *op, const char* str, size_t slen)
 {
-  if (slen+1 >= op->str_buf_alloc)
-    {
-      op->str_buf_alloc += MAX (VALUES_BATCH_INCREMENT,slen+1);
-      op->str_buf = xrealloc (op->str_buf, op->str_buf_alloc);
-    }
+  field_op_reserve_str_buf (op, slen+1);
 
   /* Copy the string to the buffer */
   memcpy (op->str_buf, str, slen);
@@ -272,24 +295,307 @@ field_op_replace_string (struct fieldop *op, const char* str, size_t slen)
   op->str_buf_used = slen + 1 ;
 }
 
+/* Returns true if the nul-terminated string 'stored' equals the string
+   'str' of 'slen' bytes (which has no nul byte) */
+static bool
+field_op_string_equal (const char *stored, const char *str, size_t slen)
+{
+  return (case_sensitive ? strncmp (stored, str, slen) == 0
+                         : strncasecmp (stored, str, slen) == 0)
+         && stored[slen] == '\0';
+}
+
+/* Returns true if 'op' counts the occurrences of its distinct strings */
+static inline bool
+field_op_counts_strings (const struct fieldop *op)
+{
+  return op->op == OP_TOPK || op->op == OP_APPROX_TOPK;
+}
+
+/* Returns the slot of the string 'str' (of 'slen' bytes, without nul
+   bytes) in the hash table of the distinct strings: either its slot,
+   or the empty slot where it would be added */
+static size_t
+field_op_str_set_slot (const struct fieldop *op, const char *str,
+                       size_t slen)
+{
+  const size_t mask = op->str_set_alloc - 1;
+  size_t i = hash_string (str, slen, case_sensitive) & mask;
+  while (op->str_set[i]
+         && !field_op_string_equal (op->str_buf + op->str_set[i] - 1,
+                                    str, slen))
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* Double the size of the hash table of the distinct strings */
+static void
+field_op_grow_str_set (struct fieldop *op)
+{
+  size_t *set = op->str_set;
+  size_t *counts = op->str_counts;
+  const size_t alloc = op->str_set_alloc;
+
+  op->str_set_alloc = alloc ? alloc * 2 : 8;
+  op->str_set = xcalloc (op->str_set_alloc, sizeof (size_t));
+  if (field_op_counts_strings (op))
+    op->str_counts = XNMALLOC (op->str_set_alloc, size_t);
+
+  for (size_t i = 0; i < alloc; ++i)
+    if (set[i])
+      {
+        const char *p = op->str_buf + set[i] - 1;
+        const size_t j = field_op_str_set_slot (op, p, strlen (p));
+        op->str_set[j] = set[i];
+        if (counts)
+          op->str_counts[j] = counts[i];
+      }
+
+  free (set);
+  free (counts);
+}
+
+/* Add 'count' occurrences of a string to the distinct strings
+   (unique/countunique/topk).  Unless an equal string (ignoring case with
+   --ignore-case) was already added, the string is stored:
+   the first of equal strings is kept */
+static void
+field_op_add_distinct_string (struct fieldop *op, const char* str,
+                              size_t slen, size_t count)
+{
+  /* Strings are stored nul-terminated: compare up to the first nul */
+  slen = strnlen (str, slen);
+
+  /* Keep the table at most half full */
+  if (2 * (op->str_set_used + 1) > op->str_set_alloc)
+    field_op_grow_str_set (op);
+
+  const size_t i = field_op_str_set_slot (op, str, slen);
+  if (!op->str_set[i])
+    {
+      op->str_set[i] = op->str_buf_used + 1;
+      op->str_set_used++;
+      field_op_add_string (op, str, slen);
+      if (op->str_counts)
+        op->str_counts[i] = 0;
+    }
+  if (op->str_counts)
+    op->str_counts[i] += count;
+}
+
+static int
+cmp_size_t (const void *p1, const void *p2)
+{
+  const size_t a = *(const size_t *) p1;
+  const size_t b = *(const size_t *) p2;
+  return (a > b) - (a < b);
+}
+
+/* approxtopk: once there are more distinct strings than the capacity,
+   subtract the median count from all the counts, and remove the strings
+   whose count drops to zero (Misra-Gries, with the reduction of
+   Anderson et al., "A High-Performance Algorithm for Identifying
+   Frequent Items in Data Streams", 2017).  At least half the strings are
+   removed, so this is done at most once every capacity/2 new strings,
+   and the total subtracted (the most a count can be low by) is at most
+   2*N/capacity, for N values.  */
+static void
+field_op_reduce_str_counts (struct fieldop *op)
+{
+  if (op->op != OP_APPROX_TOPK
+      || op->str_set_used <= op->params.topk.capacity)
+    return;
+
+  const size_t n = op->str_set_used;
+  size_t *counts = XNMALLOC (n, size_t);
+  size_t j = 0;
+  for (size_t i = 0; i < op->str_set_alloc; ++i)
+    if (op->str_set[i])
+      counts[j++] = op->str_counts[i];
+  qsort (counts, n, sizeof (size_t), cmp_size_t);
+  const size_t median = counts[(n - 1) / 2];
+  free (counts);
+
+  /* Add the remaining strings again, to a new string buffer */
+  char *str_buf = op->str_buf;
+  size_t *set = op->str_set;
+  size_t *str_counts = op->str_counts;
+  const size_t alloc = op->str_set_alloc;
+  op->str_buf = NULL;
+  op->str_buf_used = op->str_buf_alloc = 0;
+  op->str_set = op->str_counts = NULL;
+  op->str_set_used = op->str_set_alloc = 0;
+  for (size_t i = 0; i < alloc; ++i)
+    if (set[i] && str_counts[i] > median)
+      {
+        const char *p = str_buf + set[i] - 1;
+        field_op_add_distinct_string (op, p, strlen (p),
+                                      str_counts[i] - median);
+      }
+  op->str_counts_error += median;
+
+  free (str_buf);
+  free (set);
+  free (str_counts);
+}
+
+/* Draw the number of values to skip before the next sampled value */
+static void
+field_op_sample_draw_skip (struct fieldop *op)
+{
+  const double skip = floor (log (random_unit ())
+                             / log1p (-op->state.sample.w));
+  op->state.sample.skip = skip < SIZE_MAX ? skip : SIZE_MAX;
+}
+
+/* Reservoir sampling of 'k' values with Algorithm L (K.-H. Li,
+   "Reservoir-Sampling Algorithms of Time Complexity O(n(1+log(N/n)))",
+   1994): instead of drawing a random number for every value, the number
+   of values to skip is drawn after each sampled value, so N values
+   need O(k(1+log(N/k))) random numbers.
+   Returns true if the value just collected (the 'op->count'th) is
+   sampled, and stores in '*slot' the sampled value it replaces
+   (or '*slot' is 'op->count-1' for the first 'k' values).  */
+static bool
+field_op_sample_next (struct fieldop *op, size_t k, size_t *slot)
+{
+  if (op->count <= k)
+    {
+      *slot = op->count - 1;
+      return true;
+    }
+
+  /* Drawn only with more than 'k' values (most groups are small) */
+  if (op->count == k + 1)
+    {
+      op->state.sample.w = exp (log (random_unit ()) / k);
+      field_op_sample_draw_skip (op);
+    }
+
+  if (op->state.sample.skip > 0)
+    {
+      op->state.sample.skip--;
+      return false;
+    }
+
+  *slot = random_range (k);
+  op->state.sample.w *= exp (log (random_unit ()) / k);
+  field_op_sample_draw_skip (op);
+  return true;
+}
+
+/* Move the sampled strings to a new string buffer (of the same size),
+   without the strings they replaced */
+static void
+field_op_compact_sample (struct fieldop *op)
+{
+  char *str_buf = xmalloc (op->str_buf_alloc);
+  size_t used = 0;
+  for (size_t i = 0; i < op->state.sample.used; ++i)
+    {
+      const char *p = op->str_buf + op->state.sample.offsets[i];
+      const size_t len = strlen (p) + 1;
+      memcpy (str_buf + used, p, len);
+      op->state.sample.offsets[i] = used;
+      used += len;
+    }
+  free (op->str_buf);
+  op->str_buf = str_buf;
+  op->str_buf_used = used;
+}
+
+/* Store the string 'str' as the sampled string of slot 'slot'
+   (a new one if 'slot' is the number of sampled strings).  The replaced
+   strings stay in the string buffer until they use half of it: the
+   strings are copied only when sampled.  */
+static void
+field_op_set_sample_string (struct fieldop *op, size_t slot,
+                            const char *str, size_t slen)
+{
+  slen = strnlen (str, slen);
+
+  if (slot == op->state.sample.used)
+    {
+      if (op->state.sample.used == op->state.sample.alloc)
+        op->state.sample.offsets = x2nrealloc (op->state.sample.offsets,
+                                               &op->state.sample.alloc,
+                                               sizeof (size_t));
+      op->state.sample.used++;
+    }
+  else
+    op->state.sample.bytes -=
+      strlen (op->str_buf + op->state.sample.offsets[slot]) + 1;
+
+  op->state.sample.offsets[slot] = op->str_buf_used;
+  op->state.sample.bytes += slen + 1;
+  field_op_add_string (op, str, slen);
+
+  if (op->str_buf_used >= 2 * op->state.sample.bytes)
+    field_op_compact_sample (op);
+}
+
+/* Merge the sampled strings of 'src' into those of 'op': each of the
+   (at most k) strings of the merged sample is one of the remaining
+   strings of 'op' or 'src', with a probability proportional to their
+   numbers of values not yet represented (a hypergeometric draw).
+   Both are uniform samples, so the merged one is too.  No values are
+   collected after a merge (the skip state is not updated).  */
+static void
+field_op_merge_sample (struct fieldop *op, struct fieldop *src)
+{
+  const size_t k = op->params.sample_size;
+  size_t n[2] = { op->count, src->count };
+  size_t avail[2] = { op->state.sample.used, src->state.sample.used };
+
+  /* The sampled strings are moved to a new buffer, in the order drawn */
+  char *str_buf = op->str_buf;
+  size_t *sample = op->state.sample.offsets;
+  op->str_buf = NULL;
+  op->str_buf_used = op->str_buf_alloc = 0;
+  op->state.sample.offsets = NULL;
+  op->state.sample.used = op->state.sample.alloc = 0;
+  op->state.sample.bytes = 0;
+
+  for (size_t i = 0; i < k && n[0] + n[1] > 0; ++i)
+    {
+      const int j = random_range (n[0] + n[1]) < n[0] ? 0 : 1;
+      size_t *slots = j == 0 ? sample : src->state.sample.offsets;
+      const char *buf = j == 0 ? str_buf : src->str_buf;
+
+      /* A remaining string, at random (moved past the remaining ones) */
+      const size_t r = random_range (avail[j]--);
+      const size_t offset = slots[r];
+      slots[r] = slots[avail[j]];
+      slots[avail[j]] = offset;
+      n[j]--;
+
+      const char *p = buf + offset;
+      field_op_set_sample_string (op, op->state.sample.used, p, strlen (p));
+    }
+
+  free (str_buf);
+  free (sample);
+}
+
 /* Returns an array of string-pointers (char*),
-   each pointing to a string in the string buffer
-   (added by field_op_add_string () ).
+   each pointing to a distinct string in the string buffer
+   (added by field_op_add_distinct_string () ).
 
    The returned pointer must be free'd.
 
-   The returned pointer will have 'op->count+1' elements,
-   pointing to 'op->count' strings + one last NULL.
+   The returned pointer will have 'op->str_set_used+1' elements,
+   pointing to 'op->str_set_used' strings + one last NULL.
 */
 static const char **
 field_op_get_string_ptrs ( struct fieldop *op, bool sort,
                            bool sort_case_sensitive )
 {
-  const char **ptrs = xnmalloc (op->count+1, sizeof (char*));
+  const size_t count = op->str_set_used;
+  const char **ptrs = xnmalloc (count+1, sizeof (char*));
   char *p = op->str_buf;
   const char* pend = op->str_buf + op->str_buf_used;
   size_t idx=0;
-  while (p < pend && idx < op->count)
+  while (p < pend && idx < count)
     {
       ptrs[idx++] = p;
       while ( p<pend && *p != '\0' )
@@ -301,411 +607,2338 @@ field_op_get_string_ptrs ( struct fieldop *op, bool sort,
   if (sort)
     {
       /* Sort the string pointers */
-      qsort ( ptrs, op->count, sizeof (char*), sort_case_sensitive
+      qsort ( ptrs, count, sizeof (char*), sort_case_sensitive
                                             ?cmpstringp
                                             :cmpstringp_nocase);
     }
   return ptrs;
 }
 
-/* Sort the numeric values vector in a fieldop structure */
-static void
-field_op_sort_values (struct fieldop *op)
-{
-  qsortfl (op->values, op->num_values);
-}
+/* The largest number of ranks needed by one operation (iqr) */
+#define MAX_OP_RANKS 4
 
-void
-field_op_init (struct fieldop* /*out*/ op,
-               enum field_operation oper,
-               bool by_name, size_t num, const char* name)
+/* Returns true if 'op' only needs the collected values, in any order */
+static bool
+field_op_uses_ordered_values (const struct fieldop *op)
 {
-  assert (op != NULL); /* LCOV_EXCL_LINE */
-  memset (op, 0, sizeof *op);
-
-  op->op = oper;
-  op->acc_type = operations[oper].acc_type;
-  op->res_type = operations[oper].res_type;
-  op->numeric = (op->acc_type == NUMERIC_SCALAR
-                 || op->acc_type == NUMERIC_VECTOR);
-  op->auto_first = operations[oper].auto_first;
-  op->slave = false;
-  op->slave_op = NULL;
-
-  op->field = num;
-  op->field_by_name = by_name;
-  op->field_name = (by_name)?xstrdup (name):NULL;
-  op->first = true;
-  if (op->res_type == STRING_RESULT)
+  switch (op->op)
     {
-      op->out_buf_alloc = 1024;
-      op->out_buf = xmalloc (op->out_buf_alloc);
+    case OP_MEDIAN:
+    case OP_QUARTILE_1:
+    case OP_QUARTILE_3:
+    case OP_IQR:
+    case OP_PERCENTILE:
+    case OP_MAD:
+    case OP_MADRAW:
+    case OP_TRIMMED_MEAN:
+      return true;
+
+    case OP_INVALID:
+    case OP_COUNT:
+    case OP_SUM:
+    case OP_MIN:
+    case OP_MAX:
+    case OP_ABSMIN:
+    case OP_ABSMAX:
+    case OP_RANGE:
+    case OP_FIRST:
+    case OP_LAST:
+    case OP_RAND:
+    case OP_MEAN:
+    case OP_GEOMEAN:
+    case OP_HARMMEAN:
+    case OP_MS:
+    case OP_RMS:
+    case OP_PSTDEV:
+    case OP_SSTDEV:
+    case OP_PVARIANCE:
+    case OP_SVARIANCE:
+    case OP_S_SKEWNESS:
+    case OP_P_SKEWNESS:
+    case OP_S_EXCESS_KURTOSIS:
+    case OP_P_EXCESS_KURTOSIS:
+    case OP_JARQUE_BERA:
+    case OP_DP_OMNIBUS:
+    case OP_MODE:
+    case OP_ANTIMODE:
+    case OP_UNIQUE:
+    case OP_COLLAPSE:
+    case OP_COUNT_UNIQUE:
+    case OP_BASE64:
+    case OP_DEBASE64:
+    case OP_MD5:
+    case OP_SHA1:
+    case OP_SHA224:
+    case OP_SHA256:
+    case OP_SHA384:
+    case OP_SHA512:
+    case OP_P_COVARIANCE:
+    case OP_S_COVARIANCE:
+    case OP_P_PEARSON_COR:
+    case OP_S_PEARSON_COR:
+    case OP_DOT_PRODUCT:
+    case OP_BIN_BUCKETS:
+    case OP_STRBIN:
+    case OP_FLOOR:
+    case OP_CEIL:
+    case OP_ROUND:
+    case OP_TRUNCATE:
+    case OP_FRACTION:
+    case OP_DIRNAME:
+    case OP_BASENAME:
+    case OP_EXTNAME:
+    case OP_BARENAME:
+    case OP_GETNUM:
+    case OP_CUT:
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
+    case OP_APPROX_COUNT_UNIQUE:
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+    case OP_SAMPLE:
+    default:
+      return false;
     }
 }
 
-/* Ensure this (master) fieldop has the same number of values as
-   as it's slave fieldop. */
-static void
-verify_slave_num_values (const struct fieldop *op)
+/* Store in 'ranks' the ranks (ascending) the operation needs from the
+   'n' values (see 'select_ranks').
+   Returns the number of ranks, or SIZE_MAX if the values must be sorted. */
+static size_t
+field_op_value_ranks (const struct fieldop *op, size_t n, size_t *ranks)
 {
-  assert (op && !op->slave && op->slave_op);     /* LCOV_EXCL_LINE */
-
-  if (op->num_values != op->slave_op->num_values)
-    die (EXIT_FAILURE, 0, _("input error for operation %s: \
-fields %"PRIuMAX",%"PRIuMAX" have different number of items"),
-                            quote (get_field_operation_name (op->op)),
-                            (uintmax_t)op->slave_op->field,
-                            (uintmax_t)op->field);
-}
+  size_t num_ranks;
 
-/* Add a value (from input) to the current field operation. */
-enum FIELD_OP_COLLECT_RESULT
-field_op_collect (struct fieldop *op,
-                  const char* str, size_t slen)
-{
-  char *endptr=NULL;
-  long double num_value = 0;
-  char tmpbuf[512];
-  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_OK;
+  switch (op->op)                                /* LCOV_EXCL_BR_LINE */
+    {
+    case OP_MEDIAN:
+    case OP_MAD:
+    case OP_MADRAW:
+      return median_ranks (n, ranks);
 
-  assert (str != NULL); /* LCOV_EXCL_LINE */
+    case OP_QUARTILE_1:
+      return percentile_ranks (n, 1.0/4.0, ranks);
 
-  if (remove_na_values && is_na (str,slen))
-    return FLOCR_OK_SKIPPED;
+    case OP_QUARTILE_3:
+      return percentile_ranks (n, 3.0/4.0, ranks);
 
-  if (op->numeric)
-    {
-      if (slen == 0)
-        return FLOCR_INVALID_NUMBER;
-#ifndef HAVE_BROKEN_STRTOLD
-      /* Usually, strtold stops at the field delimiter, but not always.
-         Optimistically try to avoid an extra copy, unless the strtold
-         implementation is known to be problematic. */
-      errno = 0;
-      num_value = strtold (str, &endptr);
-      if (errno==ERANGE || endptr==str || endptr<(str+slen))
-        return FLOCR_INVALID_NUMBER;
-      /* On Cygwin, strtold doesn't stop at a tab character,
-         and returns invalid value.
-         Generally, strtold doesn't stop on field separators
-         that can be part of long double representations.
-         If strtold continued past the field delimiter, make
-         a copy of the input buffer and NUL-terminate it. */
-      if (endptr > (str+slen))
+    case OP_IQR:
+      num_ranks = percentile_ranks (n, 1.0/4.0, ranks);
+      num_ranks += percentile_ranks (n, 3.0/4.0, ranks + num_ranks);
+      /* with few values, both quartiles can use the same ranks */
+      if (num_ranks > 2 && ranks[1] > ranks[2])
         {
-#endif
-          if (slen >= sizeof (tmpbuf))
-            die (EXIT_FAILURE, 0,
-                    "internal error: input field too long (%zu)", slen);
-          memcpy (tmpbuf,str,slen);
-          tmpbuf[slen]=0;
-          errno = 0;
-          num_value = strtold (tmpbuf, &endptr);
-          if (errno==ERANGE || endptr==tmpbuf || endptr!=(tmpbuf+slen))
-            return FLOCR_INVALID_NUMBER;
-#ifndef HAVE_BROKEN_STRTOLD
+          ranks[1] = ranks[0];
+          ranks[2] = ranks[0] + 1;
         }
-#endif
-    }
+      return num_ranks;
 
-  op->count++;
+    case OP_PERCENTILE:
+      return percentile_ranks (n, op->params.percentile / 100.0, ranks);
 
-  if (op->first && op->auto_first && op->numeric)
-      op->value = num_value;
+    case OP_TRIMMED_MEAN:
+      return trimmed_mean_ranks (n, op->params.trimmed_mean, ranks);
 
-  switch (op->op)                                /* LCOV_EXCL_BR_LINE */
-    {
+    case OP_INVALID:
+    case OP_COUNT:
     case OP_SUM:
-    case OP_MEAN:
-      op->value += num_value;
+    case OP_MIN:
+    case OP_MAX:
+    case OP_ABSMIN:
+    case OP_ABSMAX:
+    case OP_RANGE:
+    case OP_FIRST:
+    case OP_LAST:
+    case OP_RAND:
+    case OP_MEAN:
+    case OP_GEOMEAN:
+    case OP_HARMMEAN:
+    case OP_MS:
+    case OP_RMS:
+    case OP_PSTDEV:
+    case OP_SSTDEV:
+    case OP_PVARIANCE:
+    case OP_SVARIANCE:
+    case OP_S_SKEWNESS:
+    case OP_P_SKEWNESS:
+    case OP_S_EXCESS_KURTOSIS:
+    case OP_P_EXCESS_KURTOSIS:
+    case OP_JARQUE_BERA:
+    case OP_DP_OMNIBUS:
+    case OP_MODE:
+    case OP_ANTIMODE:
+    case OP_UNIQUE:
+    case OP_COLLAPSE:
+    case OP_COUNT_UNIQUE:
+    case OP_BASE64:
+    case OP_DEBASE64:
+    case OP_MD5:
+    case OP_SHA1:
+    case OP_SHA224:
+    case OP_SHA256:
+    case OP_SHA384:
+    case OP_SHA512:
+    case OP_P_COVARIANCE:
+    case OP_S_COVARIANCE:
+    case OP_P_PEARSON_COR:
+    case OP_S_PEARSON_COR:
+    case OP_DOT_PRODUCT:
+    case OP_BIN_BUCKETS:
+    case OP_STRBIN:
+    case OP_FLOOR:
+    case OP_CEIL:
+    case OP_ROUND:
+    case OP_TRUNCATE:
+    case OP_FRACTION:
+    case OP_DIRNAME:
+    case OP_BASENAME:
+    case OP_EXTNAME:
+    case OP_BARENAME:
+    case OP_GETNUM:
+    case OP_CUT:
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
+    case OP_APPROX_COUNT_UNIQUE:
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+    case OP_SAMPLE:
+    default:
+      return SIZE_MAX;
+    }
+}
+
+/* Returns the op holding the values of 'op' (possibly 'op' itself) */
+static inline struct fieldop*
+field_op_values_op (struct fieldop *op)
+{
+  return op->values_op ? op->values_op : op;
+}
+
+/* Sort the numeric values vector in a fieldop structure */
+static void
+field_op_sort_values (struct fieldop *op)
+{
+  struct fieldop *vop = field_op_values_op (op);
+  if (!vop->values_ordered)
+    qsortfl (vop->values, vop->num_values);
+  vop->values_ordered = true;
+}
+
+/* Order the numeric values vector as needed by the operation */
+static void
+field_op_order_values (struct fieldop *op)
+{
+  struct fieldop *vop = field_op_values_op (op);
+  size_t ranks[MAX_OP_RANKS];
+
+  if (vop->values_ordered)
+    return;
+
+  const size_t num_ranks = field_op_value_ranks (op, vop->num_values, ranks);
+  if (num_ranks == SIZE_MAX)
+    field_op_sort_values (op);
+  else
+    select_ranks (vop->values, vop->num_values, ranks, num_ranks);
+}
+
+/* The value is collected by the op holding the shared values */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_shared (struct fieldop *op _GL_UNUSED,
+                         const char *str _GL_UNUSED, size_t slen _GL_UNUSED)
+{
+  return FLOCR_OK;
+}
+
+void
+field_ops_share_values (struct fieldop *ops, size_t num_ops)
+{
+  for (size_t i = 0; i < num_ops; ++i)
+    {
+      struct fieldop *op = &ops[i];
+      if (!field_op_uses_ordered_values (op))
+        continue;
+
+      for (size_t j = 0; j < i; ++j)
+        if (field_op_uses_ordered_values (&ops[j]) && !ops[j].values_op
+            && ops[j].field == op->field)
+          {
+            op->values_op = &ops[j];
+            op->values_idx = j;
+            op->collect = op->collect_value = field_op_collect_shared;
+            ops[j].values_shared = true;
+            break;
+          }
+    }
+}
+
+void
+field_ops_order_shared_values (struct fieldop *ops, size_t num_ops)
+{
+  size_t *ranks = NULL;
+
+  for (size_t i = 0; i < num_ops; ++i)
+    {
+      struct fieldop *vop = &ops[i];
+      if (!vop->values_shared || vop->values_ordered)
+        continue;
+
+      /* Collect the ranks needed by all the ops using these values,
+         then order the values once */
+      if (ranks == NULL)
+        ranks = XNMALLOC (num_ops * MAX_OP_RANKS, size_t);
+      size_t num_ranks = 0;
+      bool sort = false;
+      for (size_t j = i; j < num_ops && !sort; ++j)
+        {
+          if (j != i && ops[j].values_op != vop)
+            continue;
+          const size_t n = field_op_value_ranks (&ops[j], vop->num_values,
+                                                 ranks + num_ranks);
+          if (n == SIZE_MAX)
+            sort = true;
+          else
+            num_ranks += n;
+        }
+
+      if (sort)
+        qsortfl (vop->values, vop->num_values);
+      else
+        {
+          qsort (ranks, num_ranks, sizeof *ranks, cmp_size_t);
+          select_ranks (vop->values, vop->num_values, ranks, num_ranks);
+        }
+      vop->values_ordered = true;
+    }
+  free (ranks);
+}
+
+void
+field_ops_partial_columns (struct fieldop *ops, size_t num_ops,
+                           size_t first_column)
+{
+  size_t column = first_column;
+
+  for (size_t i = 0; i < num_ops; ++i)
+    {
+      /* The state of a pair of fields (e.g. pcov) is printed by the
+         master op, which follows its slave op */
+      ops[i].field = column;
+      ops[i].field_by_name = false;
+      if (!ops[i].slave)
+        column++;
+    }
+}
+
+/* The member of 'state' used by an operation */
+enum field_op_state_kind
+{
+  STATE_NONE = 0,
+  STATE_MOMENTS,
+  STATE_COMOMENTS,
+  STATE_DIGEST,
+  STATE_HLL,
+  STATE_VALUE_COUNTS,
+  STATE_SAMPLE
+};
+
+static enum field_op_state_kind _GL_ATTRIBUTE_CONST
+field_op_state_kind (enum field_operation oper)
+{
+  switch (oper)
+    {
+    case OP_PSTDEV:
+    case OP_SSTDEV:
+    case OP_PVARIANCE:
+    case OP_SVARIANCE:
+    case OP_S_SKEWNESS:
+    case OP_P_SKEWNESS:
+    case OP_S_EXCESS_KURTOSIS:
+    case OP_P_EXCESS_KURTOSIS:
+    case OP_JARQUE_BERA:
+    case OP_DP_OMNIBUS:
+      return STATE_MOMENTS;
+
+    case OP_P_COVARIANCE:
+    case OP_S_COVARIANCE:
+    case OP_P_PEARSON_COR:
+    case OP_S_PEARSON_COR:
+    case OP_DOT_PRODUCT:
+      return STATE_COMOMENTS;
+
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
+      return STATE_DIGEST;
+
+    case OP_APPROX_COUNT_UNIQUE:
+      return STATE_HLL;
+
+    case OP_MODE:
+    case OP_ANTIMODE:
+      return STATE_VALUE_COUNTS;
+
+    case OP_RAND:
+    case OP_SAMPLE:
+      return STATE_SAMPLE;
+
+    case OP_INVALID:
+    case OP_COUNT:
+    case OP_SUM:
+    case OP_MIN:
+    case OP_MAX:
+    case OP_ABSMIN:
+    case OP_ABSMAX:
+    case OP_RANGE:
+    case OP_FIRST:
+    case OP_LAST:
+    case OP_MEAN:
+    case OP_GEOMEAN:
+    case OP_HARMMEAN:
+    case OP_MS:
+    case OP_RMS:
+    case OP_MEDIAN:
+    case OP_QUARTILE_1:
+    case OP_QUARTILE_3:
+    case OP_IQR:
+    case OP_PERCENTILE:
+    case OP_MAD:
+    case OP_MADRAW:
+    case OP_UNIQUE:
+    case OP_COLLAPSE:
+    case OP_COUNT_UNIQUE:
+    case OP_BASE64:
+    case OP_DEBASE64:
+    case OP_MD5:
+    case OP_SHA1:
+    case OP_SHA224:
+    case OP_SHA256:
+    case OP_SHA384:
+    case OP_SHA512:
+    case OP_BIN_BUCKETS:
+    case OP_STRBIN:
+    case OP_FLOOR:
+    case OP_CEIL:
+    case OP_ROUND:
+    case OP_TRUNCATE:
+    case OP_FRACTION:
+    case OP_TRIMMED_MEAN:
+    case OP_DIRNAME:
+    case OP_BASENAME:
+    case OP_EXTNAME:
+    case OP_BARENAME:
+    case OP_GETNUM:
+    case OP_CUT:
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+    default:
+      return STATE_NONE;
+    }
+}
+
+/* Returns true if the operation accumulates integer values exactly,
+   for as long as its values are integers */
+static inline bool
+field_op_uses_int_value (enum field_operation oper)
+{
+  return oper == OP_SUM || oper == OP_MIN || oper == OP_MAX;
+}
+
+void
+field_op_init (struct fieldop* /*out*/ op,
+               enum field_operation oper,
+               bool by_name, size_t num, const char* name)
+{
+  assert (op != NULL); /* LCOV_EXCL_LINE */
+  memset (op, 0, sizeof *op);
+
+  op->op = oper;
+  op->acc_type = operations[oper].acc_type;
+  op->res_type = operations[oper].res_type;
+  op->numeric = (op->acc_type == NUMERIC_SCALAR
+                 || op->acc_type == NUMERIC_VECTOR);
+  op->auto_first = operations[oper].auto_first;
+  op->int_exact = field_op_uses_int_value (oper);
+  op->slave = false;
+  op->slave_op = NULL;
+
+  op->field = num;
+  op->field_by_name = by_name;
+  op->field_name = (by_name)?xstrdup (name):NULL;
+  op->first = true;
+  if (op->res_type == STRING_RESULT)
+    {
+      op->out_buf_alloc = 1024;
+      op->out_buf = xmalloc (op->out_buf_alloc);
+    }
+}
+
+void
+field_op_init_copy (struct fieldop* /*out*/ op, const struct fieldop *src)
+{
+  assert (op != NULL && src != NULL); /* LCOV_EXCL_LINE */
+  memset (op, 0, sizeof *op);
+
+  op->op = src->op;
+  op->acc_type = src->acc_type;
+  op->res_type = src->res_type;
+  op->numeric = src->numeric;
+  op->auto_first = src->auto_first;
+  op->int_exact = field_op_uses_int_value (src->op);
+  op->master = src->master;
+  op->slave = src->slave;
+  op->slave_idx = src->slave_idx;
+  op->slave_op = src->slave_op;
+  op->values_op = src->values_op;
+  op->values_idx = src->values_idx;
+  op->values_shared = src->values_shared;
+  op->collect = src->collect;
+  op->collect_value = src->collect_value;
+
+  op->field = src->field;
+  op->field_by_name = false;
+  op->field_name = NULL;
+  op->params = src->params;
+  op->first = true;
+  /* The output buffer is allocated on demand by 'summarize' */
+}
+
+/* Ensure this (master) fieldop has the same number of values as
+   as it's slave fieldop. */
+static void
+verify_slave_num_values (const struct fieldop *op)
+{
+  assert (op && !op->slave && op->slave_op);     /* LCOV_EXCL_LINE */
+
+  /* A value without a matching value (from the same line) in the other
+     field, e.g. due to NAs removed with --narm, is not counted in
+     'comoments'. */
+  if (op->count != op->slave_op->count || op->state.comoments.n != op->count)
+    die (EXIT_FAILURE, 0, _("input error for operation %s: \
+fields %"PRIuMAX",%"PRIuMAX" have different number of items"),
+                            quote (get_field_operation_name (op->op)),
+                            (uintmax_t)op->slave_op->field,
+                            (uintmax_t)op->field);
+}
+
+/* Add 'x' to the sum in 'op->value', accumulating its rounding error
+   in 'op->value_comp' (Neumaier's variant of Kahan summation): the
+   compensated sum is accurate even with many values of different
+   magnitudes, including with the 'double' precision type.  */
+static inline void
+field_op_sum_add (struct fieldop *op, accum_t x)
+{
+  const accum_t t = op->value + x;
+  if (accum_fabs (op->value) >= accum_fabs (x))
+    op->value_comp += (op->value - t) + x;
+  else
+    op->value_comp += (x - t) + op->value;
+  op->value = t;
+}
+
+/* Returns the compensated sum of 'op' (the sum as-is if it is not
+   finite: the compensation is then meaningless; or without compensation,
+   keeping the sign of a zero sum) */
+static inline accum_t
+field_op_sum_value (const struct fieldop *op)
+{
+  return fpclassify (op->value_comp) != FP_ZERO && isfinite (op->value)
+         ? op->value + op->value_comp : op->value;
+}
+
+/* Continue accumulating the integer result of 'op' as a floating-point
+   value (on a non-integer value, or overflow) */
+static void
+field_op_promote_int_value (struct fieldop *op)
+{
+  op->value = op->int_value;
+  op->int_exact = false;
+}
+
+/* The functions collecting a value (from input) into each kind of
+   operation, selected once by 'field_op_bind_collect': they do not check
+   the options (e.g. N/A values with --narm are skipped before, by
+   'field_op_collect_narm'), nor the type of the operation.  */
+
+/* Parse the value of a numeric operation */
+static inline bool
+field_op_parse_number (const char *str, size_t slen, accum_t *x)
+{
+  return slen > 0 && parse_number (str, slen, x);
+}
+
+/* One more value was collected into 'op' */
+static inline enum FIELD_OP_COLLECT_RESULT
+field_op_collected (struct fieldop *op, enum FIELD_OP_COLLECT_RESULT rc)
+{
+  op->count++;
+  op->first = false;
+  return rc;
+}
+
+/* --narm: skip the N/A values, collect the others with the function
+   of the operation */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_narm (struct fieldop *op, const char *str, size_t slen)
+{
+  if (is_na (str, slen))
+    {
+      if (op->slave)
+        op->slave_value_set = false;
+      return FLOCR_OK_SKIPPED;
+    }
+  return op->collect_value (op, str, slen);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_count (struct fieldop *op, const char *str _GL_UNUSED,
+                        size_t slen _GL_UNUSED)
+{
+  op->value++;
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* sum: integer values are summed exactly in 'int_value', until the first
+   non-integer value (or overflow) */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_sum (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+
+  if (op->int_exact)
+    {
+      intmax_t v, sum;
+      if (parse_integer (str, slen, &v))
+        {
+          if (!INT_ADD_WRAPV (op->int_value, v, &sum))
+            op->int_value = sum;
+          else if (op->params.integer)
+            return FLOCR_INTEGER_OVERFLOW;
+          else
+            {
+              field_op_promote_int_value (op);
+              field_op_sum_add (op, v);
+            }
+          return field_op_collected (op, FLOCR_OK);
+        }
+      if (op->params.integer)
+        return FLOCR_INVALID_INTEGER;
+      field_op_promote_int_value (op);
+    }
+
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  field_op_sum_add (op, x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* min/max/absmin/absmax: keep the smallest ('min') or largest value
+   (of the absolute values with 'abs').  min/max compare integer values
+   exactly in 'int_value', until the first non-integer value.
+   Inlined with constant 'min' and 'abs' in the function of each op. */
+static inline enum FIELD_OP_COLLECT_RESULT
+field_op_collect_extreme (struct fieldop *op, const char *str, size_t slen,
+                          bool min, bool abs)
+{
+  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_OK;
+  accum_t x;
+
+  if (!abs && op->int_exact)
+    {
+      intmax_t v;
+      /* "-0" is kept as a (negative) floating-point zero, unless the
+         values must be integers */
+      if (parse_integer (str, slen, &v)
+          && (v != 0 || *str != '-' || op->params.integer))
+        {
+          if (op->first)
+            op->int_value = v;
+          else if (min ? v < op->int_value : v > op->int_value)
+            {
+              op->int_value = v;
+              rc = FLOCR_OK_KEEP_LINE;
+            }
+          return field_op_collected (op, rc);
+        }
+      if (op->params.integer)
+        return FLOCR_INVALID_INTEGER;
+      field_op_promote_int_value (op);
+    }
+
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+
+  const accum_t a = abs ? accum_fabs (x) : x;
+  const accum_t b = abs ? accum_fabs (op->value) : op->value;
+  if (op->first)
+    op->value = x;
+  else if (min ? a < b : a > b)
+    {
+      op->value = x;
+      rc = FLOCR_OK_KEEP_LINE;
+    }
+  return field_op_collected (op, rc);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_min (struct fieldop *op, const char *str, size_t slen)
+{
+  return field_op_collect_extreme (op, str, slen, true, false);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_max (struct fieldop *op, const char *str, size_t slen)
+{
+  return field_op_collect_extreme (op, str, slen, false, false);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_absmin (struct fieldop *op, const char *str, size_t slen)
+{
+  return field_op_collect_extreme (op, str, slen, true, true);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_absmax (struct fieldop *op, const char *str, size_t slen)
+{
+  return field_op_collect_extreme (op, str, slen, false, true);
+}
+
+/* mean */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_mean (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  field_op_sum_add (op, x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_geomean (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  field_op_sum_add (op, accum_log (x));
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_harmmean (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  field_op_sum_add (op, 1.0 / x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* ms/rms */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_squares (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  field_op_sum_add (op, x * x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_range (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+
+  /* Upon the first value, we store it twice
+     (once for min, once for max).
+     For subsequence values, we update the min/max entries directly. */
+  if (op->first)
+    {
+      field_op_add_value (op, x);
+      field_op_add_value (op, x);
+    }
+  else
+    {
+      if (x < op->values[0])
+        op->values[0] = x;
+      if (x > op->values[1])
+        op->values[1] = x;
+    }
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* stdev/variance/skewness/kurtosis/jarque/dpo */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_moments (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  moments_add (&op->state.moments, x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* median/q1/q3/iqr/perc/mad/madraw/trimmean: all the values */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_values (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  field_op_add_value (op, x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* mode/antimode */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_value_counts (struct fieldop *op, const char *str,
+                               size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  value_counts_add (&op->state.value_counts, x, 1);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* approxmedian/approxperc */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_digest (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  tdigest_add (&op->state.digest, x, op->params.approx.compression);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* pcov/scov/ppearson/spearson/dotprod: the slave op is collected first
+   (from the same line), the master op pairs its value with the slave's */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_pair_slave (struct fieldop *op, const char *str,
+                             size_t slen)
+{
+  if (!field_op_parse_number (str, slen, &op->value))
+    return FLOCR_INVALID_NUMBER;
+  op->slave_value_set = true;
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_pair_master (struct fieldop *op, const char *str,
+                              size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  if (op->slave_op->slave_value_set)
+    comoments_add (&op->state.comoments, op->slave_op->value, x);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_bin (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+
+  const accum_t val = x / op->params.bin_bucket_size;
+  const accum_t frac = accum_modf (val, & op->value);
+  /* Buckets should follow this pattern:
+     ..., [-3x,-2x), [-2x,-x), [-x,0), [0,x), [x,2x), [2x,3x), ... */
+  if (signbit (op->value))
+    {
+      if (is_zero (frac))
+          op->value = pos_zero (op->value);
+      else
+          --op->value;
+    }
+  op->value *= op->params.bin_bucket_size;
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_floor (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  op->value = pos_zero (accum_floor (x));
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_ceil (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  op->value = pos_zero (accum_ceil (x));
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_round (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  op->value = pos_zero (accum_round (x));
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_truncate (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  accum_modf (x, &op->value);
+  op->value = pos_zero (op->value);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_fraction (struct fieldop *op, const char *str, size_t slen)
+{
+  accum_t x, dummy;
+  if (!field_op_parse_number (str, slen, &x))
+    return FLOCR_INVALID_NUMBER;
+  op->value = pos_zero (accum_modf (x, &dummy));
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_first (struct fieldop *op, const char *str, size_t slen)
+{
+  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_OK;
+  if (op->first)
+    {
+      field_op_replace_string (op, str, slen);
+      rc = FLOCR_OK_KEEP_LINE;
+    }
+  return field_op_collected (op, rc);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_last (struct fieldop *op, const char *str, size_t slen)
+{
+  /* Replace the 'current' string with the latest one */
+  field_op_replace_string (op, str, slen);
+  return field_op_collected (op, FLOCR_OK_KEEP_LINE);
+}
+
+/* base64/md5/sha1-512/dirname/basename/extname/barename/cut: the result
+   of the latest string */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_string (struct fieldop *op, const char *str, size_t slen)
+{
+  /* Replace the 'current' string with the latest one */
+  field_op_replace_string (op, str, slen);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_debase64 (struct fieldop *op, const char *str, size_t slen)
+{
+  /* Base64 decoding is a special case: we decode during collection,
+     and report any errors back to the caller. */
+  /* safe to assume decoded base64 is never larger than encoded base64 */
+  idx_t decoded_size = slen;
+  field_op_reserve_out_buf (op, decoded_size);
+  if (!base64_decode ( str, slen, op->out_buf, &decoded_size ))
+    return FLOCR_INVALID_BASE64;
+  op->out_buf[decoded_size]=0;
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_rand (struct fieldop *op, const char *str, size_t slen)
+{
+  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_OK;
+  size_t slot;
+
+  /* Reservoir sampling, with k=1 */
+  op->count++;
+  if (field_op_sample_next (op, 1, &slot))
+    {
+      field_op_replace_string (op, str, slen);
+      rc = FLOCR_OK_KEEP_LINE;
+    }
+  op->first = false;
+  return rc;
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_sample (struct fieldop *op, const char *str, size_t slen)
+{
+  size_t slot;
+
+  op->count++;
+  if (field_op_sample_next (op, op->params.sample_size, &slot))
+    field_op_set_sample_string (op, slot, str, slen);
+  op->first = false;
+  return FLOCR_OK;
+}
+
+/* unique/countunique/topk/approxtopk */
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_distinct (struct fieldop *op, const char *str, size_t slen)
+{
+  field_op_add_distinct_string (op, str, slen, 1);
+  field_op_reduce_str_counts (op);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_collapse (struct fieldop *op, const char *str, size_t slen)
+{
+  field_op_add_string (op, str, slen);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_hll (struct fieldop *op, const char *str, size_t slen)
+{
+  hll_add (&op->state.hll, hash_string (str, slen, case_sensitive),
+           op->params.hll_precision);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_strbin (struct fieldop *op, const char *str, size_t slen)
+{
+  op->value = hash_pjw_bare (str,slen) % (op->params.strbin_bucket_size);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+static enum FIELD_OP_COLLECT_RESULT
+field_op_collect_getnum (struct fieldop *op, const char *str, size_t slen)
+{
+  op->value = extract_number (str, slen, op->params.get_num_type);
+  return field_op_collected (op, FLOCR_OK);
+}
+
+/* Returns the function collecting the values of 'op' */
+static field_op_collect_func _GL_ATTRIBUTE_PURE
+field_op_collect_function (const struct fieldop *op)
+{
+  switch (op->op)                                /* LCOV_EXCL_BR_LINE */
+    {
+    case OP_COUNT:
+      return field_op_collect_count;
+    case OP_SUM:
+      return field_op_collect_sum;
+    case OP_MIN:
+      return field_op_collect_min;
+    case OP_MAX:
+      return field_op_collect_max;
+    case OP_ABSMIN:
+      return field_op_collect_absmin;
+    case OP_ABSMAX:
+      return field_op_collect_absmax;
+    case OP_RANGE:
+      return field_op_collect_range;
+    case OP_MEAN:
+      return field_op_collect_mean;
+    case OP_GEOMEAN:
+      return field_op_collect_geomean;
+    case OP_HARMMEAN:
+      return field_op_collect_harmmean;
+    case OP_MS:
+    case OP_RMS:
+      return field_op_collect_squares;
+
+    case OP_PSTDEV:
+    case OP_SSTDEV:
+    case OP_PVARIANCE:
+    case OP_SVARIANCE:
+    case OP_S_SKEWNESS:
+    case OP_P_SKEWNESS:
+    case OP_S_EXCESS_KURTOSIS:
+    case OP_P_EXCESS_KURTOSIS:
+    case OP_JARQUE_BERA:
+    case OP_DP_OMNIBUS:
+      return field_op_collect_moments;
+
+    case OP_MEDIAN:
+    case OP_QUARTILE_1:
+    case OP_QUARTILE_3:
+    case OP_IQR:
+    case OP_PERCENTILE:
+    case OP_MAD:
+    case OP_MADRAW:
+    case OP_TRIMMED_MEAN:
+      return field_op_collect_values;
+
+    case OP_MODE:
+    case OP_ANTIMODE:
+      return field_op_collect_value_counts;
+
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
+      return field_op_collect_digest;
+
+    case OP_P_COVARIANCE:
+    case OP_S_COVARIANCE:
+    case OP_P_PEARSON_COR:
+    case OP_S_PEARSON_COR:
+    case OP_DOT_PRODUCT:
+      return op->slave ? field_op_collect_pair_slave
+                       : field_op_collect_pair_master;
+
+    case OP_BIN_BUCKETS:
+      return field_op_collect_bin;
+    case OP_FLOOR:
+      return field_op_collect_floor;
+    case OP_CEIL:
+      return field_op_collect_ceil;
+    case OP_ROUND:
+      return field_op_collect_round;
+    case OP_TRUNCATE:
+      return field_op_collect_truncate;
+    case OP_FRACTION:
+      return field_op_collect_fraction;
+
+    case OP_FIRST:
+      return field_op_collect_first;
+    case OP_LAST:
+      return field_op_collect_last;
+    case OP_RAND:
+      return field_op_collect_rand;
+    case OP_SAMPLE:
+      return field_op_collect_sample;
+
+    case OP_BASE64:
+    case OP_MD5:
+    case OP_SHA1:
+    case OP_SHA224:
+    case OP_SHA256:
+    case OP_SHA384:
+    case OP_SHA512:
+    case OP_DIRNAME:
+    case OP_BASENAME:
+    case OP_EXTNAME:
+    case OP_BARENAME:
+    case OP_CUT:
+      return field_op_collect_string;
+    case OP_DEBASE64:
+      return field_op_collect_debase64;
+
+    case OP_UNIQUE:
+    case OP_COUNT_UNIQUE:
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+      return field_op_collect_distinct;
+    case OP_COLLAPSE:
+      return field_op_collect_collapse;
+    case OP_APPROX_COUNT_UNIQUE:
+      return field_op_collect_hll;
+    case OP_STRBIN:
+      return field_op_collect_strbin;
+    case OP_GETNUM:
+      return field_op_collect_getnum;
+
+    case OP_INVALID:                 /* LCOV_EXCL_LINE */
+    default:                         /* LCOV_EXCL_LINE */
+      /* Should never happen */
+      internal_error ("bad op");     /* LCOV_EXCL_LINE */
+    }
+}
+
+void
+field_op_bind_collect (struct fieldop *op)
+{
+  op->collect_value = field_op_collect_function (op);
+  op->collect = remove_na_values ? field_op_collect_narm : op->collect_value;
+}
+
+/* Returns the numeric value accumulated by a scalar operation */
+static inline accum_t
+field_op_scalar_value (const struct fieldop *op)
+{
+  return op->int_exact ? op->int_value : field_op_sum_value (op);
+}
+
+/* Move the collected data of 'src' into 'op' (giving 'src' the previous
+   data and buffers of 'op', to be freed with it) */
+static void
+field_op_take (struct fieldop *op, struct fieldop *src)
+{
+  struct fieldop tmp = *op;
+  *op = *src;
+  *src = tmp;
+
+  /* Both are copies of the same field-op, except for the links
+     to the other field-ops of their group */
+  src->slave_op = op->slave_op;
+  src->values_op = op->values_op;
+  op->slave_op = tmp.slave_op;
+  op->values_op = tmp.values_op;
+}
+
+enum FIELD_OP_COLLECT_RESULT
+field_op_merge (struct fieldop *op, struct fieldop *src)
+{
+  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_OK;
+  const size_t count = op->count + src->count;
+
+  /* The values are merged by the op holding the shared values */
+  if (op->values_op || src->count == 0)
+    return FLOCR_OK;
+
+  if (op->count == 0)
+    {
+      field_op_take (op, src);
+      switch (op->op)
+        {
+        case OP_MIN:
+        case OP_MAX:
+        case OP_ABSMIN:
+        case OP_ABSMAX:
+        case OP_FIRST:
+        case OP_LAST:
+        case OP_RAND:
+          return FLOCR_OK_KEEP_LINE;
+
+        case OP_INVALID:
+        case OP_COUNT:
+        case OP_SUM:
+        case OP_RANGE:
+        case OP_MEAN:
+        case OP_GEOMEAN:
+        case OP_HARMMEAN:
+        case OP_MS:
+        case OP_RMS:
+        case OP_MEDIAN:
+        case OP_QUARTILE_1:
+        case OP_QUARTILE_3:
+        case OP_IQR:
+        case OP_PERCENTILE:
+        case OP_PSTDEV:
+        case OP_SSTDEV:
+        case OP_PVARIANCE:
+        case OP_SVARIANCE:
+        case OP_MAD:
+        case OP_MADRAW:
+        case OP_S_SKEWNESS:
+        case OP_P_SKEWNESS:
+        case OP_S_EXCESS_KURTOSIS:
+        case OP_P_EXCESS_KURTOSIS:
+        case OP_JARQUE_BERA:
+        case OP_DP_OMNIBUS:
+        case OP_MODE:
+        case OP_ANTIMODE:
+        case OP_UNIQUE:
+        case OP_COLLAPSE:
+        case OP_COUNT_UNIQUE:
+        case OP_BASE64:
+        case OP_DEBASE64:
+        case OP_MD5:
+        case OP_SHA1:
+        case OP_SHA224:
+        case OP_SHA256:
+        case OP_SHA384:
+        case OP_SHA512:
+        case OP_P_COVARIANCE:
+        case OP_S_COVARIANCE:
+        case OP_P_PEARSON_COR:
+        case OP_S_PEARSON_COR:
+        case OP_DOT_PRODUCT:
+        case OP_BIN_BUCKETS:
+        case OP_STRBIN:
+        case OP_FLOOR:
+        case OP_CEIL:
+        case OP_ROUND:
+        case OP_TRUNCATE:
+        case OP_FRACTION:
+        case OP_TRIMMED_MEAN:
+        case OP_DIRNAME:
+        case OP_BASENAME:
+        case OP_EXTNAME:
+        case OP_BARENAME:
+        case OP_GETNUM:
+        case OP_CUT:
+        case OP_APPROX_MEDIAN:
+        case OP_APPROX_PERCENTILE:
+        case OP_APPROX_COUNT_UNIQUE:
+        case OP_TOPK:
+        case OP_APPROX_TOPK:
+        case OP_SAMPLE:
+        default:
+          return FLOCR_OK;
+        }
+    }
+
+  switch (op->op)                                /* LCOV_EXCL_BR_LINE */
+    {
+    case OP_COUNT:
+      op->value += src->value;
       break;
 
+    case OP_MEAN:
     case OP_GEOMEAN:
-      op->value += logl (num_value);
+    case OP_HARMMEAN:
+    case OP_MS:
+    case OP_RMS:
+      field_op_sum_add (op, src->value);
+      op->value_comp += src->value_comp;
       break;
 
-    case OP_HARMMEAN:
-      op->value += 1.0 / num_value;
+    case OP_SUM:
+      if (op->int_exact && src->int_exact)
+        {
+          intmax_t sum;
+          if (!INT_ADD_WRAPV (op->int_value, src->int_value, &sum))
+            {
+              op->int_value = sum;
+              break;
+            }
+          if (op->params.integer)
+            return FLOCR_INTEGER_OVERFLOW;
+        }
+      if (op->int_exact)
+        field_op_promote_int_value (op);
+      if (src->int_exact)
+        field_op_sum_add (op, src->int_value);
+      else
+        {
+          field_op_sum_add (op, src->value);
+          op->value_comp += src->value_comp;
+        }
+      break;
+
+    case OP_MIN:
+    case OP_MAX:
+      if (op->int_exact && src->int_exact)
+        {
+          if (op->op == OP_MIN ? src->int_value < op->int_value
+                               : src->int_value > op->int_value)
+            {
+              op->int_value = src->int_value;
+              rc = FLOCR_OK_KEEP_LINE;
+            }
+          break;
+        }
+      {
+        const accum_t v = field_op_scalar_value (src);
+        op->value = field_op_scalar_value (op);
+        op->int_exact = false;
+        if (op->op == OP_MIN ? v < op->value : v > op->value)
+          {
+            op->value = v;
+            rc = FLOCR_OK_KEEP_LINE;
+          }
+      }
+      break;
+
+    case OP_ABSMIN:
+      if (accum_fabs (src->value) < accum_fabs (op->value))
+        {
+          op->value = src->value;
+          rc = FLOCR_OK_KEEP_LINE;
+        }
+      break;
+
+    case OP_ABSMAX:
+      if (accum_fabs (src->value) > accum_fabs (op->value))
+        {
+          op->value = src->value;
+          rc = FLOCR_OK_KEEP_LINE;
+        }
+      break;
+
+    case OP_RANGE:
+      op->values[0] = MIN (op->values[0], src->values[0]);
+      op->values[1] = MAX (op->values[1], src->values[1]);
+      break;
+
+    case OP_FIRST:
+      break;
+
+    case OP_LAST:
+      rc = FLOCR_OK_KEEP_LINE;
+      /* fall through */
+    case OP_BASE64:
+    case OP_DEBASE64:
+    case OP_MD5:
+    case OP_SHA1:
+    case OP_SHA224:
+    case OP_SHA256:
+    case OP_SHA384:
+    case OP_SHA512:
+    case OP_DIRNAME:
+    case OP_BASENAME:
+    case OP_EXTNAME:
+    case OP_BARENAME:
+    case OP_CUT:
+    case OP_BIN_BUCKETS:
+    case OP_STRBIN:
+    case OP_FLOOR:
+    case OP_CEIL:
+    case OP_ROUND:
+    case OP_TRUNCATE:
+    case OP_FRACTION:
+    case OP_GETNUM:
+      /* The result of the last value */
+      field_op_take (op, src);
+      break;
+
+    case OP_RAND:
+      {
+        /* Reservoir sampling: keep a value of 'src' with a probability
+           proportional to its number of values */
+        if (random_range (count) < src->count)
+          {
+            field_op_take (op, src);
+            rc = FLOCR_OK_KEEP_LINE;
+          }
+      }
+      break;
+
+    case OP_PSTDEV:
+    case OP_SSTDEV:
+    case OP_PVARIANCE:
+    case OP_SVARIANCE:
+    case OP_S_SKEWNESS:
+    case OP_P_SKEWNESS:
+    case OP_S_EXCESS_KURTOSIS:
+    case OP_P_EXCESS_KURTOSIS:
+    case OP_JARQUE_BERA:
+    case OP_DP_OMNIBUS:
+      moments_merge (&op->state.moments, &src->state.moments);
+      break;
+
+    case OP_MEDIAN:
+    case OP_QUARTILE_1:
+    case OP_QUARTILE_3:
+    case OP_IQR:
+    case OP_PERCENTILE:
+    case OP_MAD:
+    case OP_MADRAW:
+    case OP_TRIMMED_MEAN:
+      if (op->num_values + src->num_values > op->alloc_values)
+        {
+          op->alloc_values = op->num_values + src->num_values;
+          op->values = xnrealloc (op->values, op->alloc_values,
+                                  sizeof (accum_t));
+        }
+      memcpy (op->values + op->num_values, src->values,
+              src->num_values * sizeof (accum_t));
+      op->num_values += src->num_values;
+      op->values_ordered = false;
+      break;
+
+    case OP_MODE:
+    case OP_ANTIMODE:
+      value_counts_merge (&op->state.value_counts, &src->state.value_counts);
+      break;
+
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
+      tdigest_merge (&op->state.digest, &src->state.digest,
+                     op->params.approx.compression);
+      break;
+
+    case OP_APPROX_COUNT_UNIQUE:
+      hll_merge (&op->state.hll, &src->state.hll, op->params.hll_precision);
+      break;
+
+    case OP_P_COVARIANCE:
+    case OP_S_COVARIANCE:
+    case OP_P_PEARSON_COR:
+    case OP_S_PEARSON_COR:
+    case OP_DOT_PRODUCT:
+      if (op->slave)
+        op->value = src->value;
+      else
+        comoments_merge (&op->state.comoments, &src->state.comoments);
+      break;
+
+    case OP_UNIQUE:
+    case OP_COUNT_UNIQUE:
+      for (const char *p = src->str_buf; p < src->str_buf + src->str_buf_used;
+           p += strlen (p) + 1)
+        field_op_add_distinct_string (op, p, strlen (p), 1);
+      break;
+
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+      for (size_t i = 0; i < src->str_set_alloc; ++i)
+        if (src->str_set[i])
+          {
+            const char *p = src->str_buf + src->str_set[i] - 1;
+            field_op_add_distinct_string (op, p, strlen (p),
+                                          src->str_counts[i]);
+            field_op_reduce_str_counts (op);
+          }
+      op->str_counts_error += src->str_counts_error;
+      break;
+
+    case OP_SAMPLE:
+      field_op_merge_sample (op, src);
+      break;
+
+    case OP_COLLAPSE:
+      /* The strings of 'src' follow those of 'op', as if collected
+         one by one */
+      field_op_reserve_str_buf (op, op->str_buf_used + src->str_buf_used);
+      memcpy (op->str_buf + op->str_buf_used, src->str_buf,
+              src->str_buf_used);
+      op->str_buf_used += src->str_buf_used;
+      break;
+
+    case OP_INVALID:                 /* LCOV_EXCL_LINE */
+    default:                         /* LCOV_EXCL_LINE */
+      /* Should never happen */
+      internal_error ("bad op");     /* LCOV_EXCL_LINE */
+    }
+
+  op->count = count;
+  op->first = false;
+  return rc;
+}
+
+/* Partial results (--emit-partial, --merge-partial).
+
+   The state of an operation is a list of items separated by slashes:
+   the number of values collected, followed by the data of the operation
+   (e.g. the sum, the moments, or all the values of a median).
+   Numbers are written exactly, in hexadecimal floating-point
+   (e.g. '0x1.8p+1'), or as decimal integers (the exact sum/min/max of
+   integers).  Strings are encoded in base64, with '-' and '_' instead of
+   '+' and '/'.  The states thus contain no blanks, and none of the usual
+   field delimiters. */
+
+#define PARTIAL_SEPARATOR '/'
+
+bool field_op_emit_partial = false;
+
+bool _GL_ATTRIBUTE_PURE
+field_op_partial_char (int c)
+{
+  return c_isalnum (c) || (c != '\0' && strchr ("+-./=_", c) != NULL);
+}
+
+/* Append an item of 'len' bytes to the partial state in op->out_buf,
+   returns the position of the item (to be filled by the caller) */
+static char *
+partial_add_item (struct fieldop *op, size_t len)
+{
+  const size_t size = op->out_buf_used + len + 2;
+  if (size > op->out_buf_alloc)
+    field_op_reserve_out_buf (op, MAX (size, op->out_buf_alloc * 2));
+
+  if (op->out_buf_used > 0)
+    op->out_buf[op->out_buf_used++] = PARTIAL_SEPARATOR;
+  char *item = op->out_buf + op->out_buf_used;
+  op->out_buf_used += len;
+  op->out_buf[op->out_buf_used] = '\0';
+  return item;
+}
+
+static void
+partial_add_uint (struct fieldop *op, uintmax_t n)
+{
+  char buf[INT_BUFSIZE_BOUND (uintmax_t)];
+  const int len = sprintf (buf, "%"PRIuMAX, n);
+  memcpy (partial_add_item (op, len), buf, len);
+}
+
+static void
+partial_add_int (struct fieldop *op, intmax_t n)
+{
+  char buf[INT_BUFSIZE_BOUND (intmax_t)];
+  const int len = sprintf (buf, "%"PRIdMAX, n);
+  memcpy (partial_add_item (op, len), buf, len);
+}
+
+static void
+partial_add_number (struct fieldop *op, accum_t x)
+{
+  char buf[64];
+#ifdef ACCUM_DOUBLE
+  const int len = snprintf (buf, sizeof buf, "%a", x);
+#else
+  const int len = snprintf (buf, sizeof buf, "%La", x);
+#endif
+  memcpy (partial_add_item (op, len), buf, len);
+}
+
+static void
+partial_add_string (struct fieldop *op, const char *str, size_t slen)
+{
+  const size_t len = BASE64_LENGTH (slen);
+  char *item = partial_add_item (op, len);
+  base64_encode (str, slen, item, len);
+  for (size_t i = 0; i < len; ++i)
+    if (item[i] == '+')
+      item[i] = '-';
+    else if (item[i] == '/')
+      item[i] = '_';
+}
+
+/* Stores in op->out_buf the state of the operation (--emit-partial),
+   to be loaded with field_op_load_partial */
+static void
+field_op_summarize_partial (struct fieldop *op)
+{
+  /* Ops sharing values print them all, as their states are loaded
+     independently of each other */
+  struct fieldop *vop = field_op_values_op (op);
+  size_t count = vop->count;
+
+  /* Unique values: only the distinct strings are written */
+  if (op->op == OP_UNIQUE || op->op == OP_COUNT_UNIQUE)
+    count = op->str_set_used;
+
+  op->out_buf_used = 0;
+  partial_add_uint (op, count);
+
+  /* The state of pcov etc. includes the number of values of the slave op
+     (which has no state of its own) */
+  if (op->master)
+    partial_add_uint (op, op->slave_op->count);
+
+  if (count == 0)
+    return;
+
+  switch (op->op)                                /* LCOV_EXCL_BR_LINE */
+    {
+    case OP_COUNT:
+      /* The number of values is the result */
       break;
 
+    case OP_MEAN:
+    case OP_GEOMEAN:
+    case OP_HARMMEAN:
     case OP_MS:
     case OP_RMS:
-      op->value += num_value * num_value;
+      partial_add_number (op, field_op_sum_value (op));
+      break;
+
+    case OP_ABSMIN:
+    case OP_ABSMAX:
+      partial_add_number (op, op->value);
+      break;
+
+    case OP_SUM:
+    case OP_MIN:
+    case OP_MAX:
+      if (op->int_exact)
+        partial_add_int (op, op->int_value);
+      else
+        partial_add_number (op, field_op_sum_value (op));
+      break;
+
+    case OP_RANGE:
+      partial_add_number (op, op->values[0]);
+      partial_add_number (op, op->values[1]);
+      break;
+
+    case OP_FIRST:
+    case OP_LAST:
+    case OP_RAND:
+      partial_add_string (op, op->str_buf, op->str_buf_used - 1);
+      break;
+
+    case OP_PSTDEV:
+    case OP_SSTDEV:
+    case OP_PVARIANCE:
+    case OP_SVARIANCE:
+    case OP_S_SKEWNESS:
+    case OP_P_SKEWNESS:
+    case OP_S_EXCESS_KURTOSIS:
+    case OP_P_EXCESS_KURTOSIS:
+    case OP_JARQUE_BERA:
+    case OP_DP_OMNIBUS:
+      partial_add_number (op, op->state.moments.mean);
+      partial_add_number (op, op->state.moments.m2);
+      partial_add_number (op, op->state.moments.m3);
+      partial_add_number (op, op->state.moments.m4);
       break;
 
-    case OP_COUNT:
-      op->value++;
+    case OP_MEDIAN:
+    case OP_QUARTILE_1:
+    case OP_QUARTILE_3:
+    case OP_IQR:
+    case OP_PERCENTILE:
+    case OP_MAD:
+    case OP_MADRAW:
+    case OP_TRIMMED_MEAN:
+      for (size_t i = 0; i < vop->num_values; ++i)
+        partial_add_number (op, vop->values[i]);
       break;
 
-    case OP_MIN:
-      if (num_value < op->value)
-        {
-          op->value = num_value;
-          rc = FLOCR_OK_KEEP_LINE;
-        }
+    case OP_MODE:
+    case OP_ANTIMODE:
+      /* The distinct values, and their numbers of occurrences */
+      partial_add_uint (op, op->state.value_counts.num_values);
+      for (size_t i = 0; i < op->state.value_counts.alloc; ++i)
+        if (op->state.value_counts.counts[i])
+          {
+            partial_add_number (op, op->state.value_counts.values[i]);
+            partial_add_uint (op, op->state.value_counts.counts[i]);
+          }
       break;
 
-    case OP_MAX:
-      if (num_value > op->value)
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
+      /* The centroids (the infinite values as the first and last),
+         then the values not merged into them yet */
+      partial_add_number (op, op->state.digest.min);
+      partial_add_number (op, op->state.digest.max);
+      partial_add_uint (op, op->state.digest.num_centroids
+                            + (op->state.digest.neg_inf > 0)
+                            + (op->state.digest.pos_inf > 0));
+      if (op->state.digest.neg_inf)
         {
-          op->value = num_value;
-          rc = FLOCR_OK_KEEP_LINE;
+          partial_add_number (op, -INFINITY);
+          partial_add_uint (op, op->state.digest.neg_inf);
         }
-      break;
-
-    case OP_ABSMIN:
-      if (fabsl (num_value) < fabsl (op->value))
+      for (size_t i = 0; i < op->state.digest.num_centroids; ++i)
         {
-          op->value = num_value;
-          rc = FLOCR_OK_KEEP_LINE;
+          partial_add_number (op, op->state.digest.means[i]);
+          partial_add_uint (op, op->state.digest.weights[i]);
         }
-      break;
-
-    case OP_ABSMAX:
-      if (fabsl (num_value) > fabsl (op->value))
+      if (op->state.digest.pos_inf)
         {
-          op->value = num_value;
-          rc = FLOCR_OK_KEEP_LINE;
+          partial_add_number (op, INFINITY);
+          partial_add_uint (op, op->state.digest.pos_inf);
         }
+      for (size_t i = 0; i < op->state.digest.num_buffered; ++i)
+        partial_add_number (op, op->state.digest.buffer[i]);
       break;
 
-    case OP_RANGE:
-      /* Upon the first value, we store it twice
-         (once for min, once for max).
-         For subsequence values, we update the min/max entries directly. */
-      if (op->first)
+    case OP_APPROX_COUNT_UNIQUE:
+      /* The registers (plus one, as a string without nul bytes),
+         or the sparse entries */
+      if (op->state.hll.registers)
         {
-          field_op_add_value (op, num_value);
-          field_op_add_value (op, num_value);
+          const size_t m = (size_t) 1 << op->params.hll_precision;
+          char *regs = xmalloc (m);
+          for (size_t i = 0; i < m; ++i)
+            regs[i] = op->state.hll.registers[i] + 1;
+          partial_add_uint (op, 1);
+          partial_add_string (op, regs, m);
+          free (regs);
         }
       else
         {
-          if (num_value < op->values[0])
-            op->values[0] = num_value;
-          if (num_value > op->values[1])
-            op->values[1] = num_value;
+          partial_add_uint (op, 0);
+          partial_add_uint (op, op->state.hll.num_sparse);
+          for (size_t i = 0; i < op->state.hll.num_sparse; ++i)
+            partial_add_uint (op, op->state.hll.sparse[i]);
         }
       break;
 
-    case OP_FIRST:
-      if (op->first)
-        {
-          field_op_replace_string (op, str, slen);
-          rc = FLOCR_OK_KEEP_LINE;
-        }
+    case OP_P_COVARIANCE:
+    case OP_S_COVARIANCE:
+    case OP_P_PEARSON_COR:
+    case OP_S_PEARSON_COR:
+    case OP_DOT_PRODUCT:
+      partial_add_uint (op, op->state.comoments.n);
+      partial_add_number (op, op->state.comoments.mean_x);
+      partial_add_number (op, op->state.comoments.mean_y);
+      partial_add_number (op, op->state.comoments.m2_x);
+      partial_add_number (op, op->state.comoments.m2_y);
+      partial_add_number (op, op->state.comoments.c_xy);
+      partial_add_number (op, op->state.comoments.sum_xy);
+      break;
+
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+      /* The distinct strings and their counts (approxtopk: after the most
+         the counts may be low by) */
+      if (op->op == OP_APPROX_TOPK)
+        partial_add_uint (op, op->str_counts_error);
+      partial_add_uint (op, op->str_set_used);
+      for (size_t i = 0; i < op->str_set_alloc; ++i)
+        if (op->str_set[i])
+          {
+            const char *p = op->str_buf + op->str_set[i] - 1;
+            partial_add_string (op, p, strlen (p));
+            partial_add_uint (op, op->str_counts[i]);
+          }
       break;
 
-    case OP_LAST:
-      /* Replace the 'current' string with the latest one */
-      field_op_replace_string (op, str, slen);
-      rc = FLOCR_OK_KEEP_LINE;
+    case OP_UNIQUE:
+    case OP_COUNT_UNIQUE:
+    case OP_COLLAPSE:
+      for (const char *p = op->str_buf; p < op->str_buf + op->str_buf_used;
+           p += strlen (p) + 1)
+        partial_add_string (op, p, strlen (p));
       break;
 
-    case OP_DEBASE64:
-      /* Base64 decoding is a special case: we decode during collection,
-         and report any errors back to the caller. */
-      {
-        /* safe to assume decoded base64 is never larger than encoded base64 */
-        idx_t decoded_size = slen;
-        field_op_reserve_out_buf (op, decoded_size);
-        if (!base64_decode ( str, slen, op->out_buf, &decoded_size ))
-          return FLOCR_INVALID_BASE64;
-        op->out_buf[decoded_size]=0;
-      }
+    case OP_SAMPLE:
+      for (size_t i = 0; i < op->state.sample.used; ++i)
+        {
+          const char *p = op->str_buf + op->state.sample.offsets[i];
+          partial_add_string (op, p, strlen (p));
+        }
       break;
 
+    case OP_INVALID:
     case OP_BASE64:
+    case OP_DEBASE64:
     case OP_MD5:
     case OP_SHA1:
     case OP_SHA224:
     case OP_SHA256:
     case OP_SHA384:
     case OP_SHA512:
+    case OP_BIN_BUCKETS:
+    case OP_STRBIN:
+    case OP_FLOOR:
+    case OP_CEIL:
+    case OP_ROUND:
+    case OP_TRUNCATE:
+    case OP_FRACTION:
     case OP_DIRNAME:
     case OP_BASENAME:
     case OP_EXTNAME:
     case OP_BARENAME:
-      /* Replace the 'current' string with the latest one */
-      field_op_replace_string (op, str, slen);
-      break;
+    case OP_GETNUM:
+    case OP_CUT:
+    default:                         /* LCOV_EXCL_LINE */
+      /* Should never happen: not a grouping operation */
+      internal_error ("bad op");     /* LCOV_EXCL_LINE */
+    }
+}
 
-    case OP_RAND:
-      {
-        /* Reservoir sampling,
-           With a simpler case were "k=1" */
-        unsigned long i = random ()%op->count;
-        if (op->first || i==0)
-          {
-            field_op_replace_string (op, str, slen);
-            rc = FLOCR_OK_KEEP_LINE;
-          }
-      }
-      break;
+/* Get the next item of a partial state ('*pos', up to 'end'), and
+   advance '*pos' past it ('*pos' is NULL after the last item).
+   Returns false if there are no more items. */
+static bool
+partial_get_item (const char **pos, const char *end,
+                  const char **item, size_t *len)
+{
+  if (*pos == NULL)
+    return false;
+
+  const char *sep = memchr (*pos, PARTIAL_SEPARATOR, end - *pos);
+  *item = *pos;
+  *len = (sep ? sep : end) - *pos;
+  *pos = sep ? sep + 1 : NULL;
+  return true;
+}
 
-    case OP_MEDIAN:
-    case OP_QUARTILE_1:
-    case OP_QUARTILE_3:
-    case OP_IQR:
-    case OP_PERCENTILE:
-    case OP_PSTDEV:
-    case OP_SSTDEV:
-    case OP_PVARIANCE:
-    case OP_SVARIANCE:
-    case OP_MAD:
-    case OP_MADRAW:
-    case OP_S_SKEWNESS:
-    case OP_P_SKEWNESS:
-    case OP_S_EXCESS_KURTOSIS:
-    case OP_P_EXCESS_KURTOSIS:
-    case OP_JARQUE_BERA:
-    case OP_DP_OMNIBUS:
-    case OP_MODE:
-    case OP_ANTIMODE:
-    case OP_P_COVARIANCE:
-    case OP_S_COVARIANCE:
-    case OP_P_PEARSON_COR:
-    case OP_S_PEARSON_COR:
-    case OP_DOT_PRODUCT:
-    case OP_TRIMMED_MEAN:
-      field_op_add_value (op, num_value);
-      break;
+/* Get the next item as a nul-terminated string in 'buf' */
+static bool
+partial_get_token (const char **pos, const char *end,
+                   char *buf, size_t bufsize)
+{
+  const char *item;
+  size_t len;
+
+  if (!partial_get_item (pos, end, &item, &len)
+      || len == 0 || len >= bufsize)
+    return false;
+  memcpy (buf, item, len);
+  buf[len] = '\0';
+  return true;
+}
 
-    case OP_UNIQUE:
-    case OP_COLLAPSE:
-    case OP_COUNT_UNIQUE:
-      field_op_add_string (op, str, slen);
-      break;
+static bool
+partial_get_uint (const char **pos, const char *end, uintmax_t *n)
+{
+  char buf[INT_BUFSIZE_BOUND (uintmax_t)];
+  char *endptr;
+
+  if (!partial_get_token (pos, end, buf, sizeof buf) || !c_isdigit (buf[0]))
+    return false;
+  errno = 0;
+  *n = strtoumax (buf, &endptr, 10);
+  return errno == 0 && *endptr == '\0';
+}
 
-    case OP_BIN_BUCKETS:
+static bool
+partial_get_number (const char **pos, const char *end, accum_t *x)
+{
+  char buf[64];
+  char *endptr;
+
+  if (!partial_get_token (pos, end, buf, sizeof buf))
+    return false;
+  *x = accum_strto (buf, &endptr);
+  return *endptr == '\0';
+}
+
+/* Get the value of sum/min/max: an exact integer, or a number */
+static bool
+partial_get_scalar (const char **pos, const char *end, struct fieldop *op)
+{
+  const char *item;
+  size_t len;
+  const char *p = *pos;
+
+  if (!partial_get_item (&p, end, &item, &len))
+    return false;
+  op->int_exact = parse_integer (item, len, &op->int_value);
+  if (op->int_exact)
+    {
+      *pos = p;
+      return true;
+    }
+  return !op->params.integer && partial_get_number (pos, end, &op->value);
+}
+
+/* Add the next item (a base64 string) to the strings of 'op' */
+static bool
+partial_get_string (const char **pos, const char *end, struct fieldop *op)
+{
+  const char *item;
+  size_t len;
+
+  if (!partial_get_item (pos, end, &item, &len))
+    return false;
+
+  /* Back to the standard base64 alphabet, in the (unused) output buffer */
+  field_op_reserve_out_buf (op, len + 1);
+  for (size_t i = 0; i < len; ++i)
+    op->out_buf[i] = item[i] == '-' ? '+' : item[i] == '_' ? '/' : item[i];
+
+  /* The decoded string is never longer than the encoded one */
+  idx_t decoded_size = len;
+  field_op_reserve_str_buf (op, op->str_buf_used + len + 1);
+  if (!base64_decode (op->out_buf, len, op->str_buf + op->str_buf_used,
+                      &decoded_size)
+      || memchr (op->str_buf + op->str_buf_used, '\0', decoded_size))
+    return false;
+  op->str_buf[op->str_buf_used + decoded_size] = '\0';
+  op->str_buf_used += decoded_size + 1;
+  return true;
+}
+
+enum FIELD_OP_COLLECT_RESULT
+field_op_load_partial (struct fieldop *op, const char* str, size_t slen)
+{
+  const char *pos = str;
+  const char *end = str + slen;
+  uintmax_t count, slave_count = 0;
+  struct fieldop src;
+  bool ok = true;
+
+  /* Shared values are loaded by the op holding them, the values of a
+     slave op by its master */
+  if (op->values_op || op->slave)
+    return FLOCR_OK;
+
+  if (!partial_get_uint (&pos, end, &count)
+      || (op->master && !partial_get_uint (&pos, end, &slave_count)))
+    return FLOCR_INVALID_PARTIAL;
+
+  field_op_init_copy (&src, op);
+  src.count = count;
+  src.first = false;
+
+  if (count > 0)
+    switch (op->op)                              /* LCOV_EXCL_BR_LINE */
       {
-        const long double val = num_value / op->params.bin_bucket_size;
-        const long double frac = modfl (val, & op->value);
-        /* Buckets should follow this pattern:
-           ..., [-3x,-2x), [-2x,-x), [-x,0), [0,x), [x,2x), [2x,3x), ... */
-        if (signbit (op->value))
+      case OP_COUNT:
+        src.value = count;
+        break;
+
+      case OP_MEAN:
+      case OP_GEOMEAN:
+      case OP_HARMMEAN:
+      case OP_MS:
+      case OP_RMS:
+      case OP_ABSMIN:
+      case OP_ABSMAX:
+        ok = partial_get_number (&pos, end, &src.value);
+        break;
+
+      case OP_SUM:
+      case OP_MIN:
+      case OP_MAX:
+        ok = partial_get_scalar (&pos, end, &src);
+        break;
+
+      case OP_RANGE:
+        {
+          accum_t min, max;
+          ok = partial_get_number (&pos, end, &min)
+               && partial_get_number (&pos, end, &max);
+          if (ok)
+            {
+              field_op_add_value (&src, min);
+              field_op_add_value (&src, max);
+            }
+        }
+        break;
+
+      case OP_FIRST:
+      case OP_LAST:
+      case OP_RAND:
+        ok = partial_get_string (&pos, end, &src);
+        break;
+
+      case OP_PSTDEV:
+      case OP_SSTDEV:
+      case OP_PVARIANCE:
+      case OP_SVARIANCE:
+      case OP_S_SKEWNESS:
+      case OP_P_SKEWNESS:
+      case OP_S_EXCESS_KURTOSIS:
+      case OP_P_EXCESS_KURTOSIS:
+      case OP_JARQUE_BERA:
+      case OP_DP_OMNIBUS:
+        src.state.moments.n = count;
+        ok = partial_get_number (&pos, end, &src.state.moments.mean)
+             && partial_get_number (&pos, end, &src.state.moments.m2)
+             && partial_get_number (&pos, end, &src.state.moments.m3)
+             && partial_get_number (&pos, end, &src.state.moments.m4);
+        break;
+
+      case OP_MEDIAN:
+      case OP_QUARTILE_1:
+      case OP_QUARTILE_3:
+      case OP_IQR:
+      case OP_PERCENTILE:
+      case OP_MAD:
+      case OP_MADRAW:
+      case OP_TRIMMED_MEAN:
+        for (uintmax_t i = 0; i < count && ok; ++i)
           {
-            if (is_zero (frac))
-                op->value = pos_zero (op->value);
-            else
-                --op->value;
+            accum_t x;
+            ok = partial_get_number (&pos, end, &x);
+            if (ok)
+              field_op_add_value (&src, x);
           }
-        op->value *= op->params.bin_bucket_size;
-      }
-      break;
+        break;
 
-    case OP_STRBIN:
-      op->value = hash_pjw_bare (str,slen) % (op->params.strbin_bucket_size);
-      break;
+      case OP_MODE:
+      case OP_ANTIMODE:
+        {
+          /* The numbers of occurrences must add up to the count */
+          uintmax_t num_values, n, total = 0;
+          accum_t x;
+          ok = partial_get_uint (&pos, end, &num_values)
+               && num_values > 0 && num_values <= count;
+          for (uintmax_t i = 0; i < num_values && ok; ++i)
+            {
+              ok = partial_get_number (&pos, end, &x)
+                   && partial_get_uint (&pos, end, &n)
+                   && n > 0 && n <= count - total;
+              if (ok)
+                {
+                  value_counts_add (&src.state.value_counts, x, n);
+                  total += n;
+                }
+            }
+          ok = ok && total == count;
+        }
+        break;
 
-    case OP_FLOOR:
-      op->value = pos_zero (floorl (num_value));
-      break;
+      case OP_APPROX_MEDIAN:
+      case OP_APPROX_PERCENTILE:
+        {
+          accum_t min, max, x, prev = -INFINITY;
+          uintmax_t num_centroids, weight, total = 0;
+          ok = partial_get_number (&pos, end, &min)
+               && partial_get_number (&pos, end, &max)
+               && partial_get_uint (&pos, end, &num_centroids);
+          for (uintmax_t i = 0; i < num_centroids && ok; ++i)
+            {
+              ok = partial_get_number (&pos, end, &x)
+                   && partial_get_uint (&pos, end, &weight)
+                   && weight > 0 && weight <= count - total
+                   && x >= prev;
+              if (ok)
+                {
+                  tdigest_add_centroid (&src.state.digest, x, weight);
+                  total += weight;
+                  prev = x;
+                }
+            }
+          for (uintmax_t i = total; i < count && ok; ++i)
+            {
+              ok = partial_get_number (&pos, end, &x);
+              if (ok)
+                tdigest_add (&src.state.digest, x,
+                             op->params.approx.compression);
+            }
+          ok = ok && min <= src.state.digest.min
+               && max >= src.state.digest.max;
+          src.state.digest.min = min;
+          src.state.digest.max = max;
+        }
+        break;
 
-    case OP_CEIL:
-      op->value = pos_zero (ceill (num_value));
-      break;
+      case OP_APPROX_COUNT_UNIQUE:
+        {
+          const unsigned int precision = op->params.hll_precision;
+          uintmax_t dense, n, entry;
+          ok = partial_get_uint (&pos, end, &dense) && dense <= 1;
+          if (ok && dense)
+            {
+              const size_t m = (size_t) 1 << precision;
+              ok = partial_get_string (&pos, end, &src)
+                   && src.str_buf_used == m + 1;
+              unsigned char *regs = (unsigned char *) src.str_buf;
+              for (size_t i = 0; i < m && ok; ++i)
+                ok = regs[i]-- >= 1 && regs[i] <= 64 - precision + 1;
+              if (ok)
+                hll_add_registers (&src.state.hll, regs, precision);
+            }
+          else if (ok)
+            {
+              ok = partial_get_uint (&pos, end, &n) && n <= count;
+              for (uintmax_t i = 0; i < n && ok; ++i)
+                {
+                  ok = partial_get_uint (&pos, end, &entry)
+                       && entry <= UINT32_MAX
+                       && hll_sparse_entry_valid (entry);
+                  if (ok)
+                    hll_add_sparse_entry (&src.state.hll, entry, precision);
+                }
+            }
+        }
+        break;
 
-    case OP_ROUND:
-      op->value = pos_zero (roundl (num_value));
-      break;
+      case OP_P_COVARIANCE:
+      case OP_S_COVARIANCE:
+      case OP_P_PEARSON_COR:
+      case OP_S_PEARSON_COR:
+      case OP_DOT_PRODUCT:
+        {
+          uintmax_t n;
+          ok = partial_get_uint (&pos, end, &n)
+               && partial_get_number (&pos, end, &src.state.comoments.mean_x)
+               && partial_get_number (&pos, end, &src.state.comoments.mean_y)
+               && partial_get_number (&pos, end, &src.state.comoments.m2_x)
+               && partial_get_number (&pos, end, &src.state.comoments.m2_y)
+               && partial_get_number (&pos, end, &src.state.comoments.c_xy)
+               && partial_get_number (&pos, end, &src.state.comoments.sum_xy);
+          src.state.comoments.n = n;
+        }
+        break;
 
-    case OP_TRUNCATE:
-      modfl (num_value, &op->value);
-      op->value = pos_zero (op->value);
-      break;
+      case OP_UNIQUE:
+      case OP_COUNT_UNIQUE:
+        for (uintmax_t i = 0; i < count && ok; ++i)
+          ok = partial_get_string (&pos, end, &src);
+        if (ok)
+          {
+            /* Add the strings as if collected (so they are also distinct
+               with a different --ignore-case) */
+            char *strs = src.str_buf;
+            const size_t used = src.str_buf_used;
+            src.str_buf = NULL;
+            src.str_buf_used = src.str_buf_alloc = 0;
+            for (const char *p = strs; p < strs + used; p += strlen (p) + 1)
+              field_op_add_distinct_string (&src, p, strlen (p), 1);
+            free (strs);
+          }
+        break;
 
-    case OP_FRACTION:
-      {
-        long double dummy;
-        op->value = pos_zero (modfl (num_value, &dummy));
-      };
-      break;
+      case OP_COLLAPSE:
+        for (uintmax_t i = 0; i < count && ok; ++i)
+          ok = partial_get_string (&pos, end, &src);
+        break;
 
-    case OP_GETNUM:
-      op->value = extract_number (str, slen, op->params.get_num_type);
-      break;
+      case OP_SAMPLE:
+        /* The sampled strings: all the values, up to the sample size */
+        for (uintmax_t i = 0; i < MIN (count, op->params.sample_size) && ok;
+             ++i)
+          {
+            const size_t offset = src.str_buf_used;
+            ok = partial_get_string (&pos, end, &src);
+            if (ok)
+              {
+                if (src.state.sample.used == src.state.sample.alloc)
+                  src.state.sample.offsets =
+                    x2nrealloc (src.state.sample.offsets,
+                                &src.state.sample.alloc, sizeof (size_t));
+                src.state.sample.offsets[src.state.sample.used++] = offset;
+                src.state.sample.bytes = src.str_buf_used;
+              }
+          }
+        break;
 
-    case OP_CUT:
-      field_op_replace_string (op, str, slen);
-      break;
+      case OP_TOPK:
+      case OP_APPROX_TOPK:
+        {
+          /* The counts must add up to the number of values (approxtopk:
+             the reduced counts, to at most the number of values) */
+          uintmax_t error = 0, num_strings, n, total = 0;
+          size_t *counts = NULL;
+          ok = (op->op != OP_APPROX_TOPK
+                || (partial_get_uint (&pos, end, &error) && error <= count))
+               && partial_get_uint (&pos, end, &num_strings)
+               && num_strings <= count;
+          if (ok)
+            counts = XNMALLOC (num_strings, size_t);
+          for (uintmax_t i = 0; i < num_strings && ok; ++i)
+            {
+              ok = partial_get_string (&pos, end, &src)
+                   && partial_get_uint (&pos, end, &n)
+                   && n > 0 && n <= count - total;
+              if (ok)
+                {
+                  counts[i] = n;
+                  total += n;
+                }
+            }
+          ok = ok && (op->op == OP_APPROX_TOPK || total == count);
+          if (ok)
+            {
+              /* Add the strings as if collected */
+              char *strs = src.str_buf;
+              const size_t used = src.str_buf_used;
+              size_t i = 0;
+              src.str_buf = NULL;
+              src.str_buf_used = src.str_buf_alloc = 0;
+              for (const char *p = strs; p < strs + used; p += strlen (p) + 1)
+                {
+                  field_op_add_distinct_string (&src, p, strlen (p),
+                                                counts[i++]);
+                  field_op_reduce_str_counts (&src);
+                }
+              src.str_counts_error += error;
+              free (strs);
+            }
+          free (counts);
+        }
+        break;
+
+      case OP_INVALID:
+      case OP_BASE64:
+      case OP_DEBASE64:
+      case OP_MD5:
+      case OP_SHA1:
+      case OP_SHA224:
+      case OP_SHA256:
+      case OP_SHA384:
+      case OP_SHA512:
+      case OP_BIN_BUCKETS:
+      case OP_STRBIN:
+      case OP_FLOOR:
+      case OP_CEIL:
+      case OP_ROUND:
+      case OP_TRUNCATE:
+      case OP_FRACTION:
+      case OP_DIRNAME:
+      case OP_BASENAME:
+      case OP_EXTNAME:
+      case OP_BARENAME:
+      case OP_GETNUM:
+      case OP_CUT:
+      default:                       /* LCOV_EXCL_LINE */
+        /* Should never happen: not a grouping operation */
+        internal_error ("bad op");   /* LCOV_EXCL_LINE */
+      }
 
-    case OP_INVALID:                 /* LCOV_EXCL_LINE */
-    default:                         /* LCOV_EXCL_LINE */
-      /* Should never happen */
-      internal_error ("bad op");     /* LCOV_EXCL_LINE */
+  /* All the items must be used */
+  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_INVALID_PARTIAL;
+  if (ok && pos == NULL)
+    {
+      if (op->master)
+        op->slave_op->count += slave_count;
+      rc = field_op_merge (op, &src);
     }
-
-  op->first = false;
-
+  field_op_free (&src);
   return rc;
 }
 
-/* creates a list of unique strings from op->str_buf .
+/* creates a list of the distinct strings from op->str_buf, sorted,
+   separated by the collapse separator.
    results are stored in op->out_buf. */
 static void
 unique_value ( struct fieldop *op, bool case_sensitive )
 {
-  const char *last_str;
-  char *pos;
-
   const char **ptrs = field_op_get_string_ptrs (op, true, case_sensitive);
 
-  /* Uniquify them */
   field_op_reserve_out_buf (op, op->str_buf_used);
-  pos = op->out_buf ;
+  char *pos = op->out_buf ;
 
-  /* Copy the first string */
-  last_str = ptrs[0];
-  strcpy (pos, ptrs[0]);
-  pos += strlen (ptrs[0]);
-
-  /* Copy the following strings, if they are different from the previous one */
-  for (size_t i = 1; i < op->count; ++i)
+  for (size_t i = 0; i < op->str_set_used; ++i)
     {
-      const char *newstr = ptrs[i];
-
-      if ((case_sensitive && (!STREQ (newstr, last_str)))
-          || (!case_sensitive && (strcasecmp (newstr, last_str)!=0)))
-        {
-          *pos++ = collapse_separator ;
-          strcpy (pos, newstr);
-          pos += strlen (newstr);
-        }
-      last_str = newstr;
+      if (i > 0)
+        *pos++ = collapse_separator ;
+      strcpy (pos, ptrs[i]);
+      pos += strlen (ptrs[i]);
     }
 
   free (ptrs);
 }
 
-/* Returns the number of unique string values in the given field operation */
-static size_t
-count_unique_values ( struct fieldop *op, bool case_sensitive )
+struct string_count
+{
+  const char *str;
+  size_t count;
+};
+
+/* Compares the strings of 'topk', by decreasing count,
+   then in the order of 'unique' */
+static int
+cmp_string_count (const void *p1, const void *p2)
 {
-  const char *last_str, **cur_str;
-  size_t count = 1 ;
+  const struct string_count *a = p1;
+  const struct string_count *b = p2;
+  if (a->count != b->count)
+    return a->count < b->count ? 1 : -1;
+  return case_sensitive ? strcmp (a->str, b->str)
+                        : strcasecmp (a->str, b->str);
+}
 
-  const char **ptrs = field_op_get_string_ptrs (op, true, case_sensitive);
+/* creates a list of the most common strings from op->str_buf,
+   as 'string:count' pairs by decreasing count,
+   separated by the collapse separator.
+   results are stored in op->out_buf. */
+static void
+topk_value ( struct fieldop *op )
+{
+  struct string_count *items = XNMALLOC (op->str_set_used,
+                                         struct string_count);
+  size_t n = 0;
+  for (size_t i = 0; i < op->str_set_alloc; ++i)
+    if (op->str_set[i])
+      {
+        items[n].str = op->str_buf + op->str_set[i] - 1;
+        items[n++].count = op->str_counts[i];
+      }
+  qsort (items, n, sizeof (struct string_count), cmp_string_count);
+  n = MIN (n, op->params.topk.k);
 
-  /* Copy the first string */
-  cur_str = ptrs;
-  last_str = *cur_str;
-  ++cur_str;
+  size_t len = 1;
+  for (size_t i = 0; i < n; ++i)
+    len += strlen (items[i].str) + 1 + INT_BUFSIZE_BOUND (uintmax_t);
+  field_op_reserve_out_buf (op, len);
 
-  /* Copy the following strings, if they are different from the previous one */
-  while ( *cur_str != 0 )
+  char *pos = op->out_buf;
+  *pos = '\0';
+  for (size_t i = 0; i < n; ++i)
     {
-      if ((case_sensitive && (!STREQ (*cur_str, last_str)))
-          || (!case_sensitive && (strcasecmp (*cur_str, last_str)!=0)))
-        {
-          ++count;
-        }
-      last_str = *cur_str;
-      ++cur_str;
+      if (i > 0)
+        *pos++ = collapse_separator;
+      pos = stpcpy (pos, items[i].str);
+      pos += sprintf (pos, ":%"PRIuMAX, (uintmax_t) items[i].count);
     }
 
-  free (ptrs);
+  free (items);
+}
+
+/* creates a list of the sampled strings (in no particular order),
+   separated by the collapse separator.
+   results are stored in op->out_buf. */
+static void
+sample_value ( struct fieldop *op )
+{
+  field_op_reserve_out_buf (op, op->state.sample.bytes + 1);
 
-  return count;
+  char *pos = op->out_buf;
+  *pos = '\0';
+  for (size_t i = 0; i < op->state.sample.used; ++i)
+    {
+      if (i > 0)
+        *pos++ = collapse_separator;
+      pos = stpcpy (pos, op->str_buf + op->state.sample.offsets[i]);
+    }
 }
 
 /* Returns a nul-terimated string, composed of all the values
@@ -774,12 +3007,15 @@ field_op_summarize_empty (struct fieldop *op)
     case OP_RANGE:
     case OP_TRIMMED_MEAN:
     case OP_GETNUM:
+    case OP_APPROX_MEDIAN:
+    case OP_APPROX_PERCENTILE:
       numeric_result = nanl ("");
       break;
 
     case OP_SUM:
     case OP_COUNT:
     case OP_COUNT_UNIQUE:
+    case OP_APPROX_COUNT_UNIQUE:
       numeric_result = 0;
       break;
 
@@ -803,6 +3039,9 @@ field_op_summarize_empty (struct fieldop *op)
 
     case OP_UNIQUE:
     case OP_COLLAPSE:
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+    case OP_SAMPLE:
     case OP_BASE64:
     case OP_DEBASE64:
     case OP_MD5:
@@ -828,8 +3067,7 @@ field_op_summarize_empty (struct fieldop *op)
   if (op->res_type==NUMERIC_RESULT)
     {
       field_op_reserve_out_buf (op, numeric_output_bufsize);
-      snprintf (op->out_buf, op->out_buf_alloc,
-                numeric_output_format, numeric_result);
+      format_number (op->out_buf, op->out_buf_alloc, numeric_result);
     }
 }
 
@@ -840,10 +3078,17 @@ field_op_summarize (struct fieldop *op)
 {
   long double numeric_result = 0 ;
   char tmpbuf[64]; /* 64 bytes - enough to hold sha512 */
+  struct fieldop *vop = field_op_values_op (op);
+
+  if (field_op_emit_partial)
+    {
+      field_op_summarize_partial (op);
+      return;
+    }
 
   /* In case of no values, each operation returns a specific result.
      'no values' can happen with '--narm' and input of all N/As. */
-  if (op->count==0)
+  if (vop->count==0)
     {
       field_op_summarize_empty (op);
       return ;
@@ -853,21 +3098,31 @@ field_op_summarize (struct fieldop *op)
     {
     case OP_MEAN:
     case OP_MS:
-      numeric_result = op->value / op->count;
+      numeric_result = field_op_sum_value (op) / op->count;
       break;
 
     case OP_GEOMEAN:
-      numeric_result = expl (op->value / op->count);
+      numeric_result = expl (field_op_sum_value (op) / op->count);
       break;
 
     case OP_HARMMEAN:
-      numeric_result = op->count / op->value;
+      numeric_result = op->count / field_op_sum_value (op);
       break;
 
     case OP_SUM:
-    case OP_COUNT:
     case OP_MIN:
     case OP_MAX:
+      if (op->int_exact && op->params.integer)
+        {
+          /* Print the exact integer (not rounded by the numeric format) */
+          field_op_reserve_out_buf (op, INT_BUFSIZE_BOUND (intmax_t));
+          sprintf (op->out_buf, "%"PRIdMAX, op->int_value);
+          return;
+        }
+      numeric_result = field_op_scalar_value (op);
+      break;
+
+    case OP_COUNT:
     case OP_ABSMIN:
     case OP_ABSMAX:
     case OP_BIN_BUCKETS:
@@ -896,97 +3151,102 @@ field_op_summarize (struct fieldop *op)
       break;
 
     case OP_MEDIAN:
-      field_op_sort_values (op);
-      numeric_result = median_value ( op->values, op->num_values );
+      field_op_order_values (op);
+      numeric_result = median_value ( vop->values, vop->num_values );
       break;
 
     case OP_QUARTILE_1:
-      field_op_sort_values (op);
-      numeric_result = quartile1_value ( op->values, op->num_values );
+      field_op_order_values (op);
+      numeric_result = quartile1_value ( vop->values, vop->num_values );
       break;
 
     case OP_QUARTILE_3:
-      field_op_sort_values (op);
-      numeric_result = quartile3_value ( op->values, op->num_values );
+      field_op_order_values (op);
+      numeric_result = quartile3_value ( vop->values, vop->num_values );
       break;
 
     case OP_IQR:
-      field_op_sort_values (op);
-      numeric_result = quartile3_value ( op->values, op->num_values )
-                       - quartile1_value ( op->values, op->num_values );
+      field_op_order_values (op);
+      numeric_result = quartile3_value ( vop->values, vop->num_values )
+                       - quartile1_value ( vop->values, vop->num_values );
       break;
 
     case OP_PERCENTILE:
-      field_op_sort_values (op);
-      numeric_result = percentile_value ( op->values, op->num_values,
+      field_op_order_values (op);
+      numeric_result = percentile_value ( vop->values, vop->num_values,
                                           op->params.percentile / 100.0 );
       break;
 
     case OP_TRIMMED_MEAN:
-      field_op_sort_values (op);
-      numeric_result = trimmed_mean_value ( op->values, op->num_values,
+      field_op_order_values (op);
+      numeric_result = trimmed_mean_value ( vop->values, vop->num_values,
                                             op->params.trimmed_mean);
       break;
 
+    case OP_APPROX_MEDIAN:
+      numeric_result = tdigest_quantile (&op->state.digest, 0.5,
+                                         op->params.approx.compression);
+      break;
+
+    case OP_APPROX_PERCENTILE:
+      numeric_result = tdigest_quantile (&op->state.digest,
+                                         op->params.approx.percentile / 100.0,
+                                         op->params.approx.compression);
+      break;
+
     case OP_RMS:
-      numeric_result = sqrtl (op->value / op->count);
+      numeric_result = sqrtl (field_op_sum_value (op) / op->count);
       break;
 
     case OP_PSTDEV:
-      numeric_result = stdev_value ( op->values, op->num_values, DF_POPULATION);
+      numeric_result = stdev_value ( &op->state.moments, DF_POPULATION);
       break;
 
     case OP_SSTDEV:
-      numeric_result = stdev_value ( op->values, op->num_values, DF_SAMPLE);
+      numeric_result = stdev_value ( &op->state.moments, DF_SAMPLE);
       break;
 
     case OP_PVARIANCE:
-      numeric_result = variance_value ( op->values, op->num_values,
-                                        DF_POPULATION);
+      numeric_result = variance_value ( &op->state.moments, DF_POPULATION);
       break;
 
     case OP_SVARIANCE:
-      numeric_result = variance_value ( op->values, op->num_values,
-                                        DF_SAMPLE);
+      numeric_result = variance_value ( &op->state.moments, DF_SAMPLE);
       break;
 
     case OP_MAD:
-      field_op_sort_values (op);
-      numeric_result = mad_value ( op->values, op->num_values, 1.4826 );
+      field_op_order_values (op);
+      numeric_result = mad_value ( vop->values, vop->num_values, 1.4826 );
       break;
 
     case OP_MADRAW:
-      field_op_sort_values (op);
-      numeric_result = mad_value ( op->values, op->num_values, 1.0 );
+      field_op_order_values (op);
+      numeric_result = mad_value ( vop->values, vop->num_values, 1.0 );
       break;
 
     case OP_S_SKEWNESS:
-      numeric_result = skewness_value ( op->values, op->num_values,
-                                        DF_SAMPLE );
+      numeric_result = skewness_value ( &op->state.moments, DF_SAMPLE );
       break;
 
     case OP_P_SKEWNESS:
-      numeric_result = skewness_value ( op->values, op->num_values,
-                                        DF_POPULATION );
+      numeric_result = skewness_value ( &op->state.moments, DF_POPULATION );
       break;
 
     case OP_S_EXCESS_KURTOSIS:
-      numeric_result = excess_kurtosis_value ( op->values, op->num_values,
-                                               DF_SAMPLE );
+      numeric_result = excess_kurtosis_value ( &op->state.moments, DF_SAMPLE );
       break;
 
     case OP_P_EXCESS_KURTOSIS:
-      numeric_result = excess_kurtosis_value ( op->values, op->num_values,
+      numeric_result = excess_kurtosis_value ( &op->state.moments,
                                                DF_POPULATION );
       break;
 
     case OP_JARQUE_BERA:
-      numeric_result = jarque_bera_pvalue ( op->values, op->num_values );
+      numeric_result = jarque_bera_pvalue ( &op->state.moments );
       break;
 
     case OP_DP_OMNIBUS:
-      numeric_result = dagostino_pearson_omnibus_pvalue ( op->values,
-                                                          op->num_values );
+      numeric_result = dagostino_pearson_omnibus_pvalue ( &op->state.moments );
       break;
 
     case OP_P_COVARIANCE:
@@ -994,8 +3254,7 @@ field_op_summarize (struct fieldop *op)
       assert (!op->slave);                       /* LCOV_EXCL_LINE */
       assert (op->slave_op);                     /* LCOV_EXCL_LINE */
       verify_slave_num_values (op);
-      numeric_result = covariance_value (op->values, op->slave_op->values,
-                                         op->num_values,
+      numeric_result = covariance_value (&op->state.comoments,
                                          (op->op==OP_P_COVARIANCE)?
                                                 DF_POPULATION:DF_SAMPLE );
       break;
@@ -1005,8 +3264,7 @@ field_op_summarize (struct fieldop *op)
       assert (!op->slave);                       /* LCOV_EXCL_LINE */
       assert (op->slave_op);                     /* LCOV_EXCL_LINE */
       verify_slave_num_values (op);
-      numeric_result = pearson_corr_value (op->values, op->slave_op->values,
-                                           op->num_values,
+      numeric_result = pearson_corr_value (&op->state.comoments,
                                            (op->op==OP_P_PEARSON_COR)?
                                                 DF_POPULATION:DF_SAMPLE);
       break;
@@ -1015,15 +3273,13 @@ field_op_summarize (struct fieldop *op)
       assert (!op->slave);                       /* LCOV_EXCL_LINE */
       assert (op->slave_op);                     /* LCOV_EXCL_LINE */
       verify_slave_num_values (op);
-      numeric_result = dot_product_value (op->values, op->slave_op->values,
-                                          op->num_values );
+      numeric_result = dot_product_value (&op->state.comoments);
       break;
 
     case OP_MODE:
     case OP_ANTIMODE:
-      field_op_sort_values (op);
-      numeric_result = mode_value ( op->values, op->num_values,
-                                    (op->op==OP_MODE)?MODE:ANTIMODE);
+      numeric_result = value_counts_mode (&op->state.value_counts,
+                                          (op->op==OP_MODE)?MODE:ANTIMODE);
       break;
 
     case OP_UNIQUE:
@@ -1034,8 +3290,22 @@ field_op_summarize (struct fieldop *op)
       collapse_value (op);
       break;
 
+    case OP_TOPK:
+    case OP_APPROX_TOPK:
+      topk_value (op);
+      break;
+
+    case OP_SAMPLE:
+      sample_value (op);
+      break;
+
     case OP_COUNT_UNIQUE:
-      numeric_result = count_unique_values (op,case_sensitive);
+      numeric_result = op->str_set_used;
+      break;
+
+    case OP_APPROX_COUNT_UNIQUE:
+      numeric_result = roundl (hll_estimate (&op->state.hll,
+                                             op->params.hll_precision));
       break;
 
     case OP_BASE64:
@@ -1148,8 +3418,7 @@ field_op_summarize (struct fieldop *op)
   if (op->res_type==NUMERIC_RESULT)
     {
       field_op_reserve_out_buf (op, numeric_output_bufsize);
-      snprintf (op->out_buf, op->out_buf_alloc,
-                numeric_output_format, numeric_result);
+      format_number (op->out_buf, op->out_buf_alloc, numeric_result);
     }
 }
 
@@ -1160,10 +3429,105 @@ field_op_reset (struct fieldop *op)
   op->first = true;
   op->count = 0 ;
   op->value = 0;
+  op->value_comp = 0;
+  op->int_exact = field_op_uses_int_value (op->op);
+  op->int_value = 0;
+  switch (field_op_state_kind (op->op))
+    {
+    case STATE_MOMENTS:
+      memset (&op->state.moments, 0, sizeof op->state.moments);
+      break;
+    case STATE_COMOMENTS:
+      memset (&op->state.comoments, 0, sizeof op->state.comoments);
+      break;
+    case STATE_DIGEST:
+      tdigest_reset (&op->state.digest);
+      break;
+    case STATE_HLL:
+      hll_reset (&op->state.hll);
+      break;
+    case STATE_VALUE_COUNTS:
+      value_counts_reset (&op->state.value_counts);
+      break;
+    case STATE_SAMPLE:
+      op->state.sample.used = 0;
+      op->state.sample.bytes = 0;
+      op->state.sample.skip = 0;
+      op->state.sample.w = 0;
+      break;
+    case STATE_NONE:
+    default:
+      break;
+    }
+  op->values_ordered = false;
   op->num_values = 0 ;
   op->str_buf_used = 0;
   op->out_buf_used = 0;
   /* note: op->str_buf and op->str_alloc are not free'd, and reused */
+
+  /* A large hash table of distinct strings is not kept for the next
+     group: clearing it would cost more than the group itself */
+  if (op->str_set_alloc > 1024)
+    {
+      free (op->str_set);
+      free (op->str_counts);
+      op->str_set = op->str_counts = NULL;
+      op->str_set_alloc = 0;
+    }
+  else if (op->str_set_used)
+    memset (op->str_set, 0, op->str_set_alloc * sizeof (size_t));
+  op->str_set_used = 0;
+  op->str_counts_error = 0;
+}
+
+size_t _GL_ATTRIBUTE_PURE
+field_op_memory (const struct fieldop *op)
+{
+  size_t m = op->alloc_values * sizeof (accum_t)
+             + op->str_buf_alloc + op->str_set_alloc * sizeof (size_t)
+             + (op->str_counts ? op->str_set_alloc * sizeof (size_t) : 0)
+             + op->out_buf_alloc;
+
+  switch (field_op_state_kind (op->op))
+    {
+    case STATE_DIGEST:
+      m += tdigest_memory (&op->state.digest);
+      break;
+    case STATE_HLL:
+      m += hll_memory (&op->state.hll, op->params.hll_precision);
+      break;
+    case STATE_VALUE_COUNTS:
+      m += value_counts_memory (&op->state.value_counts);
+      break;
+    case STATE_SAMPLE:
+      m += op->state.sample.alloc * sizeof (size_t);
+      break;
+    case STATE_NONE:
+    case STATE_MOMENTS:
+    case STATE_COMOMENTS:
+    default:
+      break;
+    }
+  return m;
+}
+
+bool _GL_ATTRIBUTE_PURE
+field_op_memory_grows (const struct fieldop *op)
+{
+  switch (field_op_state_kind (op->op))
+    {
+    case STATE_DIGEST:
+    case STATE_HLL:
+    case STATE_VALUE_COUNTS:
+    case STATE_SAMPLE:
+      return true;
+
+    case STATE_NONE:
+    case STATE_MOMENTS:
+    case STATE_COMOMENTS:
+    default:
+      return op->acc_type != NUMERIC_SCALAR;
+    }
 }
 
 void
@@ -1173,11 +3537,40 @@ field_op_free (struct fieldop* op)
   op->num_values = 0 ;
   op->alloc_values = 0;
 
+  switch (field_op_state_kind (op->op))
+    {
+    case STATE_DIGEST:
+      tdigest_free (&op->state.digest);
+      break;
+    case STATE_HLL:
+      hll_free (&op->state.hll);
+      break;
+    case STATE_VALUE_COUNTS:
+      value_counts_free (&op->state.value_counts);
+      break;
+    case STATE_SAMPLE:
+      free (op->state.sample.offsets);
+      break;
+    case STATE_NONE:
+    case STATE_MOMENTS:
+    case STATE_COMOMENTS:
+    default:
+      break;
+    }
+  memset (&op->state, 0, sizeof op->state);
+
   free (op->str_buf);
   op->str_buf = NULL;
   op->str_buf_alloc = 0;
   op->str_buf_used = 0;
 
+  free (op->str_set);
+  free (op->str_counts);
+  op->str_set = op->str_counts = NULL;
+  op->str_set_alloc = 0;
+  op->str_set_used = 0;
+  op->str_counts_error = 0;
+
   free (op->out_buf);
   op->out_buf = NULL;
   op->out_buf_alloc = 0;
@@ -1187,7 +3580,7 @@ field_op_free (struct fieldop* op)
   op->field_name = NULL;
 }
 
-const char*
+const char* _GL_ATTRIBUTE_CONST
 field_op_collect_result_name (const enum FIELD_OP_COLLECT_RESULT flocr)
 {
   switch (flocr)                                 /* LCOV_EXCL_BR_LINE */
@@ -1196,6 +3589,12 @@ field_op_collect_result_name (const enum FIELD_OP_COLLECT_RESULT flocr)
      return _("invalid numeric value");
    case FLOCR_INVALID_BASE64:
      return _("invalid base64 value");
+   case FLOCR_INVALID_INTEGER:
+     return _("invalid integer value");
+   case FLOCR_INTEGER_OVERFLOW:
+     return _("integer overflow");
+   case FLOCR_INVALID_PARTIAL:
+     return _("invalid partial result");
    case FLOCR_OK:                                /* LCOV_EXCL_LINE */
    case FLOCR_OK_KEEP_LINE:                      /* LCOV_EXCL_LINE */
    case FLOCR_OK_SKIPPED:                        /* LCOV_EXCL_LINE */
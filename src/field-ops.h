@@ -53,9 +53,19 @@ enum FIELD_OP_COLLECT_RESULT
   FLOCR_OK_KEEP_LINE,
   FLOCR_OK_SKIPPED,
   FLOCR_INVALID_NUMBER,
-  FLOCR_INVALID_BASE64
+  FLOCR_INVALID_BASE64,
+  FLOCR_INVALID_INTEGER,
+  FLOCR_INTEGER_OVERFLOW,
+  FLOCR_INVALID_PARTIAL
 };
 
+struct fieldop;
+
+/* Collects a value (from input) into the field operation 'op'
+   (see field_op_collect) */
+typedef enum FIELD_OP_COLLECT_RESULT
+  (*field_op_collect_func) (struct fieldop *op, const char* str, size_t slen);
+
 struct operation_data
 {
   enum accumulation_type acc_type;
@@ -77,6 +87,22 @@ struct fieldop
                       another field_op */
   size_t slave_idx;
   struct fieldop* slave_op;
+  bool slave_value_set; /* slave op: 'value' was collected from the current
+                           input line (and can be paired by the master) */
+
+  /* The function collecting the values of this op, and (with --narm)
+     the function called by it for the values which are not N/A.
+     Selected once for the operation (see field_op_bind_collect). */
+  field_op_collect_func collect;
+  field_op_collect_func collect_value;
+
+  /* Order-statistics ops (median,q1,mode,etc.) on the same field share
+     the values collected by the first of them (see field_ops_share_values) */
+  struct fieldop* values_op; /* if not NULL, the op holding our values */
+  size_t values_idx;         /* index of 'values_op' in the ops array */
+  bool values_shared;        /* if true, other ops use this op's values */
+  bool values_ordered;       /* if true, 'values' are sorted, or ordered
+                                as needed by all the ops sharing them */
 
   /* Instance information */
   size_t field; /* field number.  1 = first field in input file. */
@@ -91,6 +117,18 @@ struct fieldop
     size_t percentile;
     long double trimmed_mean;
     enum extract_number_type get_num_type;
+    bool integer;  /* sum/min/max:int - integer values, exact result */
+    struct {
+      size_t percentile;
+      size_t compression;
+    } approx;      /* approxmedian/approxperc - see tdigest.h */
+    unsigned int hll_precision; /* approxcountunique - see hyperloglog.h */
+    struct {
+      size_t k;
+      size_t capacity;
+    } topk;        /* topk/approxtopk - the number of values printed, and
+                      (approxtopk) the number of distinct values kept */
+    size_t sample_size; /* sample - the number of sampled values */
   } params;
 
   /* Collected Data */
@@ -98,11 +136,46 @@ struct fieldop
 
   /* NUMERIC_SCALAR operations */
   size_t count; /* number of items collected so far in a group */
-  long double value; /* for single-value operations (sum, min, max, absmin,
-                        absmax, mean) - this is the accumulated value */
+  accum_t value; /* for single-value operations (sum, min, max, absmin,
+                    absmax, mean) - this is the accumulated value */
+  accum_t value_comp; /* for sum/mean/geomean/harmmean/ms/rms: the
+                         compensation of the rounding errors of 'value'
+                         (see 'field_op_sum_add') */
+  bool int_exact; /* for sum/min/max: true while all values are integers
+                     (and the sum fits), accumulated in 'int_value'
+                     instead of 'value' */
+  intmax_t int_value;
+
+  /* The summary of the values kept by some operations.  An operation
+     uses at most one of them (see field_op_state_kind), so they share
+     the space: every group of --sort has its own copy of the field-ops. */
+  union {
+    struct moments moments; /* for stdev/variance/skewness/kurtosis,
+                               accumulated without storing the values */
+    struct comoments comoments; /* for pcov/scov/ppearson/spearson/dotprod,
+                                   collected by the master op.  The slave
+                                   op only holds its last value in
+                                   'value'. */
+    struct tdigest digest; /* for approxmedian/approxperc */
+    struct hyperloglog hll; /* for approxcountunique */
+    struct value_counts value_counts; /* for mode/antimode */
+
+    /* for rand/sample: reservoir sampling with Algorithm L, which draws
+       the number of values to skip before the next sampled value.
+       sample: 'offsets' holds the offsets of the sampled strings in the
+       string buffer (which also holds the strings they replaced). */
+    struct {
+      size_t *offsets;
+      size_t used;   /* number of sampled strings */
+      size_t alloc;
+      size_t bytes;  /* bytes of the sampled strings in the buffer */
+      size_t skip;   /* number of values to skip */
+      double w;      /* Algorithm L's 'W' */
+    } sample;
+  } state;
 
   /* NUMERIC_VECTOR operations */
-  long double *values;     /* array for multi-valued ops (median,mode,stdev) */
+  accum_t     *values;     /* array for multi-valued ops (median,mode) */
   size_t      num_values;  /* number of used values */
   size_t      alloc_values;/* number of allocated values */
 
@@ -111,6 +184,17 @@ struct fieldop
   size_t str_buf_used; /* number of bytes used in the buffer */
   size_t str_buf_alloc; /* number of bytes allocated in the buffer */
 
+  /* for unique/countunique/topk: the distinct strings are stored once in
+     the string buffer.  'str_set' is an open-addressing hash table of
+     their offsets in the buffer plus one (zero marks an empty slot). */
+  size_t *str_set;
+  size_t str_set_used;  /* number of distinct strings */
+  size_t str_set_alloc; /* number of slots (a power of two) */
+  size_t *str_counts;   /* for topk/approxtopk: the number of occurrences
+                           of the string of each slot */
+  size_t str_counts_error; /* for approxtopk: the counts are low by at
+                              most this number */
+
   /* Output buffer containing the final results of an operation,
      set by 'summarize' functions.
      also used for line operations (md5/sha1/256/512/base64). */
@@ -125,19 +209,64 @@ field_op_init (struct fieldop* /*in-out*/ op,
                enum field_operation oper,
                bool by_name, size_t num, const char* name);
 
+/* Initializes 'op' as an empty copy of the field-op 'src'
+   (same operation, field and parameters, but no collected data).
+   'slave_op' and 'values_op' are copied as-is, and should be adjusted
+   by the caller. */
+void
+field_op_init_copy (struct fieldop* /*out*/ op, const struct fieldop *src);
+
+/* Returns the number of bytes allocated for the collected data
+   of the field-op (not including the struct itself). */
+size_t
+field_op_memory (const struct fieldop *op);
+
+/* Returns true if the memory used by the field-op (see field_op_memory)
+   can grow as values are collected, and not only when summarizing. */
+bool
+field_op_memory_grows (const struct fieldop *op);
+
 /* Frees the internal structures in the field-op.
    Does *not* free 'op' itself */
 void
 field_op_free (struct fieldop* op);
 
+/* Selects the function collecting the values of 'op', according to
+   the operation, its role in a pair (slave or not), and the options
+   (--narm).  Must be called before collecting values, and again if
+   'op->slave' changes. */
+void
+field_op_bind_collect (struct fieldop *op);
+
 /* Add a value (from input) to the current field operation.
    'str' does not need to be null-terminated.
 
   Returns true if the operation was successful.
   Returns false if the input was invalid numeric value.
 */
+static inline enum FIELD_OP_COLLECT_RESULT
+field_op_collect (struct fieldop *op, const char* str, size_t slen)
+{
+  return op->collect (op, str, slen);
+}
+
+/* Add the values collected by 'src' (a copy of the same field-op, e.g. of
+   the same group in another part of the input) to 'op', as if they were
+   collected by 'op' after its own values.  'src' is left with unspecified
+   data, and should only be freed.
+   Returns FLOCR_OK_KEEP_LINE if the result now comes from a value of
+   'src' (for operations which select a line, e.g. last, min, max),
+   FLOCR_INTEGER_OVERFLOW if the exact sum (sum:int) overflows,
+   and FLOCR_OK otherwise. */
 enum FIELD_OP_COLLECT_RESULT
-field_op_collect (struct fieldop *op, const char* str, size_t slen);
+field_op_merge (struct fieldop *op, struct fieldop *src);
+
+/* Add the partial result 'str' (the state of the same field-op, printed
+   by field_op_summarize with field_op_emit_partial) to 'op', as
+   field_op_merge.  'str' does not need to be null-terminated.
+   Returns FLOCR_INVALID_PARTIAL if 'str' is not a valid state. */
+enum FIELD_OP_COLLECT_RESULT
+field_op_load_partial (struct fieldop *op, const char* str, size_t slen);
 
 /* Evaluates to true/false depending if the value returned from
    field_op_collect represents a successful operation. */
@@ -151,6 +280,19 @@ const char*
 field_op_collect_result_name (const enum FIELD_OP_COLLECT_RESULT flocr);
 
 
+/* Let order-statistics ops on the same field in 'ops' share a single
+   vector of values, instead of each collecting its own copy.
+   Must be called once the fields of the ops are known (after resolving
+   named columns), before collecting any values. */
+void
+field_ops_share_values (struct fieldop *ops, size_t num_ops);
+
+/* Order the shared values of 'ops' (see above) once for all the ops
+   using them, before summarizing the ops.
+   Optional: each op otherwise orders the values it needs by itself. */
+void
+field_ops_order_shared_values (struct fieldop *ops, size_t num_ops);
+
 /* Called after all values in a group are collected in a field-op,
    to perform any (optional) finalizing steps
    (e.g. in OP_MEAN, calculate the mean).
@@ -163,6 +305,22 @@ field_op_summarize (struct fieldop *op);
 void
 field_op_reset (struct fieldop *op);
 
+/* If true (--emit-partial), field_op_summarize stores the state of the
+   operation (to be loaded with field_op_load_partial) instead of its
+   result */
+extern bool field_op_emit_partial;
+
+/* Returns true if the character 'c' can appear in the state of an
+   operation (and so can't separate fields with partial results) */
+bool
+field_op_partial_char (int c);
+
+/* Set the fields of 'ops' to the columns in which their states are printed
+   (with field_op_emit_partial), the first in column 'first_column' */
+void
+field_ops_partial_columns (struct fieldop *ops, size_t num_ops,
+                           size_t first_column);
+
 /* Output precision, to be used with "printf ("%.*Lg",)" */
 extern int field_op_output_precision;
 
@@ -0,0 +1,598 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "system.h"
+#include "die.h"
+#include "linebuffer.h"
+#include "xalloc.h"
+
+#include "text-options.h"
+#include "text-lines.h"
+#include "accum-type.h"
+#include "utils.h"
+#include "tdigest.h"
+#include "hyperloglog.h"
+#include "value-counts.h"
+#include "op-defs.h"
+#include "field-ops.h"
+#include "op-parser.h"
+#include "group-table.h"
+#include "group-spill.h"
+
+/*
+ File formats (native byte order, the files never outlive the process):
+
+ partition file:  sequence of lines, each:
+                    uintmax_t seq, size_t len, 'len' bytes of the line.
+
+ runs file:       sequence of group results, each:
+                    uintmax_t seq, size_t payload length,
+                    payload: size_t num_fields, then for each field
+                               size_t len, 'len' bytes, NUL
+                             size_t num_results, then for each result
+                               size_t len, 'len' bytes, NUL
+ */
+
+static FILE*
+spill_create_temp ()
+{
+  const char *dir = getenv ("TMPDIR");
+  if (dir == NULL || *dir == '\0')
+    dir = "/tmp";
+
+  char *tmpl = xmalloc (strlen (dir) + sizeof "/datamashXXXXXX");
+  strcpy (stpcpy (tmpl, dir), "/datamashXXXXXX");
+
+  int fd = mkstemp (tmpl);
+  if (fd < 0)
+    die (EXIT_FAILURE, errno, _("failed to create temporary file in %s"),
+         quote (dir));
+  /* The file is only accessed through 'fd' - remove it right away,
+     so it does not linger if datamash is interrupted */
+  unlink (tmpl);
+  free (tmpl);
+
+  FILE *f = fdopen (fd, "w+");
+  if (f == NULL)
+    die (EXIT_FAILURE, errno, _("failed to create temporary file in %s"),
+         quote (dir));
+  return f;
+}
+
+static void
+spill_write (FILE *f, const void *p, size_t n)
+{
+  if (fwrite (p, 1, n, f) != n)
+    die (EXIT_FAILURE, errno, _("write error on temporary file"));
+}
+
+/* Returns false if the end of file was reached before reading anything */
+static bool
+spill_read (FILE *f, void *p, size_t n)
+{
+  size_t r = fread (p, 1, n, f);
+  if (r == 0 && n > 0 && feof (f))
+    return false;
+  if (r != n)
+    die (EXIT_FAILURE, errno, _("read error on temporary file"));
+  return true;
+}
+
+void
+spill_close (FILE *f)
+{
+  if (ferror (f) || fclose (f) != 0)
+    die (EXIT_FAILURE, errno, _("read error on temporary file"));
+}
+
+
+struct spill_partitions
+{
+  FILE *files[SPILL_PARTITIONS];
+  size_t level;
+};
+
+struct spill_partitions*
+spill_partitions_new (size_t level)
+{
+  struct spill_partitions *sp = XZALLOC (struct spill_partitions);
+  sp->level = level;
+  return sp;
+}
+
+void
+spill_partitions_add_line (struct spill_partitions *sp,
+                           const struct line_record_t *lr, uintmax_t seq)
+{
+  const size_t len = line_record_length (lr);
+  const size_t i = group_table_key_hash (lr, sp->level) % SPILL_PARTITIONS;
+
+  if (sp->files[i] == NULL)
+    sp->files[i] = spill_create_temp ();
+
+  spill_write (sp->files[i], &seq, sizeof seq);
+  spill_write (sp->files[i], &len, sizeof len);
+  spill_write (sp->files[i], line_record_buffer (lr), len);
+}
+
+FILE*
+spill_partitions_take (struct spill_partitions *sp, size_t i)
+{
+  assert (i < SPILL_PARTITIONS); /* LCOV_EXCL_LINE */
+  FILE *f = sp->files[i];
+  sp->files[i] = NULL;
+  if (f == NULL)
+    return NULL;
+
+  if (fflush (f) != 0)
+    die (EXIT_FAILURE, errno, _("write error on temporary file"));
+  rewind (f);
+  return f;
+}
+
+void
+spill_partitions_free (struct spill_partitions *sp)
+{
+  for (size_t i = 0; i < SPILL_PARTITIONS; ++i)
+    if (sp->files[i])
+      spill_close (sp->files[i]);
+  free (sp);
+}
+
+bool
+spill_read_line (FILE *f, struct line_record_t *lr, uintmax_t *seq)
+{
+  size_t len;
+
+  if (!spill_read (f, seq, sizeof *seq))
+    return false;
+  if (!spill_read (f, &len, sizeof len))
+    die (EXIT_FAILURE, 0, _("read error on temporary file"));
+
+  line_record_reserve_buffer (lr, len + 1);
+  if (len && !spill_read (f, lr->lbuf.buffer, len))
+    die (EXIT_FAILURE, 0, _("read error on temporary file"));
+  lr->lbuf.buffer[len] = 0;
+  lr->lbuf.length = len;
+
+  line_record_parse (lr);
+  return true;
+}
+
+
+/* The size of the buffer of each run being merged: with many runs, they
+   are merged in several passes, so that the buffers of the runs merged
+   together fit in the memory limit */
+enum { RUN_BUFFER_MIN = 4096, RUN_BUFFER_MAX = 1024 * 1024 };
+
+/* Buffered reader of one run in the runs file */
+struct run_reader
+{
+  off_t pos;           /* file offset of the next byte to read */
+  off_t end;           /* file offset of the end of the run */
+
+  char *buf;
+  size_t buf_size;
+  size_t buf_len;      /* number of valid bytes in 'buf' */
+  size_t buf_pos;      /* next unread byte in 'buf' */
+
+  /* The current group (only 'line' and 'seq' are used),
+     and its payload (as stored in the file) */
+  struct group_entry cur;
+  const char *payload;
+  size_t payload_len;
+  const char **results;
+  size_t num_results;
+  size_t alloc_results;
+};
+
+struct spill_runs
+{
+  FILE *f;
+  off_t written;
+
+  /* run 'i' is stored in the byte range [bounds[i], bounds[i+1]) */
+  off_t *bounds;
+  size_t num_runs;
+  size_t alloc_bounds;
+
+  /* merging */
+  struct run_reader *readers;
+  size_t num_readers;
+  size_t *heap;        /* min-heap of indices into 'readers' */
+  size_t heap_len;
+  bool sorted;
+  bool started;        /* true if heap[0] was already returned */
+};
+
+struct spill_runs*
+spill_runs_new ()
+{
+  return XZALLOC (struct spill_runs);
+}
+
+size_t _GL_ATTRIBUTE_PURE
+spill_runs_count (const struct spill_runs *runs)
+{
+  return runs->num_runs;
+}
+
+static void
+spill_runs_write (struct spill_runs *runs, const void *p, size_t n)
+{
+  spill_write (runs->f, p, n);
+  runs->written += n;
+}
+
+static void
+spill_runs_write_string (struct spill_runs *runs, const char *s, size_t len)
+{
+  spill_runs_write (runs, &len, sizeof len);
+  spill_runs_write (runs, s, len);
+  spill_runs_write (runs, "", 1);
+}
+
+/* Start writing a new run */
+static void
+spill_runs_begin_run (struct spill_runs *runs)
+{
+  if (runs->f == NULL)
+    runs->f = spill_create_temp ();
+
+  if (runs->num_runs + 2 > runs->alloc_bounds)
+    runs->bounds = x2nrealloc (runs->bounds, &runs->alloc_bounds,
+                               sizeof *runs->bounds);
+  runs->bounds[runs->num_runs] = runs->written;
+}
+
+static void
+spill_runs_end_run (struct spill_runs *runs)
+{
+  runs->num_runs++;
+  runs->bounds[runs->num_runs] = runs->written;
+}
+
+void
+spill_runs_add (struct spill_runs *runs, struct group_entry **groups,
+                size_t num_groups, size_t num_ops)
+{
+  spill_runs_begin_run (runs);
+
+  for (size_t i = 0; i < num_groups; ++i)
+    {
+      struct group_entry *g = groups[i];
+      const size_t num_fields = line_record_num_fields (&g->line);
+      size_t num_results = 0;
+      size_t payload = 2 * sizeof (size_t);
+
+      for (size_t j = 1; j <= num_fields; ++j)
+        payload += sizeof (size_t)
+                   + line_record_field_unsafe (&g->line, j)->len + 1;
+
+      field_ops_order_shared_values (g->ops, num_ops);
+      for (size_t j = 0; j < num_ops; ++j)
+        {
+          if (g->ops[j].slave)
+            continue;
+          field_op_summarize (&g->ops[j]);
+          payload += sizeof (size_t) + strlen (g->ops[j].out_buf) + 1;
+          num_results++;
+        }
+
+      spill_runs_write (runs, &g->seq, sizeof g->seq);
+      spill_runs_write (runs, &payload, sizeof payload);
+
+      spill_runs_write (runs, &num_fields, sizeof num_fields);
+      for (size_t j = 1; j <= num_fields; ++j)
+        {
+          const struct field_record_t *f =
+            line_record_field_unsafe (&g->line, j);
+          spill_runs_write_string (runs, f->buf, f->len);
+        }
+
+      spill_runs_write (runs, &num_results, sizeof num_results);
+      for (size_t j = 0; j < num_ops; ++j)
+        if (!g->ops[j].slave)
+          spill_runs_write_string (runs, g->ops[j].out_buf,
+                                   strlen (g->ops[j].out_buf));
+    }
+
+  spill_runs_end_run (runs);
+}
+
+/* Return a pointer to the next 'n' bytes of the run.
+   Any pointer previously returned for this reader becomes invalid. */
+static const char*
+run_reader_get (struct run_reader *r, int fd, size_t n)
+{
+  if (r->buf_len - r->buf_pos < n)
+    {
+      /* Move the unread bytes to the beginning of the buffer,
+         and fill the rest */
+      r->buf_len -= r->buf_pos;
+      memmove (r->buf, r->buf + r->buf_pos, r->buf_len);
+      r->buf_pos = 0;
+
+      if (r->buf_size < n)
+        {
+          r->buf_size = MAX (n, r->buf_size * 2);
+          r->buf = xrealloc (r->buf, r->buf_size);
+        }
+
+      while (r->buf_len < n)
+        {
+          size_t want = r->buf_size - r->buf_len;
+          if ((off_t) want > r->end - r->pos)
+            want = r->end - r->pos;
+          ssize_t got = want ? pread (fd, r->buf + r->buf_len, want, r->pos)
+                             : 0;
+          if (got <= 0)
+            die (EXIT_FAILURE, errno, _("read error on temporary file"));
+          r->pos += got;
+          r->buf_len += got;
+        }
+    }
+
+  const char *p = r->buf + r->buf_pos;
+  r->buf_pos += n;
+  return p;
+}
+
+static size_t
+get_size (const char **p)
+{
+  size_t n;
+  memcpy (&n, *p, sizeof n);
+  *p += sizeof n;
+  return n;
+}
+
+/* Read the next group of the run.  Returns false at the end of the run. */
+static bool
+run_reader_next (struct run_reader *r, int fd)
+{
+  uintmax_t seq;
+  size_t payload;
+
+  if (r->pos == r->end && r->buf_pos == r->buf_len)
+    return false;
+
+  const char *p = run_reader_get (r, fd, sizeof seq + sizeof payload);
+  memcpy (&seq, p, sizeof seq);
+  memcpy (&payload, p + sizeof seq, sizeof payload);
+  p = run_reader_get (r, fd, payload);
+
+  r->payload = p;
+  r->payload_len = payload;
+  r->cur.seq = seq;
+  r->cur.line.num_fields = 0;
+  size_t n = get_size (&p);
+  for (size_t i = 0; i < n; ++i)
+    {
+      size_t len = get_size (&p);
+      line_record_add_field (&r->cur.line, p, len);
+      p += len + 1;
+    }
+
+  r->num_results = get_size (&p);
+  if (r->num_results > r->alloc_results)
+    {
+      r->alloc_results = r->num_results;
+      r->results = xnrealloc (r->results, r->alloc_results,
+                              sizeof *r->results);
+    }
+  for (size_t i = 0; i < r->num_results; ++i)
+    {
+      size_t len = get_size (&p);
+      r->results[i] = p;
+      p += len + 1;
+    }
+  return true;
+}
+
+static bool
+heap_less (const struct spill_runs *runs, size_t a, size_t b)
+{
+  return group_entry_compare (&runs->readers[runs->heap[a]].cur,
+                              &runs->readers[runs->heap[b]].cur,
+                              runs->sorted) < 0;
+}
+
+static void
+heap_swap (struct spill_runs *runs, size_t a, size_t b)
+{
+  size_t t = runs->heap[a];
+  runs->heap[a] = runs->heap[b];
+  runs->heap[b] = t;
+}
+
+static void
+heap_sift_down (struct spill_runs *runs, size_t i)
+{
+  while (true)
+    {
+      size_t m = i;
+      size_t l = 2*i + 1;
+      size_t r = 2*i + 2;
+      if (l < runs->heap_len && heap_less (runs, l, m))
+        m = l;
+      if (r < runs->heap_len && heap_less (runs, r, m))
+        m = r;
+      if (m == i)
+        break;
+      heap_swap (runs, i, m);
+      i = m;
+    }
+}
+
+/* Start merging the 'count' runs from run 'first' (at most
+   'num_readers') */
+static void
+spill_runs_start_merge (struct spill_runs *runs, size_t first, size_t count)
+{
+  const int fd = fileno (runs->f);
+
+  assert (count <= runs->num_readers); /* LCOV_EXCL_LINE */
+  runs->started = false;
+  runs->heap_len = 0;
+  for (size_t i = 0; i < count; ++i)
+    {
+      struct run_reader *r = &runs->readers[i];
+      r->pos = runs->bounds[first + i];
+      r->end = runs->bounds[first + i + 1];
+      r->buf_len = r->buf_pos = 0;
+      if (run_reader_next (r, fd))
+        runs->heap[runs->heap_len++] = i;
+    }
+
+  for (size_t i = runs->heap_len / 2; i-- > 0; )
+    heap_sift_down (runs, i);
+}
+
+/* Returns the reader of the next group (in output order) of the runs
+   being merged, or NULL when all are exhausted */
+static struct run_reader*
+spill_runs_merge_reader (struct spill_runs *runs)
+{
+  if (runs->started && runs->heap_len > 0)
+    {
+      /* Advance the run whose group was returned last time */
+      if (!run_reader_next (&runs->readers[runs->heap[0]],
+                            fileno (runs->f)))
+        runs->heap[0] = runs->heap[--runs->heap_len];
+      heap_sift_down (runs, 0);
+    }
+  runs->started = true;
+
+  return runs->heap_len ? &runs->readers[runs->heap[0]] : NULL;
+}
+
+/* Merge each 'num_readers' consecutive runs into one run, in a new
+   runs file */
+static void
+spill_runs_merge_pass (struct spill_runs *runs)
+{
+  struct spill_runs *merged = spill_runs_new ();
+
+  for (size_t first = 0; first < runs->num_runs;
+       first += runs->num_readers)
+    {
+      spill_runs_start_merge (runs, first, MIN (runs->num_readers,
+                                                runs->num_runs - first));
+      spill_runs_begin_run (merged);
+      const struct run_reader *r;
+      while ((r = spill_runs_merge_reader (runs)))
+        {
+          spill_runs_write (merged, &r->cur.seq, sizeof r->cur.seq);
+          spill_runs_write (merged, &r->payload_len, sizeof r->payload_len);
+          spill_runs_write (merged, r->payload, r->payload_len);
+        }
+      spill_runs_end_run (merged);
+    }
+
+  if (fflush (merged->f) != 0)
+    die (EXIT_FAILURE, errno, _("write error on temporary file"));
+
+  spill_close (runs->f);
+  free (runs->bounds);
+  runs->f = merged->f;
+  runs->written = merged->written;
+  runs->bounds = merged->bounds;
+  runs->num_runs = merged->num_runs;
+  runs->alloc_bounds = merged->alloc_bounds;
+  free (merged);
+}
+
+void
+spill_runs_merge_begin (struct spill_runs *runs, bool sorted, size_t memory)
+{
+  if (fflush (runs->f) != 0)
+    die (EXIT_FAILURE, errno, _("write error on temporary file"));
+
+  /* At most 'num_readers' runs are merged together (at least two),
+     each with a buffer of at least RUN_BUFFER_MIN bytes */
+  const size_t num_buffers = memory / RUN_BUFFER_MIN;
+  runs->num_readers = num_buffers > 3 ? num_buffers - 1 : 2;
+  runs->num_readers = MIN (runs->num_readers, runs->num_runs);
+  size_t buf_size = memory / (runs->num_readers + 1);
+  buf_size = MIN (MAX (buf_size, RUN_BUFFER_MIN), RUN_BUFFER_MAX);
+
+  runs->sorted = sorted;
+  runs->readers = XCALLOC (runs->num_readers, struct run_reader);
+  runs->heap = XNMALLOC (runs->num_readers, size_t);
+  for (size_t i = 0; i < runs->num_readers; ++i)
+    {
+      struct run_reader *r = &runs->readers[i];
+      r->buf_size = buf_size;
+      r->buf = xmalloc (buf_size);
+      line_record_init (&r->cur.line);
+    }
+
+  while (runs->num_runs > runs->num_readers)
+    spill_runs_merge_pass (runs);
+
+  spill_runs_start_merge (runs, 0, runs->num_runs);
+}
+
+bool
+spill_runs_merge_next (struct spill_runs *runs,
+                       const struct line_record_t **line,
+                       const char * const **results, size_t *num_results)
+{
+  const struct run_reader *r = spill_runs_merge_reader (runs);
+  if (r == NULL)
+    return false;
+
+  *line = &r->cur.line;
+  *results = r->results;
+  *num_results = r->num_results;
+  return true;
+}
+
+void
+spill_runs_free (struct spill_runs *runs)
+{
+  if (runs->readers)
+    {
+      for (size_t i = 0; i < runs->num_readers; ++i)
+        {
+          free (runs->readers[i].buf);
+          free (runs->readers[i].results);
+          line_record_free (&runs->readers[i].cur.line);
+        }
+      free (runs->readers);
+    }
+  free (runs->heap);
+  free (runs->bounds);
+  if (runs->f)
+    spill_close (runs->f);
+  free (runs);
+}
@@ -0,0 +1,99 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __GROUP_SPILL_H__
+#define __GROUP_SPILL_H__
+
+/*
+ Temporary files for in-memory grouping with --memory-limit.
+
+ Once the group table is full, lines of new groups are written to
+ partition files (by the hash of their keys), and each partition is later
+ grouped separately.  The results of each group table are written as a
+ sorted 'run', and all runs are merged to produce the final output.
+ */
+
+/* Number of partitions each overflowing group table is split into */
+enum { SPILL_PARTITIONS = 16 };
+
+struct spill_partitions;
+
+/* Create partition files for lines overflowing a group table.
+   'level' is the partitioning depth (0 = lines from the input),
+   used to pick the hash seed. */
+struct spill_partitions*
+spill_partitions_new (size_t level);
+
+/* Write the line (with its input line number) to its partition */
+void
+spill_partitions_add_line (struct spill_partitions *sp,
+                           const struct line_record_t *lr, uintmax_t seq);
+
+/* Return the (rewound) partition file 'i', or NULL if it is empty.
+   The caller must close the returned file with 'spill_close'. */
+FILE*
+spill_partitions_take (struct spill_partitions *sp, size_t i);
+
+void
+spill_partitions_free (struct spill_partitions *sp);
+
+/* Read the next line from a partition file.
+   Returns false at the end of the file. */
+bool
+spill_read_line (FILE *f, struct line_record_t *lr, uintmax_t *seq);
+
+void
+spill_close (FILE *f);
+
+
+struct spill_runs;
+
+struct spill_runs*
+spill_runs_new ();
+
+/* Write the results of the groups (already in output order) as a new run */
+void
+spill_runs_add (struct spill_runs *runs, struct group_entry **groups,
+                size_t num_groups, size_t num_ops);
+
+size_t
+spill_runs_count (const struct spill_runs *runs);
+
+/* Start merging the runs, using (roughly) at most 'memory' bytes
+   for buffers: if there are too many runs for a buffer of each run,
+   groups of runs are first merged into fewer (larger) runs, in
+   several passes if needed. */
+void
+spill_runs_merge_begin (struct spill_runs *runs, bool sorted, size_t memory);
+
+/* Return the next group (in output order) of the merged runs.
+   On return, 'line' contains the group's line (or keys), and
+   'results'/'num_results' the (NUL-terminated) results of its
+   operations.  All are valid until the next call.
+   Returns false when all runs are exhausted. */
+bool
+spill_runs_merge_next (struct spill_runs *runs,
+                       const struct line_record_t **line,
+                       const char * const **results, size_t *num_results);
+
+void
+spill_runs_free (struct spill_runs *runs);
+
+#endif /* __GROUP_SPILL_H__ */
@@ -0,0 +1,387 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "system.h"
+#include "hash.h"
+#include "linebuffer.h"
+#include "xalloc.h"
+
+#include "text-options.h"
+#include "text-lines.h"
+#include "accum-type.h"
+#include "utils.h"
+#include "tdigest.h"
+#include "hyperloglog.h"
+#include "value-counts.h"
+#include "op-defs.h"
+#include "field-ops.h"
+#include "op-parser.h"
+#include "group-table.h"
+
+struct group_table
+{
+  Hash_table *ht;
+
+  /* All groups, in the order they were first seen */
+  struct group_entry **entries;
+  size_t num_entries;
+  size_t alloc_entries;
+
+  const struct fieldop *ops;  /* template field-ops, copied to new groups */
+  size_t num_ops;
+  bool full_lines;
+
+  size_t memory;              /* estimated memory used by all groups */
+};
+
+/* The group-by columns (1 = first field).
+   Module-level, as gnulib's hash functions do not take a context pointer;
+   they are the same for every table. */
+static size_t *key_cols = NULL;
+static size_t num_key_cols = 0;
+
+/* Scratch buffers used when comparing keys for sorting */
+static char *coll_buf[2] = { NULL, NULL };
+static size_t coll_buf_alloc[2] = { 0, 0 };
+
+#define SIZE_BITS (sizeof (size_t) * CHAR_BIT)
+
+static size_t _GL_ATTRIBUTE_PURE
+key_hash (const struct line_record_t *lr, size_t h)
+{
+  for (size_t i = 0; i < num_key_cols; ++i)
+    {
+      const struct field_record_t *f =
+        line_record_field_unsafe (lr, key_cols[i]);
+      const unsigned char *s = (const unsigned char*) f->buf;
+
+      for (size_t j = 0; j < f->len; ++j)
+        {
+          const unsigned char c = case_sensitive ? s[j] : tolower (s[j]);
+          h = c + ((h << 9) | (h >> (SIZE_BITS - 9)));
+        }
+      /* field boundary, so that "ab","c" and "a","bc" differ */
+      h = 0x1f + ((h << 9) | (h >> (SIZE_BITS - 9)));
+    }
+  return h;
+}
+
+static size_t _GL_ATTRIBUTE_PURE
+group_entry_hasher (const void *x, size_t tablesize)
+{
+  const struct group_entry *g = x;
+  return key_hash (&g->line, 0) % tablesize;
+}
+
+uint64_t _GL_ATTRIBUTE_PURE
+group_table_key_hash (const struct line_record_t *lr, uint64_t seed)
+{
+  /* Scramble the (weak) key hash, so that every bit depends on the seed
+     and on all the input bits (the 'fmix64' finalizer of MurmurHash3) */
+  uint64_t h = key_hash (lr, seed * UINT64_C (0x9e3779b97f4a7c15)) ^ seed;
+  h ^= h >> 33;
+  h *= UINT64_C (0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C (0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return h;
+}
+
+static bool _GL_ATTRIBUTE_PURE
+group_entry_comparator (const void *a, const void *b)
+{
+  const struct group_entry *ga = a;
+  const struct group_entry *gb = b;
+
+  for (size_t i = 0; i < num_key_cols; ++i)
+    {
+      const struct field_record_t *fa =
+        line_record_field_unsafe (&ga->line, key_cols[i]);
+      const struct field_record_t *fb =
+        line_record_field_unsafe (&gb->line, key_cols[i]);
+
+      if (fa->len != fb->len)
+        return false;
+      if (case_sensitive)
+        {
+          if (memcmp (fa->buf, fb->buf, fa->len) != 0)
+            return false;
+        }
+      else
+        {
+          for (size_t j = 0; j < fa->len; ++j)
+            if (tolower (to_uchar (fa->buf[j]))
+                != tolower (to_uchar (fb->buf[j])))
+              return false;
+        }
+    }
+  return true;
+}
+
+/* Copy field 'f' into scratch buffer 'n' as a NUL-terminated string,
+   folded to upper case with --ignore-case (as 'sort -f' does). */
+static const char*
+collation_key (int n, const struct field_record_t *f)
+{
+  if (coll_buf_alloc[n] <= f->len)
+    {
+      coll_buf_alloc[n] = MAX (f->len + 1, coll_buf_alloc[n] * 2);
+      coll_buf[n] = xrealloc (coll_buf[n], coll_buf_alloc[n]);
+    }
+
+  char *p = coll_buf[n];
+  if (case_sensitive)
+    memcpy (p, f->buf, f->len);
+  else
+    for (size_t j = 0; j < f->len; ++j)
+      p[j] = toupper (to_uchar (f->buf[j]));
+  p[f->len] = 0;
+  return p;
+}
+
+int
+group_entry_compare (const struct group_entry *ga, const struct group_entry *gb,
+                     bool sorted)
+{
+  for (size_t i = 0; sorted && i < num_key_cols; ++i)
+    {
+      const char *ka = collation_key (0,
+                          line_record_field_unsafe (&ga->line, key_cols[i]));
+      const char *kb = collation_key (1,
+                          line_record_field_unsafe (&gb->line, key_cols[i]));
+      int diff = strcoll (ka, kb);
+      if (diff)
+        return diff;
+    }
+
+  /* Equal keys: keep input order, like a stable sort */
+  return (ga->seq > gb->seq) - (ga->seq < gb->seq);
+}
+
+static int
+group_entry_collate (const void *a, const void *b)
+{
+  return group_entry_compare (*(struct group_entry * const *) a,
+                              *(struct group_entry * const *) b, true);
+}
+
+static void
+group_entry_store_line (const struct group_table *gt, struct group_entry *g,
+                        const struct line_record_t *lr)
+{
+  if (gt->full_lines)
+    line_record_copy (&g->line, lr);
+  else
+    line_record_copy_fields (&g->line, lr, key_cols, num_key_cols);
+}
+
+static void
+group_entry_free (struct group_entry *g, size_t num_ops)
+{
+  for (size_t i = 0; i < num_ops; ++i)
+    field_op_free (&g->ops[i]);
+  free (g->ops);
+  line_record_free (&g->line);
+  free (g);
+}
+
+struct group_table*
+group_table_init (const struct datamash_ops *dm, bool full_lines)
+{
+  struct group_table *gt = XZALLOC (struct group_table);
+
+  /* Set by the first table (before any worker thread creates its own,
+     see --threads), and kept after the table is freed: used for merging
+     spilled groups */
+  if (key_cols == NULL)
+    {
+      num_key_cols = dm->num_grps;
+      key_cols = XNMALLOC (num_key_cols + 1, size_t); /* never NULL */
+      for (size_t i = 0; i < num_key_cols; ++i)
+        key_cols[i] = dm->grps[i].num;
+    }
+
+  gt->ops = dm->ops;
+  gt->num_ops = dm->num_ops;
+  gt->full_lines = full_lines;
+  gt->ht = hash_initialize (1000, NULL, group_entry_hasher,
+                            group_entry_comparator, NULL);
+  if (gt->ht == NULL)
+    xalloc_die ();
+  return gt;
+}
+
+struct group_entry*
+group_table_find (struct group_table *gt, const struct line_record_t *lr)
+{
+  struct group_entry probe;
+  probe.line = *lr;
+  return hash_lookup (gt->ht, &probe);
+}
+
+/* Add the new group 'g' to the table */
+static void
+group_table_insert (struct group_table *gt, struct group_entry *g)
+{
+  if (hash_insert (gt->ht, g) == NULL)
+    xalloc_die ();
+
+  if (gt->num_entries >= gt->alloc_entries)
+    gt->entries = x2nrealloc (gt->entries, &gt->alloc_entries,
+                              sizeof *gt->entries);
+  gt->entries[gt->num_entries++] = g;
+}
+
+struct group_entry*
+group_table_lookup (struct group_table *gt, const struct line_record_t *lr,
+                    uintmax_t seq, bool* /*out*/ new_group)
+{
+  struct group_entry *g = group_table_find (gt, lr);
+  *new_group = (g == NULL);
+  if (g)
+    return g;
+
+  g = XZALLOC (struct group_entry);
+  group_entry_store_line (gt, g, lr);
+  g->seq = seq;
+  g->ops = XNMALLOC (gt->num_ops, struct fieldop);
+  for (size_t i = 0; i < gt->num_ops; ++i)
+    {
+      field_op_init_copy (&g->ops[i], &gt->ops[i]);
+      if (g->ops[i].master)
+        g->ops[i].slave_op = &g->ops[g->ops[i].slave_idx];
+      if (g->ops[i].values_op)
+        g->ops[i].values_op = &g->ops[g->ops[i].values_idx];
+    }
+
+  group_table_insert (gt, g);
+  return g;
+}
+
+enum FIELD_OP_COLLECT_RESULT
+group_table_merge (struct group_table *gt, struct group_table *src,
+                   uintmax_t seq_offset)
+{
+  enum FIELD_OP_COLLECT_RESULT rc = FLOCR_OK;
+
+  for (size_t i = 0; i < src->num_entries && field_op_ok (rc); ++i)
+    {
+      struct group_entry *s = src->entries[i];
+      struct group_entry *g = group_table_find (gt, &s->line);
+
+      if (g == NULL)
+        {
+          /* A new group: move it as-is */
+          s->seq += seq_offset;
+          s->memory = 0;
+          group_table_insert (gt, s);
+          src->entries[i] = NULL;
+          continue;
+        }
+
+      bool keep_line = false;
+      for (size_t j = 0; j < gt->num_ops && field_op_ok (rc); ++j)
+        {
+          rc = field_op_merge (&g->ops[j], &s->ops[j]);
+          keep_line = keep_line || (rc == FLOCR_OK_KEEP_LINE);
+        }
+      if (keep_line)
+        group_entry_store_line (gt, g, &s->line);
+    }
+
+  hash_free (src->ht);
+  for (size_t i = 0; i < src->num_entries; ++i)
+    if (src->entries[i])
+      group_entry_free (src->entries[i], src->num_ops);
+  free (src->entries);
+  free (src);
+  return field_op_ok (rc) ? FLOCR_OK : rc;
+}
+
+void
+group_table_set_line (struct group_table *gt, struct group_entry *g,
+                      const struct line_record_t *lr)
+{
+  group_entry_store_line (gt, g, lr);
+}
+
+size_t _GL_ATTRIBUTE_PURE
+group_table_num_entries (const struct group_table *gt)
+{
+  return gt->num_entries;
+}
+
+void
+group_table_update_memory (struct group_table *gt, struct group_entry *g)
+{
+  /* The entry, its copy of the line, its field-ops, and roughly
+     the hash-table bucket and 'entries' slot pointing to it. */
+  size_t m = sizeof *g + 4 * sizeof (void*)
+             + g->line.lbuf.size
+             + g->line.alloc_fields * sizeof (struct field_record_t)
+             + gt->num_ops * sizeof (struct fieldop);
+  for (size_t i = 0; i < gt->num_ops; ++i)
+    m += field_op_memory (&g->ops[i]);
+
+  gt->memory = gt->memory - g->memory + m;
+  g->memory = m;
+}
+
+size_t _GL_ATTRIBUTE_PURE
+group_table_memory (const struct group_table *gt)
+{
+  return gt->memory;
+}
+
+struct group_entry**
+group_table_entries (struct group_table *gt, bool sorted)
+{
+  if (sorted && gt->num_entries > 1)
+    qsort (gt->entries, gt->num_entries, sizeof *gt->entries,
+           group_entry_collate);
+  return gt->entries;
+}
+
+void
+group_table_free (struct group_table *gt)
+{
+  hash_free (gt->ht);
+  for (size_t i = 0; i < gt->num_entries; ++i)
+    group_entry_free (gt->entries[i], gt->num_ops);
+  free (gt->entries);
+  free (gt);
+
+  for (int i = 0; i < 2; ++i)
+    {
+      free (coll_buf[i]);
+      coll_buf[i] = NULL;
+      coll_buf_alloc[i] = 0;
+    }
+}
@@ -0,0 +1,114 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __GROUP_TABLE_H__
+#define __GROUP_TABLE_H__
+
+/*
+ In-memory grouping of unsorted input.
+
+ Each distinct combination of group-by keys gets its own entry, holding
+ a copy of the keys and a private copy of the field operations.
+ Used with --sort instead of piping the input through sort(1).
+ */
+
+struct group_entry
+{
+  /* A compact copy of the group-by fields of the first line in the group,
+     or (with --full) a copy of the entire representative line. */
+  struct line_record_t line;
+
+  /* The input line number of the first line in the group */
+  uintmax_t seq;
+
+  /* This group's field operations (same layout as datamash_ops.ops) */
+  struct fieldop *ops;
+
+  /* Estimated memory used by this group (see group_table_update_memory) */
+  size_t memory;
+};
+
+struct group_table;
+
+/* Create a new group table for the group-by columns and field-ops in 'dm'.
+   If 'full_lines' is true, entire lines are stored instead of just the
+   group-by fields. */
+struct group_table*
+group_table_init (const struct datamash_ops *dm, bool full_lines);
+
+/* Return the group of the line 'lr', creating a new one if needed
+   (in which case 'new_group' is set to true).
+   The line must have all the group-by fields. */
+struct group_entry*
+group_table_lookup (struct group_table *gt, const struct line_record_t *lr,
+                    uintmax_t seq, bool* /*out*/ new_group);
+
+/* Merge the groups of 'src' (collected from later input lines, numbered
+   from 'seq_offset' + 1) into 'gt', as if their lines were added to 'gt'
+   (see field_op_merge), and free 'src'.
+   Returns FLOCR_OK, or the error of a field-op merge. */
+enum FIELD_OP_COLLECT_RESULT
+group_table_merge (struct group_table *gt, struct group_table *src,
+                   uintmax_t seq_offset);
+
+/* Return the group of the line 'lr', or NULL if there is no such group */
+struct group_entry*
+group_table_find (struct group_table *gt, const struct line_record_t *lr);
+
+/* Replace the representative line of the group (for operations which
+   select a specific line, e.g. last/min/max). */
+void
+group_table_set_line (struct group_table *gt, struct group_entry *g,
+                      const struct line_record_t *lr);
+
+size_t
+group_table_num_entries (const struct group_table *gt);
+
+/* Re-calculate the memory used by group 'g' (e.g. after collecting
+   more values), and update the table's total. */
+void
+group_table_update_memory (struct group_table *gt, struct group_entry *g);
+
+/* Return the estimated memory (in bytes) used by the table and its groups */
+size_t
+group_table_memory (const struct group_table *gt);
+
+/* Return a hash of the group-by fields of 'lr'.  Different 'seed' values
+   give unrelated hash values (used to re-partition spilled groups). */
+uint64_t
+group_table_key_hash (const struct line_record_t *lr, uint64_t seed);
+
+/* Compare the groups 'a' and 'b' in output order: by key (if 'sorted'),
+   then by order of first appearance. Only the 'line' and 'seq' members
+   are used. */
+int
+group_entry_compare (const struct group_entry *a, const struct group_entry *b,
+                     bool sorted);
+
+/* Return the groups, either in the order they first appeared in the input,
+   or (if 'sorted' is true) ordered by their keys the same way
+   'sort -s -kX,X' (with '-f' for --ignore-case) would order them. */
+struct group_entry**
+group_table_entries (struct group_table *gt, bool sorted);
+
+void
+group_table_free (struct group_table *gt);
+
+#endif /* __GROUP_TABLE_H__ */
@@ -0,0 +1,284 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "system.h"
+#include "xalloc.h"
+#include "count-leading-zeros.h"
+
+#include "hyperloglog.h"
+
+/* The value of a sparse entry (the low 6 bits) */
+#define HLL_ENTRY_VALUE_BITS 6
+#define HLL_ENTRY_VALUE_MASK ((1u << HLL_ENTRY_VALUE_BITS) - 1)
+
+/* Returns the register value of the hash bits 'w' (the bits following
+   the register number, in the high bits): the number of leading zeros
+   plus one, with at most 'bits' bits */
+static unsigned int
+hll_value (uint64_t w, unsigned int bits)
+{
+  return w ? count_leading_zeros_ll (w) + 1 : bits + 1;
+}
+
+static void
+hll_set_register (struct hyperloglog *h, size_t idx, unsigned int value)
+{
+  if (value > h->registers[idx])
+    h->registers[idx] = value;
+}
+
+/* Add the sparse entry 'entry' to the registers of 'h' */
+static void
+hll_add_dense_entry (struct hyperloglog *h, uint32_t entry,
+                     unsigned int precision)
+{
+  const uint32_t index = entry >> HLL_ENTRY_VALUE_BITS;
+  const unsigned int shift = HLL_SPARSE_PRECISION - precision;
+  const uint32_t low = index & ((1u << shift) - 1);
+
+  /* The leading zeros are in the extra bits of the sparse index, if not
+     all zero, and then in the bits of the sparse value */
+  const unsigned int value = low
+    ? count_leading_zeros (low) - (32 - shift) + 1
+    : shift + (entry & HLL_ENTRY_VALUE_MASK);
+  hll_set_register (h, index >> shift, value);
+}
+
+/* Switch 'h' to the dense representation */
+static void
+hll_densify (struct hyperloglog *h, unsigned int precision)
+{
+  h->registers = xzalloc ((size_t) 1 << precision);
+  for (size_t i = 0; i < h->num_sparse; ++i)
+    hll_add_dense_entry (h, h->sparse[i], precision);
+
+  free (h->sparse);
+  h->sparse = NULL;
+  h->num_sparse = h->num_sorted = h->alloc_sparse = 0;
+}
+
+static int
+cmp_uint32 (const void *p1, const void *p2)
+{
+  const uint32_t a = *(const uint32_t *) p1;
+  const uint32_t b = *(const uint32_t *) p2;
+  return (a > b) - (a < b);
+}
+
+/* Sort the sparse entries, keeping one (the largest value) per index */
+static void
+hll_compact (struct hyperloglog *h)
+{
+  if (h->num_sorted == h->num_sparse)
+    return;
+
+  qsort (h->sparse, h->num_sparse, sizeof (uint32_t), cmp_uint32);
+
+  size_t n = 0;
+  for (size_t i = 0; i < h->num_sparse; ++i)
+    {
+      if (n > 0 && (h->sparse[i] >> HLL_ENTRY_VALUE_BITS)
+                   == (h->sparse[n - 1] >> HLL_ENTRY_VALUE_BITS))
+        --n;
+      h->sparse[n++] = h->sparse[i];
+    }
+  h->num_sparse = h->num_sorted = n;
+}
+
+void
+hll_add_sparse_entry (struct hyperloglog *h, uint32_t entry,
+                      unsigned int precision)
+{
+  assert (hll_sparse_entry_valid (entry)); /* LCOV_EXCL_LINE */
+
+  if (!h->registers && h->num_sparse == h->alloc_sparse)
+    {
+      hll_compact (h);
+
+      /* Once the distinct entries use more than half the memory of the
+         registers, the registers are smaller and accurate enough */
+      if (h->num_sorted * sizeof (uint32_t) > ((size_t) 1 << precision) / 2)
+        hll_densify (h, precision);
+      else if (h->num_sparse >= h->alloc_sparse / 2)
+        h->sparse = x2nrealloc (h->sparse, &h->alloc_sparse,
+                                sizeof (uint32_t));
+    }
+
+  if (h->registers)
+    hll_add_dense_entry (h, entry, precision);
+  else
+    h->sparse[h->num_sparse++] = entry;
+}
+
+void
+hll_add (struct hyperloglog *h, uint64_t hash, unsigned int precision)
+{
+  if (h->registers)
+    {
+      hll_set_register (h, hash >> (64 - precision),
+                        hll_value (hash << precision, 64 - precision));
+      return;
+    }
+
+  const uint32_t index = hash >> (64 - HLL_SPARSE_PRECISION);
+  const unsigned int value = hll_value (hash << HLL_SPARSE_PRECISION,
+                                        64 - HLL_SPARSE_PRECISION);
+  hll_add_sparse_entry (h, index << HLL_ENTRY_VALUE_BITS | value,
+                        precision);
+}
+
+bool _GL_ATTRIBUTE_CONST
+hll_sparse_entry_valid (uint32_t entry)
+{
+  const unsigned int value = entry & HLL_ENTRY_VALUE_MASK;
+  return (entry >> (HLL_SPARSE_PRECISION + HLL_ENTRY_VALUE_BITS)) == 0
+         && value >= 1 && value <= 64 - HLL_SPARSE_PRECISION + 1;
+}
+
+void
+hll_add_registers (struct hyperloglog *h, const unsigned char *registers,
+                   unsigned int precision)
+{
+  if (!h->registers)
+    hll_densify (h, precision);
+
+  const size_t m = (size_t) 1 << precision;
+  for (size_t i = 0; i < m; ++i)
+    hll_set_register (h, i, registers[i]);
+}
+
+void
+hll_merge (struct hyperloglog *h, const struct hyperloglog *src,
+           unsigned int precision)
+{
+  if (src->registers)
+    hll_add_registers (h, src->registers, precision);
+  else
+    for (size_t i = 0; i < src->num_sparse; ++i)
+      hll_add_sparse_entry (h, src->sparse[i], precision);
+}
+
+/* The functions sigma and tau of Ertl's estimator (0 <= x <= 1).
+   The series are summed until they no longer change: the terms of
+   sigma only increase it, those of tau only decrease it. */
+static double _GL_ATTRIBUTE_CONST
+hll_sigma (double x)
+{
+  if (x >= 1)
+    return INFINITY;
+
+  double y = 1, z = x, prev;
+  do
+    {
+      x *= x;
+      prev = z;
+      z += x * y;
+      y += y;
+    }
+  while (z > prev);
+  return z;
+}
+
+static double
+hll_tau (double x)
+{
+  if (x <= 0 || x >= 1)
+    return 0;
+
+  double y = 1, z = 1 - x, prev;
+  do
+    {
+      x = sqrt (x);
+      prev = z;
+      y *= 0.5;
+      z -= (1 - x) * (1 - x) * y;
+    }
+  while (z < prev);
+  return z / 3;
+}
+
+/* Estimate from the histogram 'c' of the values of the 2^'precision'
+   registers ('c[k]' registers have the value k, 0 <= k <= 65-precision) */
+static double
+hll_estimate_histogram (const size_t *c, unsigned int precision)
+{
+  const unsigned int q = 64 - precision;
+  const double m = ldexp (1, precision);
+
+  double z = m * hll_tau (1 - c[q + 1] / m);
+  for (unsigned int k = q; k >= 1; --k)
+    z = 0.5 * (z + c[k]);
+  z += m * hll_sigma (c[0] / m);
+
+  return m * m / (2 * log (2) * z);
+}
+
+double
+hll_estimate (struct hyperloglog *h, unsigned int precision)
+{
+  size_t c[64 + 2] = { 0 };
+
+  if (h->registers)
+    {
+      const size_t m = (size_t) 1 << precision;
+      for (size_t i = 0; i < m; ++i)
+        c[h->registers[i]]++;
+      return hll_estimate_histogram (c, precision);
+    }
+
+  /* The sparse entries are the non-zero registers of a sketch with the
+     sparse precision */
+  hll_compact (h);
+  c[0] = ((size_t) 1 << HLL_SPARSE_PRECISION) - h->num_sparse;
+  for (size_t i = 0; i < h->num_sparse; ++i)
+    c[h->sparse[i] & HLL_ENTRY_VALUE_MASK]++;
+  return hll_estimate_histogram (c, HLL_SPARSE_PRECISION);
+}
+
+void
+hll_reset (struct hyperloglog *h)
+{
+  free (h->registers);
+  h->registers = NULL;
+  h->num_sparse = h->num_sorted = 0;
+}
+
+size_t _GL_ATTRIBUTE_PURE
+hll_memory (const struct hyperloglog *h, unsigned int precision)
+{
+  return (h->registers ? (size_t) 1 << precision : 0)
+         + h->alloc_sparse * sizeof (uint32_t);
+}
+
+void
+hll_free (struct hyperloglog *h)
+{
+  free (h->registers);
+  free (h->sparse);
+  memset (h, 0, sizeof (*h));
+}
@@ -0,0 +1,103 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HYPERLOGLOG_H__
+#define __HYPERLOGLOG_H__
+
+/*
+ Approximate number of distinct values with a HyperLogLog sketch
+ (Flajolet et al., 2007), with the sparse representation of HyperLogLog++
+ (Heule et al., 2013) and the estimator of O. Ertl ("New cardinality
+ estimation algorithms for HyperLogLog sketches", 2017).
+
+ Each value is hashed (64 bits).  With the 'precision' p, the first p bits
+ of the hash select one of 2^p registers, which keeps the largest number
+ of leading zeros (plus one) of the other bits.  The relative standard
+ error of the estimate is about 1.04/sqrt(2^p), with 2^p bytes of
+ registers.
+
+ Until the registers would use less memory, the sketch is 'sparse': it
+ keeps the distinct (register,value) pairs with a precision of 25 bits,
+ which is close to exact for small numbers of distinct values.
+
+ Sketches (with the same precision) can be merged.
+ */
+
+/* Precision of the sparse representation */
+#define HLL_SPARSE_PRECISION 25
+
+/* The largest valid precision (sparse entries must hold the register
+   values of the dense representation) */
+#define HLL_MAX_PRECISION 18
+
+struct hyperloglog
+{
+  /* Dense representation: 2^p registers (NULL while sparse) */
+  unsigned char *registers;
+
+  /* Sparse representation: the register number (with 25 bits of
+     precision) and value of each entry, as 'index << 6 | value'.
+     The first 'num_sorted' entries are sorted and distinct. */
+  uint32_t *sparse;
+  size_t   num_sparse;
+  size_t   num_sorted;
+  size_t   alloc_sparse;
+};
+
+/* Add the value of hash 'hash' (e.g. of 'hash_string') to 'h' */
+void
+hll_add (struct hyperloglog *h, uint64_t hash, unsigned int precision);
+
+/* Returns true if 'entry' is a valid sparse entry */
+bool
+hll_sparse_entry_valid (uint32_t entry);
+
+/* Add the sparse entry 'entry' (as stored in 'sparse') to 'h' */
+void
+hll_add_sparse_entry (struct hyperloglog *h, uint32_t entry,
+                      unsigned int precision);
+
+/* Add the 2^precision dense 'registers' (e.g. of another sketch) to 'h' */
+void
+hll_add_registers (struct hyperloglog *h, const unsigned char *registers,
+                   unsigned int precision);
+
+/* Add the values of the sketch 'src' to 'h' */
+void
+hll_merge (struct hyperloglog *h, const struct hyperloglog *src,
+           unsigned int precision);
+
+/* Returns the estimated number of distinct values added to 'h' */
+double
+hll_estimate (struct hyperloglog *h, unsigned int precision);
+
+/* Remove all the values (keeping the allocated sparse memory) */
+void
+hll_reset (struct hyperloglog *h);
+
+/* Returns the number of bytes allocated by the sketch */
+size_t
+hll_memory (const struct hyperloglog *h, unsigned int precision);
+
+/* Frees the internal structures of the sketch (not 'h' itself) */
+void
+hll_free (struct hyperloglog *h);
+
+#endif /* __HYPERLOGLOG_H__ */
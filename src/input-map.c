@@ -0,0 +1,180 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+#include "system.h"
+#include "ignore-value.h"
+
+#include "input-map.h"
+
+#if defined HAVE_MMAP && !defined MAP_ANONYMOUS && defined MAP_ANON
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+FILE *input_map_stream = NULL;
+
+#if defined HAVE_MMAP && defined MAP_ANONYMOUS
+
+/* The mapped pages (including the trailing zero page) */
+static char *map_addr;
+static size_t map_len;
+
+/* The input: the first, next and last+1 bytes */
+static const char *input_beg;
+static const char *input_pos;
+static const char *input_end;
+
+/* The file offset of 'input_beg' */
+static off_t input_offset;
+
+bool
+input_map_open (FILE *stream)
+{
+  struct stat st;
+  const int fd = fileno (stream);
+  const long page_size = sysconf (_SC_PAGESIZE);
+  const off_t offset = ftello (stream);
+
+  if (fd < 0 || page_size <= 0 || offset < 0
+      || fstat (fd, &st) != 0 || !S_ISREG (st.st_mode)
+      || st.st_size <= offset)
+    return false;
+
+  /* The file can only be mapped from a page boundary */
+  const off_t file_offset = offset - offset % page_size;
+  if ((uintmax_t) (st.st_size - file_offset) > SIZE_MAX - 2 * page_size)
+    return false;
+  const size_t file_len = st.st_size - file_offset;
+
+  /* Reserve the address range first, with an extra page: the file is
+     mapped over the beginning, and whatever follows it reads as zero */
+  const size_t len = ((file_len + page_size - 1) / page_size + 1) * page_size;
+  char *addr = mmap (NULL, len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED)
+    return false;
+  if (mmap (addr, file_len, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+            fd, file_offset) == MAP_FAILED)
+    {
+      munmap (addr, len);
+      return false;
+    }
+
+#ifdef HAVE_MADVISE
+  /* Only hints: read-ahead aggressively, and use huge pages if the
+     file system supports them */
+# ifdef MADV_SEQUENTIAL
+  ignore_value (madvise (addr, file_len, MADV_SEQUENTIAL));
+# endif
+# ifdef MADV_HUGEPAGE
+  ignore_value (madvise (addr, file_len, MADV_HUGEPAGE));
+# endif
+#endif
+
+  map_addr = addr;
+  map_len = len;
+  input_beg = input_pos = addr + (offset - file_offset);
+  input_end = addr + file_len;
+  input_offset = offset;
+  input_map_stream = stream;
+  return true;
+}
+
+bool
+input_map_read_line (char delimiter, const char **line, size_t *len)
+{
+  if (input_pos == input_end)
+    return false;
+
+  const char *eol = memchr (input_pos, delimiter, input_end - input_pos);
+  *line = input_pos;
+  if (eol)
+    {
+      *len = eol - input_pos;
+      input_pos = eol + 1;
+    }
+  else
+    {
+      /* The last line, without a delimiter */
+      *len = input_end - input_pos;
+      input_pos = input_end;
+    }
+  return true;
+}
+
+void
+input_map_read_all (const char **data, size_t *len)
+{
+  *data = input_pos;
+  *len = input_end - input_pos;
+  input_pos = input_end;
+}
+
+void
+input_map_close (void)
+{
+  if (input_map_stream == NULL)
+    return;
+
+  munmap (map_addr, map_len);
+  ignore_value (fseeko (input_map_stream,
+                        input_offset + (input_pos - input_beg), SEEK_SET));
+  input_map_stream = NULL;
+}
+
+#else
+
+bool
+input_map_open (FILE *stream _GL_UNUSED)
+{
+  return false;
+}
+
+bool
+input_map_read_line (char delimiter _GL_UNUSED,
+                     const char **line _GL_UNUSED, size_t *len _GL_UNUSED)
+{
+  return false;
+}
+
+void
+input_map_read_all (const char **data, size_t *len)
+{
+  *data = NULL;
+  *len = 0;
+}
+
+void
+input_map_close (void)
+{
+}
+
+#endif
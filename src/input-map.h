@@ -0,0 +1,68 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __INPUT_MAP_H__
+#define __INPUT_MAP_H__
+
+/*
+ Memory-mapped input.
+
+ When the input is a regular file (e.g. 'datamash sum 1 < FILE'), it is
+ mapped into memory, and the lines read by line_record_fread point
+ directly into the mapping: no copying, and no stdio calls per line.
+
+ The mapping is read-only, and is always followed by at least one NUL
+ byte (as if the file was NUL-terminated), so that scanning functions
+ (e.g. strtold, strspn) stop at the end of the input.
+
+ The lines remain valid until input_map_close.
+ */
+
+/* The mapped stream, or NULL */
+extern FILE *input_map_stream;
+
+/* Map the remaining input of 'stream' (from its current position) into
+   memory.  Returns false if it's not a regular file, or can't be mapped
+   (the stream must then be read as usual). */
+bool
+input_map_open (FILE *stream);
+
+/* Returns the next line (without the delimiter) from the mapped input.
+   Returns false at the end of the input. */
+bool
+input_map_read_line (char delimiter, const char **line, size_t *len);
+
+/* Returns all the remaining lines of the mapped input at once
+   (the next read returns end of input). */
+void
+input_map_read_all (const char **data, size_t *len);
+
+/* Unmap the input, and set the file offset of the stream to the end
+   of the consumed input (as if it was read with stdio). */
+void
+input_map_close (void);
+
+static inline bool
+input_map_active (const FILE *stream)
+{
+  return stream == input_map_stream;
+}
+
+#endif /* __INPUT_MAP_H__ */
@@ -0,0 +1,498 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined HAVE_STDATOMIC_H && !defined __STDC_NO_ATOMICS__
+# define USE_INPUT_THREADS 1
+# include <pthread.h>
+# include <stdatomic.h>
+#endif
+
+#include "system.h"
+#include "die.h"
+#include "linebuffer.h"
+#include "xalloc.h"
+
+#include "text-options.h"
+#include "text-lines.h"
+#include "input-map.h"
+#include "input-threads.h"
+
+FILE *input_threads_stream = NULL;
+
+#ifdef USE_INPUT_THREADS
+
+/* The amount of input read (or cut from the mapped file) at once */
+#define CHUNK_SIZE (1024 * 1024)
+
+struct chunk
+{
+  /* The input: complete lines.  When reading a stream, they are stored
+     in 'buf' and copied into the line records (the buffer is reused).
+     When reading a mapped file, they point into the mapping. */
+  char *buf;
+  size_t buf_size;
+  const char *data;
+  size_t len;
+  bool copy;
+
+  /* The lines, split into fields by a worker thread */
+  struct line_record_t *lines;
+  size_t num_lines;
+  size_t alloc_lines;
+
+  /* The next line returned by input_threads_read_line */
+  size_t next_line;
+
+  /* The value returned by 'process_chunk' for the lines */
+  void *result;
+};
+
+/* A bounded single-producer/single-consumer queue of chunks.
+   NULL is pushed to mark the end of the input. */
+struct queue
+{
+  struct chunk **slots;
+  size_t capacity;
+  atomic_size_t head;   /* the next slot to pop */
+  atomic_size_t tail;   /* the next slot to push */
+  atomic_bool waiting;  /* one end is blocked on 'cond' */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+
+static size_t num_workers;
+static pthread_t reader_thread;
+static pthread_t *worker_threads;
+
+static struct chunk *chunks;
+static size_t num_chunks;
+static input_threads_chunk_fn process_chunk;
+
+/* main thread -> reader -> worker N -> main thread */
+static struct queue free_chunks;
+static struct queue *worker_input;
+static struct queue *worker_output;
+
+/* Reader thread state: the rest of the mapped input, or the incomplete
+   last line of the previous chunk */
+static bool mapped;
+static const char *map_pos;
+static const char *map_end;
+static char *carry;
+static size_t carry_len;
+static size_t carry_size;
+
+/* Main thread state */
+static struct chunk *current;
+static size_t next_worker;
+static bool input_done;
+
+static void
+queue_init (struct queue *q, size_t capacity)
+{
+  q->slots = XNMALLOC (capacity, struct chunk *);
+  q->capacity = capacity;
+  atomic_init (&q->head, 0);
+  atomic_init (&q->tail, 0);
+  atomic_init (&q->waiting, false);
+  pthread_mutex_init (&q->lock, NULL);
+  pthread_cond_init (&q->cond, NULL);
+}
+
+static void
+queue_free (struct queue *q)
+{
+  pthread_cond_destroy (&q->cond);
+  pthread_mutex_destroy (&q->lock);
+  free (q->slots);
+}
+
+static bool
+queue_is_empty (struct queue *q)
+{
+  return atomic_load (&q->tail) == atomic_load (&q->head);
+}
+
+static bool
+queue_is_full (struct queue *q)
+{
+  return atomic_load (&q->tail) - atomic_load (&q->head) == q->capacity;
+}
+
+/* Block until 'blocked' is false (i.e. the other end pushed or popped).
+   'waiting' is set before checking again, and the other end checks it
+   after updating the queue: either it sees the flag, and signals, or
+   this thread sees the update. */
+static void
+queue_wait (struct queue *q, bool (*blocked) (struct queue *))
+{
+  pthread_mutex_lock (&q->lock);
+  atomic_store (&q->waiting, true);
+  while (blocked (q))
+    pthread_cond_wait (&q->cond, &q->lock);
+  atomic_store (&q->waiting, false);
+  pthread_mutex_unlock (&q->lock);
+}
+
+static void
+queue_wake (struct queue *q)
+{
+  if (atomic_load (&q->waiting))
+    {
+      pthread_mutex_lock (&q->lock);
+      pthread_cond_signal (&q->cond);
+      pthread_mutex_unlock (&q->lock);
+    }
+}
+
+static void
+queue_push (struct queue *q, struct chunk *c)
+{
+  if (queue_is_full (q))
+    queue_wait (q, queue_is_full);
+  const size_t tail = atomic_load (&q->tail);
+  q->slots[tail % q->capacity] = c;
+  atomic_store (&q->tail, tail + 1);
+  queue_wake (q);
+}
+
+static struct chunk *
+queue_pop (struct queue *q)
+{
+  if (queue_is_empty (q))
+    queue_wait (q, queue_is_empty);
+  const size_t head = atomic_load (&q->head);
+  struct chunk *c = q->slots[head % q->capacity];
+  atomic_store (&q->head, head + 1);
+  queue_wake (q);
+  return c;
+}
+
+/* Cut the next chunk of complete lines from the mapped input */
+static bool
+fill_chunk_mapped (struct chunk *c)
+{
+  if (map_pos == map_end)
+    return false;
+
+  const char *end = map_pos + MIN (CHUNK_SIZE, (size_t) (map_end - map_pos));
+  if (end < map_end)
+    {
+      const char *eol = memchr (end - 1, eolchar, map_end - (end - 1));
+      end = eol ? eol + 1 : map_end;
+    }
+  c->data = map_pos;
+  c->len = end - map_pos;
+  c->copy = false;
+  map_pos = end;
+  return true;
+}
+
+/* Read the next chunk of complete lines from the stream (the last line
+   of the input may lack a delimiter) */
+static bool
+fill_chunk_stream (struct chunk *c)
+{
+  size_t len = carry_len;
+
+  if (c->buf_size < len + CHUNK_SIZE)
+    {
+      c->buf_size = len + CHUNK_SIZE;
+      c->buf = xrealloc (c->buf, c->buf_size);
+    }
+  if (carry_len)
+    memcpy (c->buf, carry, carry_len);
+  carry_len = 0;
+
+  while (true)
+    {
+      const size_t n = fread (c->buf + len, 1, CHUNK_SIZE,
+                              input_threads_stream);
+      len += n;
+      if (n == 0)
+        {
+          /* End of input (or read error, reported by close_input) */
+          if (len == 0)
+            return false;
+          break;
+        }
+
+      /* Keep the incomplete last line for the next chunk */
+      const char *p = c->buf + len;
+      while (p > c->buf + len - n && p[-1] != eolchar)
+        --p;
+      if (p > c->buf + len - n)
+        {
+          carry_len = c->buf + len - p;
+          if (carry_size < carry_len)
+            {
+              carry_size = carry_len;
+              carry = xrealloc (carry, carry_size);
+            }
+          if (carry_len > 0)
+            memcpy (carry, p, carry_len);
+          len = p - c->buf;
+          break;
+        }
+
+      /* No complete line yet: read more */
+      if (c->buf_size < len + CHUNK_SIZE)
+        {
+          c->buf_size = MAX (c->buf_size * 2, len + CHUNK_SIZE);
+          c->buf = xrealloc (c->buf, c->buf_size);
+        }
+    }
+
+  c->data = c->buf;
+  c->len = len;
+  c->copy = true;
+  return true;
+}
+
+static void *
+reader_main (void *arg _GL_UNUSED)
+{
+  size_t worker = 0;
+
+  while (true)
+    {
+      struct chunk *c = queue_pop (&free_chunks);
+      if (!(mapped ? fill_chunk_mapped (c) : fill_chunk_stream (c)))
+        break;
+      queue_push (&worker_input[worker], c);
+      worker = (worker + 1) % num_workers;
+    }
+
+  /* The main thread takes the chunks round-robin: it will find the end
+     marker in the queue of the worker after the last chunk. */
+  for (size_t i = 0; i < num_workers; ++i)
+    queue_push (&worker_input[i], NULL);
+  return NULL;
+}
+
+/* Split the chunk into lines, and the lines into fields */
+static void
+split_chunk (struct chunk *c)
+{
+  const char *p = c->data;
+  const char *end = c->data + c->len;
+
+  c->num_lines = 0;
+  c->next_line = 0;
+  while (p < end)
+    {
+      const char *eol = memchr (p, eolchar, end - p);
+      const char *line_end = eol ? eol : end;
+
+      if (c->num_lines == c->alloc_lines)
+        {
+          c->lines = x2nrealloc (c->lines, &c->alloc_lines,
+                                 sizeof *c->lines);
+          for (size_t i = c->num_lines; i < c->alloc_lines; ++i)
+            line_record_init (&c->lines[i]);
+        }
+      if (line_record_load (&c->lines[c->num_lines], p, line_end - p,
+                            c->copy))
+        c->num_lines++;
+      p = eol ? eol + 1 : end;
+    }
+}
+
+static void *
+worker_main (void *arg)
+{
+  const size_t w = (uintptr_t) arg;
+  struct chunk *c;
+
+  while ((c = queue_pop (&worker_input[w])) != NULL)
+    {
+      split_chunk (c);
+      c->result = process_chunk ? process_chunk (c->lines, c->num_lines)
+                                : NULL;
+      queue_push (&worker_output[w], c);
+    }
+  queue_push (&worker_output[w], NULL);
+  return NULL;
+}
+
+bool
+input_threads_start (FILE *stream, size_t workers, input_threads_chunk_fn fn)
+{
+  int err;
+
+  num_workers = workers;
+  process_chunk = fn;
+  num_chunks = 2 * workers + 2;
+  chunks = xcalloc (num_chunks, sizeof *chunks);
+
+  /* Each queue can hold all the chunks (and the end marker) */
+  queue_init (&free_chunks, num_chunks + 1);
+  for (size_t i = 0; i < num_chunks; ++i)
+    queue_push (&free_chunks, &chunks[i]);
+  worker_input = XNMALLOC (num_workers, struct queue);
+  worker_output = XNMALLOC (num_workers, struct queue);
+  for (size_t i = 0; i < num_workers; ++i)
+    {
+      queue_init (&worker_input[i], num_chunks + 1);
+      queue_init (&worker_output[i], num_chunks + 1);
+    }
+
+  mapped = input_map_active (stream);
+  if (mapped)
+    {
+      size_t len;
+      input_map_read_all (&map_pos, &len);
+      map_end = map_pos + len;
+    }
+
+  input_threads_stream = stream;
+  current = NULL;
+  next_worker = 0;
+  input_done = false;
+
+  worker_threads = XNMALLOC (num_workers, pthread_t);
+  for (size_t i = 0; i < num_workers; ++i)
+    if ((err = pthread_create (&worker_threads[i], NULL, worker_main,
+                               (void *) (uintptr_t) i)) != 0)
+      die (EXIT_FAILURE, err, _("failed to create thread"));
+  if ((err = pthread_create (&reader_thread, NULL, reader_main, NULL)) != 0)
+    die (EXIT_FAILURE, err, _("failed to create thread"));
+  return true;
+}
+
+/* Return the current chunk to the reader, and take the next one.
+   Returns false at the end of the input. */
+static bool
+next_chunk (void)
+{
+  if (input_done)
+    return false;
+  if (current)
+    queue_push (&free_chunks, current);
+  current = queue_pop (&worker_output[next_worker]);
+  next_worker = (next_worker + 1) % num_workers;
+  if (current == NULL)
+    input_done = true;
+  return !input_done;
+}
+
+bool
+input_threads_read_line (struct line_record_t *lr)
+{
+  while (current == NULL || current->next_line == current->num_lines)
+    if (!next_chunk ())
+      return false;
+
+  /* Swap, not copy: the chunk's line record gets the previous buffers
+     of 'lr', to be reused by the worker */
+  struct line_record_t tmp = *lr;
+  *lr = current->lines[current->next_line];
+  current->lines[current->next_line++] = tmp;
+  return true;
+}
+
+bool
+input_threads_read_chunk (const struct line_record_t **lines,
+                          size_t *num_lines, void **result)
+{
+  if (!next_chunk ())
+    return false;
+
+  current->next_line = current->num_lines;
+  *lines = current->lines;
+  *num_lines = current->num_lines;
+  *result = current->result;
+  return true;
+}
+
+void
+input_threads_stop (void)
+{
+  if (input_threads_stream == NULL)
+    return;
+
+  /* Consume the rest of the input (if not read entirely),
+     so that all the threads end */
+  while (next_chunk ())
+    ;
+
+  pthread_join (reader_thread, NULL);
+  for (size_t i = 0; i < num_workers; ++i)
+    pthread_join (worker_threads[i], NULL);
+
+  for (size_t i = 0; i < num_chunks; ++i)
+    {
+      for (size_t j = 0; j < chunks[i].alloc_lines; ++j)
+        line_record_free (&chunks[i].lines[j]);
+      free (chunks[i].lines);
+      free (chunks[i].buf);
+    }
+  free (chunks);
+  for (size_t i = 0; i < num_workers; ++i)
+    {
+      queue_free (&worker_input[i]);
+      queue_free (&worker_output[i]);
+    }
+  free (worker_input);
+  free (worker_output);
+  free (worker_threads);
+  queue_free (&free_chunks);
+  free (carry);
+  carry = NULL;
+  carry_len = carry_size = 0;
+  input_threads_stream = NULL;
+}
+
+#else
+
+bool
+input_threads_start (FILE *stream _GL_UNUSED, size_t workers _GL_UNUSED,
+                     input_threads_chunk_fn fn _GL_UNUSED)
+{
+  return false;
+}
+
+bool
+input_threads_read_line (struct line_record_t *lr _GL_UNUSED)
+{
+  return false;
+}
+
+bool
+input_threads_read_chunk (const struct line_record_t **lines _GL_UNUSED,
+                          size_t *num_lines _GL_UNUSED,
+                          void **result _GL_UNUSED)
+{
+  return false;
+}
+
+void
+input_threads_stop (void)
+{
+}
+
+#endif
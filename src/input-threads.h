@@ -0,0 +1,86 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __INPUT_THREADS_H__
+#define __INPUT_THREADS_H__
+
+/*
+ Reading and splitting input lines in background threads (--threads).
+
+ One thread reads the input in large chunks (or, for a memory-mapped
+ file, just cuts it into chunks) ending at line boundaries.  The chunks
+ are handed round-robin to the worker threads, which find the lines
+ and split them into fields (as line_record_fread would).  The main
+ thread takes the chunks back in the same order, and gets their lines
+ with input_threads_read_line, while the next chunks are being read
+ and split.
+
+ Optionally, the workers also process the lines of each chunk (e.g.
+ collect the groups of --threads with -s), and the main thread gets the
+ results along with the chunks.
+
+ The threads communicate through single-producer/single-consumer
+ queues of chunks; a thread only blocks (on a condition variable) when
+ its queue is empty or full.
+ */
+
+/* The stream read by the threads, or NULL */
+extern FILE *input_threads_stream;
+
+/* Called by a worker thread on the lines of a chunk, once they are split.
+   The returned value is passed to the main thread (see
+   input_threads_read_chunk). */
+typedef void *(*input_threads_chunk_fn) (const struct line_record_t *lines,
+                                         size_t num_lines);
+
+/* Start reading and splitting the lines of 'stream' with 'num_workers'
+   worker threads.  If 'process_chunk' is not NULL, the workers also call
+   it on the lines of each chunk.  The global options (delimiters,
+   --skip-comments, max_parsed_fields) must not change until
+   input_threads_stop.
+   Returns false if threads are not supported, or couldn't be started
+   (the stream is then read as usual). */
+bool
+input_threads_start (FILE *stream, size_t num_workers,
+                     input_threads_chunk_fn process_chunk);
+
+/* Get the next line (as line_record_fread).  Returns false at the end
+   of the input. */
+bool
+input_threads_read_line (struct line_record_t *lr);
+
+/* Get the lines of the next chunk (in input order), and the value
+   returned by 'process_chunk' for them (or NULL).  The lines remain valid
+   until the next call.  Returns false at the end of the input. */
+bool
+input_threads_read_chunk (const struct line_record_t **lines,
+                          size_t *num_lines, void **result);
+
+/* Wait for the threads to finish, and free their resources */
+void
+input_threads_stop (void);
+
+static inline bool
+input_threads_active (const FILE *stream)
+{
+  return stream == input_threads_stream;
+}
+
+#endif /* __INPUT_THREADS_H__ */
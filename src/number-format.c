@@ -0,0 +1,295 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <float.h>
+#include <locale.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "system.h"
+#include "c-ctype.h"
+
+#include "number-format.h"
+
+/*
+ The fast path: to print 'x' with P significant digits (%g) or P digits
+ after the decimal point (%f), the integer N nearest to 'x * 10^k' is
+ computed with one multiplication (by an exactly representable power of
+ ten), and N's digits are printed.
+
+ The multiplication is correctly rounded, so its error is less than
+ 'x * 10^k * LDBL_EPSILON'.  Unless the fraction is that close to 0.5,
+ N is the same as rounding the exact (binary) value, which is what
+ snprintf does.  Otherwise (a possible tie), snprintf is used.
+ */
+
+/* Largest precision handled directly: 10^17 fits in an uint64_t,
+   and 10^(17+4) (for %g of values down to 1e-4) is exact in a
+   long double of at least 53 bits */
+#define MAX_FAST_PRECISION 17
+#define MAX_POW10 (MAX_FAST_PRECISION + 5)
+
+static const long double pow10_ld[MAX_POW10 + 1] =
+{
+  1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+  1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+  1e20L, 1e21L, 1e22L
+};
+
+static const uint64_t pow10_u64[MAX_FAST_PRECISION + 2] =
+{
+  UINT64_C (1),
+  UINT64_C (10),
+  UINT64_C (100),
+  UINT64_C (1000),
+  UINT64_C (10000),
+  UINT64_C (100000),
+  UINT64_C (1000000),
+  UINT64_C (10000000),
+  UINT64_C (100000000),
+  UINT64_C (1000000000),
+  UINT64_C (10000000000),
+  UINT64_C (100000000000),
+  UINT64_C (1000000000000),
+  UINT64_C (10000000000000),
+  UINT64_C (100000000000000),
+  UINT64_C (1000000000000000),
+  UINT64_C (10000000000000000),
+  UINT64_C (100000000000000000),
+  UINT64_C (1000000000000000000)
+};
+
+enum format_kind
+{
+  FORMAT_PRINTF,   /* anything else: use snprintf */
+  FORMAT_G,        /* "%.PLg" */
+  FORMAT_F         /* "%.PLf" */
+};
+
+static const char *number_format = "%.14Lg";
+static enum format_kind format_kind = FORMAT_PRINTF;
+static int format_precision = 6;
+static char decimal_point = '.';
+
+void
+number_format_init (const char *format)
+{
+  const struct lconv *lc = localeconv ();
+  const char *dp = lc->decimal_point;
+  const char *p = format;
+  int precision = 6;
+
+  number_format = format;
+  format_kind = FORMAT_PRINTF;
+
+  if (!(dp && dp[0] && !dp[1]) || FLT_RADIX != 2 || LDBL_MANT_DIG < 53)
+    return;
+  decimal_point = dp[0];
+
+  /* Only "%Lg", "%Lf" with an optional precision (no flags or width,
+     nothing before or after) */
+  if (*p++ != '%')
+    return;
+  if (*p == '.')
+    {
+      precision = 0;
+      for (++p; c_isdigit (*p) && precision <= MAX_FAST_PRECISION; ++p)
+        precision = precision * 10 + (*p - '0');
+    }
+  if (precision > MAX_FAST_PRECISION || p[0] != 'L'
+      || (p[1] != 'g' && p[1] != 'f') || p[2] != '\0')
+    return;
+
+  if (p[1] == 'g')
+    {
+      format_kind = FORMAT_G;
+      /* (as in printf, a precision of zero is taken as 1) */
+      format_precision = precision ? precision : 1;
+    }
+  else
+    {
+      format_kind = FORMAT_F;
+      format_precision = precision;
+    }
+}
+
+/* Round 's' (a non-negative product with an error of at most half an ulp)
+   to the nearest integer.
+   Returns false if 's' is too large, or too close to a tie. */
+static inline bool
+round_scaled (long double s, uint64_t *n)
+{
+  if (!(s < 1e18L))
+    return false;
+
+  const uint64_t i = s;
+  const long double frac = s - i;
+  const long double margin = s * LDBL_EPSILON;
+
+  if (frac - 0.5L <= margin && 0.5L - frac <= margin)
+    return false;
+  *n = i + (frac > 0.5L);
+  return true;
+}
+
+/* Print 'n' as 'int_part.frac_part', with 'frac_digits' digits after
+   the decimal point.  Returns the end of the output (not NUL-terminated). */
+static char *
+print_fixed (char *p, bool negative, uint64_t n, int frac_digits)
+{
+  char digits[24];
+  char *d = digits + sizeof digits;
+  int num_digits = 0;
+
+  do
+    {
+      *--d = '0' + n % 10;
+      n /= 10;
+      ++num_digits;
+    }
+  while (n || num_digits <= frac_digits);
+
+  if (negative)
+    *p++ = '-';
+  const int int_digits = num_digits - frac_digits;
+  memcpy (p, d, int_digits);
+  p += int_digits;
+  if (frac_digits)
+    {
+      *p++ = decimal_point;
+      memcpy (p, d + int_digits, frac_digits);
+      p += frac_digits;
+    }
+  return p;
+}
+
+/* "%.PLg": returns the end of the output, or NULL to use snprintf */
+static char *
+format_g (char *p, long double val)
+{
+  const int prec = format_precision;
+  const bool negative = signbit (val);
+  const long double x = negative ? -val : val;
+  uint64_t n;
+  int exp10;
+
+  if (fpclassify (x) == FP_ZERO)
+    return print_fixed (p, negative, 0, 0);
+
+  /* Values printed in exponent notation, or too small to scale exactly */
+  if (!(x >= 1e-5L && x < pow10_ld[prec]))
+    return NULL;
+
+  /* Estimate the decimal exponent, then correct it by the number of
+     digits of the rounded result */
+  exp10 = 0;
+  if (x < 1)
+    while (exp10 > -5 && x < 1 / pow10_ld[-exp10])
+      --exp10;
+  else
+    while (exp10 < prec - 1 && x >= pow10_ld[exp10 + 1])
+      ++exp10;
+
+  for (int tries = 0; ; ++tries)
+    {
+      const int scale = prec - 1 - exp10;
+      if (tries > 2 || scale < 0 || scale > MAX_POW10
+          || !round_scaled (x * pow10_ld[scale], &n))
+        return NULL;
+
+      if (n >= pow10_u64[prec])
+        {
+          if (n == pow10_u64[prec])
+            {
+              /* e.g. 9.99999 rounded up to 10.0000 */
+              n = pow10_u64[prec - 1];
+              ++exp10;
+              break;
+            }
+          ++exp10;
+        }
+      else if (n < pow10_u64[prec - 1])
+        --exp10;
+      else
+        break;
+    }
+
+  /* %g uses exponent notation if the exponent is less than -4
+     or greater than or equal to the precision */
+  if (exp10 < -4 || exp10 >= prec)
+    return NULL;
+
+  /* Remove trailing zeros (%g without the '#' flag) */
+  int frac_digits = prec - 1 - exp10;
+  while (frac_digits > 0 && n % 10 == 0)
+    {
+      n /= 10;
+      --frac_digits;
+    }
+  return print_fixed (p, negative, n, frac_digits);
+}
+
+/* "%.PLf": returns the end of the output, or NULL to use snprintf */
+static char *
+format_f (char *p, long double val)
+{
+  const bool negative = signbit (val);
+  const long double x = negative ? -val : val;
+  uint64_t n;
+
+  if (!(x < 1e18L) || !round_scaled (x * pow10_ld[format_precision], &n))
+    return NULL;
+  return print_fixed (p, negative, n, format_precision);
+}
+
+int
+format_number (char *buf, size_t size, long double val)
+{
+  /* The longest direct output: sign, 18 digits, decimal point,
+     17 fraction digits (with leading zeros), NUL */
+  char tmp[48];
+  char *end = NULL;
+
+  if (format_kind == FORMAT_G)
+    end = format_g (tmp, val);
+  else if (format_kind == FORMAT_F)
+    end = format_f (tmp, val);
+
+  if (end == NULL)
+    return snprintf (buf, size, number_format, val);
+
+  const size_t len = end - tmp;
+  if (len < size)
+    {
+      memcpy (buf, tmp, len);
+      buf[len] = '\0';
+    }
+  else if (size > 0)
+    {
+      memcpy (buf, tmp, size - 1);
+      buf[size - 1] = '\0';
+    }
+  return len;
+}
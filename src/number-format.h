@@ -0,0 +1,44 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __NUMBER_FORMAT_H__
+#define __NUMBER_FORMAT_H__
+
+/*
+ Formatting numeric results.
+
+ The default output format ("%.14Lg") and the formats set by
+ --round ("%.NLf") are formatted directly, when the result is guaranteed
+ to be identical to snprintf's.  Anything else (other formats, values
+ printed in exponent notation, inf/nan, values too close to a rounding
+ tie) is passed to snprintf.
+ */
+
+/* Set the printf format used by format_number.
+   'format' must remain valid (e.g. 'numeric_output_format').
+   Must be called after setlocale. */
+void
+number_format_init (const char *format);
+
+/* Same as 'snprintf (buf, size, format, val)' */
+int
+format_number (char *buf, size_t size, long double val);
+
+#endif /* __NUMBER_FORMAT_H__ */
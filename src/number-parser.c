@@ -0,0 +1,295 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <float.h>
+#include <locale.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "system.h"
+#include "die.h"
+#include "intprops.h"
+
+#include "accum-type.h"
+#include "number-parser.h"
+
+/*
+ The fast path (Clinger's algorithm): if the decimal digits fit exactly
+ in the mantissa of accum_t, and the power of ten is exactly representable
+ too, then a single multiplication/division gives the correctly rounded
+ result - the same value strtold (or strtod) returns.
+ This requires IEEE binary formats, and the arithmetic to be done in
+ the precision of accum_t: for long double, the x87 FPU set to extended
+ precision (see BEGIN_LONG_DOUBLE_ROUNDING in main); for double, no
+ excess precision (FLT_EVAL_METHOD 0 or 1, i.e. not the x87 FPU).
+ */
+#if ACCUM_MANT_DIG == 64 || ACCUM_MANT_DIG == 113
+/* 5^27 < 2^64 */
+# define MAX_EXACT_POW10 27
+# define MAX_EXACT_MANTISSA UINT64_MAX
+#elif ACCUM_MANT_DIG == 53 \
+      && (!defined ACCUM_DOUBLE || FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1)
+/* 5^22 < 2^53 */
+# define MAX_EXACT_POW10 22
+# define MAX_EXACT_MANTISSA (UINT64_C (1) << 53)
+#else
+/* Non-IEEE long double (e.g. double-double), or double with excess
+   precision: always use strtold/strtod */
+# define MAX_EXACT_POW10 -1
+# define MAX_EXACT_MANTISSA 0
+#endif
+
+/* The number of decimal digits which always fit in an uint64_t */
+#define MAX_DIGITS 19
+
+static const accum_t pow10_accum[] =
+{
+  1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+  1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+  1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+};
+
+static const uint64_t pow10_u64[MAX_DIGITS + 1] =
+{
+  UINT64_C (1),
+  UINT64_C (10),
+  UINT64_C (100),
+  UINT64_C (1000),
+  UINT64_C (10000),
+  UINT64_C (100000),
+  UINT64_C (1000000),
+  UINT64_C (10000000),
+  UINT64_C (100000000),
+  UINT64_C (1000000000),
+  UINT64_C (10000000000),
+  UINT64_C (100000000000),
+  UINT64_C (1000000000000),
+  UINT64_C (10000000000000),
+  UINT64_C (100000000000000),
+  UINT64_C (1000000000000000),
+  UINT64_C (10000000000000000),
+  UINT64_C (100000000000000000),
+  UINT64_C (1000000000000000000),
+  UINT64_C (10000000000000000000)
+};
+
+/* The locale's decimal point, or 0 if it is not a single character
+   (then numbers with fractions are parsed by strtold) */
+static char decimal_point = '.';
+
+void
+number_parser_init (void)
+{
+  const struct lconv *lc = localeconv ();
+  const char *dp = lc->decimal_point;
+
+  decimal_point = (dp && dp[0] && !dp[1]) ? dp[0] : 0;
+}
+
+static inline bool
+is_digit (char c)
+{
+  return (unsigned char) (c - '0') < 10;
+}
+
+bool
+parse_integer (const char *str, size_t len, intmax_t *out)
+{
+  const char *p = str;
+  const char *end = str + len;
+  bool negative = false;
+  intmax_t value = 0;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = (*p++ == '-');
+
+  if (p == end)
+    return false;
+
+  /* The negated value is accumulated (down to INTMAX_MIN).
+     Up to MAX_DIGITS-1 digits always fit, without overflow checks */
+  const size_t ndigits = end - p;
+  const char *fast_end = p + MIN (ndigits, MAX_DIGITS - 1);
+  for (; p < fast_end; ++p)
+    {
+      if (!is_digit (*p))
+        return false;
+      value = value * 10 - (*p - '0');
+    }
+  for (; p < end; ++p)
+    if (!is_digit (*p)
+        || INT_MULTIPLY_WRAPV (value, 10, &value)
+        || INT_SUBTRACT_WRAPV (value, *p - '0', &value))
+      return false;
+
+  if (!negative)
+    {
+      if (value == INTMAX_MIN)
+        return false;
+      value = -value;
+    }
+  *out = value;
+  return true;
+}
+
+/* Parse the number using strtold (or strtod) */
+static bool
+parse_number_strtold (const char *str, size_t len, accum_t *out)
+{
+  char *endptr = NULL;
+  char tmpbuf[512];
+
+#ifndef HAVE_BROKEN_STRTOLD
+  /* Usually, strtold stops at the field delimiter, but not always.
+     Optimistically try to avoid an extra copy, unless the strtold
+     implementation is known to be problematic. */
+  errno = 0;
+  *out = accum_strto (str, &endptr);
+  if (errno==ERANGE || endptr==str || endptr<(str+len))
+    return false;
+  /* On Cygwin, strtold doesn't stop at a tab character,
+     and returns invalid value.
+     Generally, strtold doesn't stop on field separators
+     that can be part of long double representations.
+     If strtold continued past the field delimiter, make
+     a copy of the input buffer and NUL-terminate it. */
+  if (endptr > (str+len))
+    {
+#endif
+      if (len >= sizeof (tmpbuf))
+        die (EXIT_FAILURE, 0,
+                "internal error: input field too long (%zu)", len);
+      memcpy (tmpbuf,str,len);
+      tmpbuf[len]=0;
+      errno = 0;
+      *out = accum_strto (tmpbuf, &endptr);
+      if (errno==ERANGE || endptr==tmpbuf || endptr!=(tmpbuf+len))
+        return false;
+#ifndef HAVE_BROKEN_STRTOLD
+    }
+#endif
+  return true;
+}
+
+bool
+parse_number (const char *str, size_t len, accum_t *out)
+{
+  const char *p = str;
+  const char *end = str + len;
+  bool negative = false;
+  bool any_digits = false;
+  uint64_t mantissa = 0;
+  int num_digits = 0;  /* significant digits in 'mantissa' */
+  int exp10 = 0;
+  accum_t value;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = (*p++ == '-');
+
+  for (; p < end && is_digit (*p); ++p)
+    {
+      any_digits = true;
+      if (mantissa == 0 && *p == '0')
+        continue;
+      if (++num_digits > MAX_DIGITS)
+        goto slow;
+      mantissa = mantissa * 10 + (*p - '0');
+    }
+
+  if (p < end && *p == decimal_point)
+    {
+      for (++p; p < end && is_digit (*p); ++p)
+        {
+          any_digits = true;
+          --exp10;
+          if (mantissa == 0 && *p == '0')
+            continue;
+          if (++num_digits > MAX_DIGITS)
+            goto slow;
+          mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+
+  if (!any_digits)
+    goto slow;
+
+  if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      bool exp_negative = false;
+      int e = 0;
+
+      ++p;
+      if (p < end && (*p == '-' || *p == '+'))
+        exp_negative = (*p++ == '-');
+      if (p == end || !is_digit (*p))
+        goto slow;
+      for (; p < end && is_digit (*p); ++p)
+        {
+          if (e > 100000)
+            goto slow;
+          e = e * 10 + (*p - '0');
+        }
+      exp10 += exp_negative ? -e : e;
+    }
+
+  if (p != end)
+    goto slow;
+
+  if (mantissa == 0 || exp10 == 0)
+    {
+      /* (the integer conversion is correctly rounded) */
+      value = mantissa;
+    }
+  else
+    {
+      if (mantissa > MAX_EXACT_MANTISSA)
+        goto slow;
+
+      /* e.g. "12e30" = 12000 * 1e27: move the excess power of ten
+         to the mantissa, if it still fits exactly */
+      if (exp10 > MAX_EXACT_POW10)
+        {
+          const int shift = exp10 - MAX_EXACT_POW10;
+          if (shift > MAX_DIGITS
+              || mantissa > MAX_EXACT_MANTISSA / pow10_u64[shift])
+            goto slow;
+          mantissa *= pow10_u64[shift];
+          exp10 = MAX_EXACT_POW10;
+        }
+
+      if (exp10 > 0)
+        value = (accum_t) mantissa * pow10_accum[exp10];
+      else if (exp10 >= -MAX_EXACT_POW10)
+        value = (accum_t) mantissa / pow10_accum[-exp10];
+      else
+        goto slow;
+    }
+
+  *out = negative ? -value : value;
+  return true;
+
+slow:
+  return parse_number_strtold (str, len, out);
+}
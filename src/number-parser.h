@@ -0,0 +1,54 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __NUMBER_PARSER_H__
+#define __NUMBER_PARSER_H__
+
+/*
+ Parsing numeric input fields.
+
+ Plain decimal numbers (the vast majority of input) are converted directly,
+ when the result is guaranteed to be identical to strtold's
+ (or strtod's, if accum_t is double).
+ Anything else (hex, inf/nan, leading spaces, many digits, large exponents)
+ is passed to strtold/strtod.
+ */
+
+/* Read the decimal-point character of the current locale.
+   Must be called after setlocale, before parse_number. */
+void
+number_parser_init (void);
+
+/* Parse the number in 'str' (of length 'len', not necessarily
+   NUL-terminated).
+   Returns true and stores the value in 'out' if the entire string
+   is a valid number (as accepted by strtold, without overflow). */
+bool
+parse_number (const char *str, size_t len, accum_t *out);
+
+/* Parse the integer in 'str' (of length 'len', not necessarily
+   NUL-terminated): an optional sign followed by decimal digits, within
+   the range of intmax_t ("-0" is 0).
+   Returns false if 'str' is anything else (or out of range), without
+   parsing it as a floating-point number. */
+bool
+parse_integer (const char *str, size_t len, intmax_t *out);
+
+#endif /* __NUMBER_PARSER_H__ */
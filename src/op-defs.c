@@ -74,6 +74,10 @@ struct field_operation_definition field_operations[] =
   {"uniq",        OP_UNIQUE,            MODE_GROUPBY},
   {"collapse",    OP_COLLAPSE,          MODE_GROUPBY},
   {"countunique", OP_COUNT_UNIQUE,      MODE_GROUPBY},
+  {"approxcountunique", OP_APPROX_COUNT_UNIQUE, MODE_GROUPBY},
+  {"topk",        OP_TOPK,              MODE_GROUPBY},
+  {"approxtopk",  OP_APPROX_TOPK,       MODE_GROUPBY},
+  {"sample",      OP_SAMPLE,            MODE_GROUPBY},
   {"base64",      OP_BASE64,            MODE_PER_LINE},
   {"debase64",    OP_DEBASE64,          MODE_PER_LINE},
   {"md5",         OP_MD5,               MODE_PER_LINE},
@@ -99,6 +103,8 @@ struct field_operation_definition field_operations[] =
   {"trunc",       OP_TRUNCATE,          MODE_PER_LINE},
   {"frac",        OP_FRACTION,          MODE_PER_LINE},
   {"trimmean",    OP_TRIMMED_MEAN,      MODE_GROUPBY},
+  {"approxmedian", OP_APPROX_MEDIAN,    MODE_GROUPBY},
+  {"approxperc",  OP_APPROX_PERCENTILE, MODE_GROUPBY},
   {"getnum",      OP_GETNUM,            MODE_PER_LINE},
   {"cut",         OP_CUT,               MODE_PER_LINE},
   {"echo",        OP_CUT,               MODE_PER_LINE},
@@ -90,7 +90,13 @@ enum field_operation
   OP_EXTNAME,       /* guess extension of file name */
   OP_BARENAME,      /* like basename without the guessed extension  */
   OP_GETNUM,        /* Extract a number from a string */
-  OP_CUT            /* like cut (1) */
+  OP_CUT,           /* like cut (1) */
+  OP_APPROX_MEDIAN, /* Median, estimated with a t-digest */
+  OP_APPROX_PERCENTILE, /* Percentile, estimated with a t-digest */
+  OP_APPROX_COUNT_UNIQUE, /* Unique values, estimated with a HyperLogLog */
+  OP_TOPK,          /* Most common values, with their counts */
+  OP_APPROX_TOPK,   /* Most common values, estimated with Misra-Gries */
+  OP_SAMPLE         /* Random sample of values (reservoir sampling) */
 };
 
 enum processing_mode
@@ -30,7 +30,11 @@
 #include "op-scanner.h"
 #include "op-defs.h"
 #include "op-parser.h"
+#include "accum-type.h"
 #include "utils.h"
+#include "tdigest.h"
+#include "hyperloglog.h"
+#include "value-counts.h"
 #include "field-ops.h"
 #include "text-options.h"
 
@@ -154,6 +158,7 @@ add_op (enum field_operation op, const struct parser_field_t *f)
   p->field_name = f->name;
   #else
   field_op_init (p, op, f->by_name, f->num, f->name);
+  field_op_bind_collect (p);
   #endif
   return p;
 }
@@ -201,6 +206,94 @@ set_op_params (struct fieldop *op)
       return;
     }
 
+  if (op->op==OP_APPROX_MEDIAN || op->op==OP_APPROX_PERCENTILE)
+    {
+      /* approxmedian[:compression], approxperc[:percentile[:compression]] */
+      size_t i = 0;
+      op->params.approx.percentile = 50;
+      if (op->op==OP_APPROX_PERCENTILE)
+        {
+          op->params.approx.percentile = 95; /* default percentile */
+          if (_params_used>i)
+            op->params.approx.percentile = _params[i++].u;
+          if (op->params.approx.percentile==0
+              || op->params.approx.percentile>100)
+            die (EXIT_FAILURE, 0, _("invalid percentile value %" PRIuMAX),
+                 (uintmax_t)op->params.approx.percentile);
+        }
+      op->params.approx.compression = 100; /* default compression */
+      if (_params_used>i)
+        op->params.approx.compression = _params[i++].u;
+      if (op->params.approx.compression<10
+          || op->params.approx.compression>100000)
+        die (EXIT_FAILURE, 0, _("invalid compression value %" PRIuMAX " " \
+             "(expected 10 <= X <= 100000)"),
+             (uintmax_t)op->params.approx.compression);
+      if (_params_used>i)
+        die (EXIT_FAILURE, 0, _("too many parameters for operation %s"),
+                                    quote (get_field_operation_name (op->op)));
+      return;
+    }
+
+  if (op->op==OP_APPROX_COUNT_UNIQUE)
+    {
+      op->params.hll_precision = 14; /* default precision (16KiB) */
+      if (_params_used==1)
+        op->params.hll_precision = MIN (_params[0].u, UINT_MAX);
+      if (op->params.hll_precision<4
+          || op->params.hll_precision>HLL_MAX_PRECISION)
+        die (EXIT_FAILURE, 0, _("invalid precision value %u " \
+             "(expected 4 <= X <= %d)"),
+             op->params.hll_precision, HLL_MAX_PRECISION);
+      if (_params_used>1)
+        die (EXIT_FAILURE, 0, _("too many parameters for operation %s"),
+                                    quote (get_field_operation_name (op->op)));
+      return;
+    }
+
+  if (op->op==OP_TOPK || op->op==OP_APPROX_TOPK)
+    {
+      /* topk[:k], approxtopk[:k[:capacity]] */
+      size_t i = 0;
+      op->params.topk.k = 10; /* default number of values */
+      if (_params_used>i)
+        op->params.topk.k = _params[i++].u;
+      if (op->params.topk.k==0)
+        die (EXIT_FAILURE, 0, _("invalid number of values %" PRIuMAX),
+             (uintmax_t)op->params.topk.k);
+      if (op->op==OP_APPROX_TOPK)
+        {
+          /* default capacity: errors below 2% of the number of values */
+          op->params.topk.capacity = MAX (100, 10 * op->params.topk.k);
+          if (_params_used>i)
+            op->params.topk.capacity = _params[i++].u;
+          if (op->params.topk.capacity<op->params.topk.k
+              || op->params.topk.capacity>1000000)
+            die (EXIT_FAILURE, 0, _("invalid capacity value %" PRIuMAX " " \
+                 "(expected %" PRIuMAX " <= X <= 1000000)"),
+                 (uintmax_t)op->params.topk.capacity,
+                 (uintmax_t)op->params.topk.k);
+        }
+      if (_params_used>i)
+        die (EXIT_FAILURE, 0, _("too many parameters for operation %s"),
+                                    quote (get_field_operation_name (op->op)));
+      return;
+    }
+
+  if (op->op==OP_SAMPLE)
+    {
+      op->params.sample_size = 10; /* default number of values */
+      if (_params_used==1)
+        op->params.sample_size = _params[0].u;
+      if (op->params.sample_size==0)
+        die (EXIT_FAILURE, 0, _("invalid sample size %" PRIuMAX),
+             (uintmax_t)op->params.sample_size);
+      if (_params_used>1)
+        die (EXIT_FAILURE, 0, _("too many parameters for operation %s"),
+                                    quote (get_field_operation_name (op->op)));
+      return;
+    }
+
   if (op->op==OP_TRIMMED_MEAN)
     {
       op->params.trimmed_mean = 0; /* default trimmed mean = no trim */
@@ -252,6 +345,17 @@ set_op_params (struct fieldop *op)
       return;
     }
 
+  if (op->op==OP_SUM || op->op==OP_MIN || op->op==OP_MAX)
+    {
+      /* ':int' is the only possible parameter (see above) */
+      op->params.integer = (_params_used==1);
+      if (_params_used>1
+          || (_params_used==1 && _params[0].type != PARAM_CHAR))
+        die (EXIT_FAILURE, 0, _("too many parameters for operation %s"),
+                                    quote (get_field_operation_name (op->op)));
+      return;
+    }
+
   /* All other operations do not take parameters */
   if (_params_used>0)
     die (EXIT_FAILURE, 0, _("too many parameters for operation %s"),
@@ -411,13 +515,21 @@ parse_operation_params (enum field_operation op)
                                   quote (get_field_operation_name (fop)));
 
         case TOK_IDENTIFIER:
-          /* Currently, only OP_GETNUM accepts non-numeric parameter */
+          /* Currently, only OP_GETNUM and OP_SUM/MIN/MAX (:int)
+             accept non-numeric parameters */
           if (op == OP_GETNUM)
             {
               p->type = PARAM_CHAR;
               p->c    = scanner_identifier[0];
               break;
             }
+          if ((op == OP_SUM || op == OP_MIN || op == OP_MAX)
+              && STREQ (scanner_identifier, "int"))
+            {
+              p->type = PARAM_CHAR;
+              p->c    = 'i';
+              break;
+            }
           /* Otherwise, fall through */
           /* FALLTHROUGH */
 
@@ -478,6 +590,10 @@ create_field_ops ()
       if (f->pair)
         {
           op->slave = true;
+          #ifndef _STANDALONE_
+          /* A slave op only keeps the value of each line for its master */
+          field_op_bind_collect (op);
+          #endif
 
           const struct parser_field_t *other_f = &_fields[++i];
           op = add_op (fop, other_f);
@@ -0,0 +1,139 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+
+#include <error.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "system.h"
+#include "ignore-value.h"
+#include "progname.h"
+
+#include "text-options.h"
+#include "output-buffer.h"
+
+/* Large enough to amortize the write calls, small enough to stay in
+   the cache */
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+static char output_buf[OUTPUT_BUFFER_SIZE];
+
+char *output_pos = output_buf;
+char *output_end = output_buf + OUTPUT_BUFFER_SIZE;
+bool output_line_buffered = false;
+
+/* Force generation of these inline'd symbols, needed to avoid
+   "undefined reference" when compiling with coverage instrumentation.
+   See: http://stackoverflow.com/a/16245669 */
+void output_char (char c);
+void print_field_separator ();
+void print_line_separator ();
+
+/* Called by 'error' (and 'die') before the message: the output written
+   so far must appear before it, as it would with stdio alone
+   ('error' only flushes stdout) */
+static void
+output_print_progname (void)
+{
+  output_flush ();
+  fflush (stdout);
+  fprintf (stderr, "%s: ", program_name);
+}
+
+void
+output_init (void)
+{
+  output_line_buffered = isatty (STDOUT_FILENO);
+  error_print_progname = output_print_progname;
+  atexit (output_flush);
+}
+
+void
+output_flush (void)
+{
+  const size_t len = output_pos - output_buf;
+  if (len == 0)
+    return;
+
+  /* Write errors are detected (and reported) by close_stdout */
+  ignore_value (fwrite (output_buf, 1, len, stdout));
+  output_pos = output_buf;
+}
+
+void
+output_write (const char *buf, size_t len)
+{
+  if (len > (size_t)(output_end - output_pos))
+    {
+      output_flush ();
+      /* Too large to buffer: write it directly */
+      if (len >= OUTPUT_BUFFER_SIZE)
+        {
+          ignore_value (fwrite (buf, 1, len, stdout));
+          return;
+        }
+    }
+  memcpy (output_pos, buf, len);
+  output_pos += len;
+}
+
+void
+output_str (const char *s)
+{
+  output_write (s, strlen (s));
+}
+
+void
+output_printf (char const *format, ...)
+{
+  va_list args;
+
+  va_start (args, format);
+  int n = vsnprintf (output_pos, output_end - output_pos, format, args);
+  va_end (args);
+  if (n < 0)
+    return;
+
+  if (n >= output_end - output_pos)
+    {
+      /* It did not fit: retry in an empty buffer, or write it directly */
+      output_flush ();
+      va_start (args, format);
+      if (n < OUTPUT_BUFFER_SIZE)
+        {
+          n = vsnprintf (output_pos, OUTPUT_BUFFER_SIZE, format, args);
+          if (n < 0)
+            n = 0;
+        }
+      else
+        {
+          vfprintf (stdout, format, args);
+          n = 0;
+        }
+      va_end (args);
+    }
+  output_pos += n;
+}
@@ -0,0 +1,85 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __OUTPUT_BUFFER_H__
+#define __OUTPUT_BUFFER_H__
+
+/*
+ Buffered output to STDOUT.
+
+ Output is accumulated in a large buffer, and written to stdout in
+ large blocks (instead of one stdio call per field and separator).
+ If stdout is a terminal, the buffer is flushed at the end of every line.
+
+ Anything written directly to stdout must be preceded by 'output_flush'.
+ */
+
+/* Set up the buffer, and register 'output_flush' to run at exit
+   and before every 'error' message.
+   Must be called after 'atexit (close_stdout)', so that the buffer
+   is flushed before stdout is closed. */
+void
+output_init (void);
+
+/* Write the buffered output to stdout */
+void
+output_flush (void);
+
+/* Write 'len' bytes of 'buf' */
+void
+output_write (const char *buf, size_t len);
+
+/* Write the NUL-terminated string 's' */
+void
+output_str (const char *s);
+
+/* Write the formatted string */
+void
+output_printf (char const *format, ...)
+  _GL_ATTRIBUTE_FORMAT ((__printf__, 1, 2));
+
+/* The free space of the buffer (for the inline functions below) */
+extern char *output_pos;
+extern char *output_end;
+extern bool output_line_buffered;
+
+static inline void
+output_char (char c)
+{
+  if (output_pos == output_end)
+    output_flush ();
+  *output_pos++ = c;
+}
+
+static inline void
+print_field_separator ()
+{
+  output_char (out_tab);
+}
+
+static inline void
+print_line_separator ()
+{
+  output_char (eolchar);
+  if (output_line_buffered)
+    output_flush ();
+}
+
+#endif /* __OUTPUT_BUFFER_H__ */
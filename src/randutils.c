@@ -21,6 +21,7 @@
 
 #include <config.h>
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,6 +31,63 @@
 
 #include "randutils.h"
 
+/* State of the xoshiro256** generator (D. Blackman and S. Vigna,
+   "Scrambled linear pseudorandom number generators", 2018) */
+static uint64_t rng_state[4];
+
+/* The splitmix64 generator, to expand the seed into the state */
+static uint64_t
+splitmix64 (uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline uint64_t
+rotl (uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+uint64_t
+random_u64 (void)
+{
+  uint64_t *s = rng_state;
+  const uint64_t result = rotl (s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl (s[3], 45);
+
+  return result;
+}
+
+uint64_t
+random_range (uint64_t n)
+{
+  /* Reject the lowest (2^64 mod n) values, so that all the remainders
+     are equally likely */
+  const uint64_t threshold = -n % n;
+  uint64_t x;
+  do
+    x = random_u64 ();
+  while (x < threshold);
+  return x % n;
+}
+
+double
+random_unit (void)
+{
+  /* The 53 high bits, centered in their interval: never 0 nor 1 */
+  return ((random_u64 () >> 11) + 0.5) * 0x1.0p-53;
+}
+
 void
 init_random (bool force_seed, unsigned long seed)
 {
@@ -42,5 +100,7 @@ init_random (bool force_seed, unsigned long seed)
           fprintf (stderr, "Error %d: %s\n", errno, strerror (errno));
         }
     }
-  srandom (seed);
+  uint64_t x = seed;
+  for (int i = 0; i < 4; ++i)
+    rng_state[i] = splitmix64 (&x);
 }
@@ -23,9 +23,23 @@
 #define __RANDUTILS_H__
 
 # include <stdbool.h>
+# include <stdint.h>
 
 /* Initialize random number source */
 void
 init_random (bool force_seed, unsigned long seed);
 
+/* Returns a uniformly distributed random 64-bit number */
+uint64_t
+random_u64 (void);
+
+/* Returns a uniformly distributed random number in [0,n), with n > 0 */
+uint64_t
+random_range (uint64_t n);
+
+/* Returns a uniformly distributed random number in the open
+   interval (0,1) */
+double
+random_unit (void);
+
 #endif // __RANDUTILS_H__
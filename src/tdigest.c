@@ -0,0 +1,374 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "system.h"
+#include "xalloc.h"
+
+#include "accum-type.h"
+#include "utils.h"
+#include "tdigest.h"
+
+struct centroid
+{
+  accum_t mean;
+  size_t  weight;
+};
+
+/* The scale function k1 of the t-digest paper:
+   the centroids span at most one unit of k each.  */
+static double
+tdigest_k (double q, size_t compression)
+{
+  return compression / (2 * M_PI) * asin (2 * q - 1);
+}
+
+static double
+tdigest_k_inverse (double k, size_t compression)
+{
+  if (k >= compression / 4.0)
+    return 1;
+  return (sin (k * 2 * M_PI / compression) + 1) / 2;
+}
+
+/* The number of finite values (in the centroids and the buffer) */
+static size_t
+tdigest_finite_count (const struct tdigest *td)
+{
+  return td->count - td->neg_inf - td->pos_inf;
+}
+
+static void
+tdigest_update_range (struct tdigest *td, accum_t x)
+{
+  const bool empty = tdigest_finite_count (td) == 0;
+  if (empty || x < td->min)
+    td->min = x;
+  if (empty || x > td->max)
+    td->max = x;
+}
+
+/* Count 'weight' infinite values 'x' */
+static void
+tdigest_add_infinite (struct tdigest *td, accum_t x, size_t weight)
+{
+  if (x < 0)
+    td->neg_inf += weight;
+  else
+    td->pos_inf += weight;
+  td->count += weight;
+}
+
+/* Merges the buffered values, and the 'num_extra' centroids
+   'extra_means','extra_weights' (if any, in ascending order of their
+   means), into the centroids of 'td'.  */
+static void
+tdigest_compress (struct tdigest *td, const accum_t *extra_means,
+                  const size_t *extra_weights, size_t num_extra,
+                  size_t compression)
+{
+  if (td->num_buffered == 0 && num_extra == 0)
+    return;
+
+  qsortfl (td->buffer, td->num_buffered);
+
+  /* Merge the three sorted lists */
+  const size_t nc = td->num_centroids;
+  const size_t nb = td->num_buffered;
+  const size_t n = nc + nb + num_extra;
+  struct centroid *items = xnmalloc (n, sizeof (struct centroid));
+  size_t ic = 0, ib = 0, ie = 0;
+  size_t total = 0;
+  for (struct centroid *it = items; it < items + n; ++it)
+    {
+      if (ic < nc && (ib == nb || td->means[ic] <= td->buffer[ib])
+          && (ie == num_extra || td->means[ic] <= extra_means[ie]))
+        {
+          it->mean = td->means[ic];
+          it->weight = td->weights[ic++];
+        }
+      else if (ib < nb && (ie == num_extra || td->buffer[ib] <= extra_means[ie]))
+        {
+          it->mean = td->buffer[ib++];
+          it->weight = 1;
+        }
+      else
+        {
+          it->mean = extra_means[ie];
+          it->weight = extra_weights[ie++];
+        }
+      total += it->weight;
+    }
+
+  /* One pass over the sorted items: add each item to the current
+     centroid while the centroid spans less than one unit of k */
+  struct centroid *out = items;
+  size_t weight_before = 0;
+  double limit = total * tdigest_k_inverse (tdigest_k (0, compression) + 1,
+                                            compression);
+  for (size_t i = 1; i < n; ++i)
+    {
+      const size_t proposed = out->weight + items[i].weight;
+      if (weight_before + proposed <= limit)
+        {
+          out->mean += (items[i].mean - out->mean) * items[i].weight
+                       / proposed;
+          out->weight = proposed;
+        }
+      else
+        {
+          weight_before += out->weight;
+          limit = total * tdigest_k_inverse
+            (tdigest_k ((double) weight_before / total, compression) + 1,
+             compression);
+          *++out = items[i];
+        }
+    }
+
+  const size_t num_centroids = out - items + 1;
+  if (num_centroids > td->alloc_centroids)
+    {
+      td->alloc_centroids = num_centroids;
+      td->means = xnrealloc (td->means, num_centroids, sizeof (accum_t));
+      td->weights = xnrealloc (td->weights, num_centroids, sizeof (size_t));
+    }
+  for (size_t i = 0; i < num_centroids; ++i)
+    {
+      td->means[i] = items[i].mean;
+      td->weights[i] = items[i].weight;
+    }
+  td->num_centroids = num_centroids;
+  td->num_buffered = 0;
+  free (items);
+}
+
+void
+tdigest_add (struct tdigest *td, accum_t x, size_t compression)
+{
+  if (isinf (x))
+    {
+      tdigest_add_infinite (td, x, 1);
+      return;
+    }
+
+  if (td->num_buffered == 2 * compression)
+    tdigest_compress (td, NULL, NULL, 0, compression);
+
+  if (td->num_buffered == td->alloc_buffer)
+    {
+      td->alloc_buffer = MIN (2 * compression,
+                              MAX (16, td->alloc_buffer * 2));
+      td->buffer = xnrealloc (td->buffer, td->alloc_buffer, sizeof (accum_t));
+    }
+
+  tdigest_update_range (td, x);
+  td->buffer[td->num_buffered++] = x;
+  td->count++;
+}
+
+void
+tdigest_add_centroid (struct tdigest *td, accum_t mean, size_t weight)
+{
+  assert (weight > 0); /* LCOV_EXCL_LINE */
+
+  if (isinf (mean))
+    {
+      tdigest_add_infinite (td, mean, weight);
+      return;
+    }
+
+  assert (td->num_centroids == 0
+          || mean >= td->means[td->num_centroids-1]); /* LCOV_EXCL_LINE */
+
+  if (td->num_centroids == td->alloc_centroids)
+    {
+      td->alloc_centroids = MAX (16, td->alloc_centroids * 2);
+      td->means = xnrealloc (td->means, td->alloc_centroids,
+                             sizeof (accum_t));
+      td->weights = xnrealloc (td->weights, td->alloc_centroids,
+                               sizeof (size_t));
+    }
+
+  tdigest_update_range (td, mean);
+  td->means[td->num_centroids] = mean;
+  td->weights[td->num_centroids] = weight;
+  td->num_centroids++;
+  td->count += weight;
+}
+
+void
+tdigest_merge (struct tdigest *td, const struct tdigest *src,
+               size_t compression)
+{
+  td->neg_inf += src->neg_inf;
+  td->pos_inf += src->pos_inf;
+  td->count += src->neg_inf + src->pos_inf;
+
+  if (tdigest_finite_count (src) == 0)
+    return;
+
+  /* Into a digest without finite values: copy 'src' as-is */
+  if (tdigest_finite_count (td) == 0)
+    {
+      for (size_t i = 0; i < src->num_centroids; ++i)
+        tdigest_add_centroid (td, src->means[i], src->weights[i]);
+      for (size_t i = 0; i < src->num_buffered; ++i)
+        tdigest_add (td, src->buffer[i], compression);
+      td->min = src->min;
+      td->max = src->max;
+      return;
+    }
+
+  for (size_t i = 0; i < src->num_buffered; ++i)
+    tdigest_add (td, src->buffer[i], compression);
+
+  if (src->num_centroids == 0)
+    return;
+
+  size_t weight = 0;
+  for (size_t i = 0; i < src->num_centroids; ++i)
+    weight += src->weights[i];
+
+  tdigest_update_range (td, src->min);
+  tdigest_update_range (td, src->max);
+  td->count += weight;
+  tdigest_compress (td, src->means, src->weights, src->num_centroids,
+                    compression);
+}
+
+/* Returns the quantile 'q' of the finite values of 'td' */
+static long double
+tdigest_finite_quantile (struct tdigest *td, double q, size_t compression)
+{
+  /* All the values are still buffered: exact quantile */
+  if (td->num_centroids == 0)
+    {
+      qsortfl (td->buffer, td->num_buffered);
+      return percentile_value (td->buffer, td->num_buffered, q);
+    }
+
+  tdigest_compress (td, NULL, NULL, 0, compression);
+
+  /* The values of a centroid are assumed to be spread evenly around
+     its mean: the mean is at rank 'before + (weight-1)/2' (as a value
+     is at its own rank).  Interpolate between these ranks, and the
+     ranks of the minimum (0) and maximum (count-1) values.
+     The ranks of the centers are kept doubled, as integers.  */
+  const size_t count = tdigest_finite_count (td);
+  const double rank2 = 2 * q * (count - 1);
+  size_t prev_rank2 = 0;
+  long double prev_value = td->min;
+  size_t before = 0;
+  for (size_t i = 0; i < td->num_centroids; ++i)
+    {
+      const size_t center2 = 2 * before + td->weights[i] - 1;
+      if (rank2 <= center2)
+        {
+          if (center2 == prev_rank2)
+            return td->means[i];
+          return prev_value + (rank2 - prev_rank2) / (center2 - prev_rank2)
+                              * (td->means[i] - prev_value);
+        }
+      prev_rank2 = center2;
+      prev_value = td->means[i];
+      before += td->weights[i];
+    }
+
+  const size_t last_rank2 = 2 * (count - 1);
+  if (last_rank2 == prev_rank2)
+    return prev_value;
+  return prev_value + (rank2 - prev_rank2) / (last_rank2 - prev_rank2)
+                      * (td->max - prev_value);
+}
+
+/* Returns the value of rank 'rank' of all the values of 'td':
+   the infinite values come first (-inf) and last (+inf) */
+static long double
+tdigest_rank_value (struct tdigest *td, size_t rank, size_t compression)
+{
+  const size_t count = tdigest_finite_count (td);
+  if (rank < td->neg_inf)
+    return -INFINITY;
+  if (rank >= td->neg_inf + count)
+    return INFINITY;
+  return tdigest_finite_quantile (td, count > 1
+                                      ? (double) (rank - td->neg_inf)
+                                        / (count - 1)
+                                      : 0, compression);
+}
+
+long double
+tdigest_quantile (struct tdigest *td, double q, size_t compression)
+{
+  assert (td->count > 0 && q >= 0 && q <= 1); /* LCOV_EXCL_LINE */
+
+  if (td->neg_inf == 0 && td->pos_inf == 0)
+    return tdigest_finite_quantile (td, q, compression);
+
+  /* With infinite values, interpolate between the values of the two
+     ranks around 'q' (as 'percentile_value'), and only over the finite
+     values (with the digest) if both ranks are finite */
+  const size_t count = tdigest_finite_count (td);
+  const double h = q * (td->count - 1);
+  const size_t fh = floor (h);
+  if (fh >= td->neg_inf && fh + 1 < td->neg_inf + count)
+    return tdigest_finite_quantile (td, (h - td->neg_inf) / (count - 1),
+                                    compression);
+
+  const long double lo = tdigest_rank_value (td, fh, compression);
+  if (h <= fh || fh + 1 >= td->count)
+    return lo;
+  /* One of 'lo' and 'hi' is infinite: so is the interpolated value
+     (or NaN, between -inf and +inf) */
+  const long double hi = tdigest_rank_value (td, fh + 1, compression);
+  return lo + hi;
+}
+
+void
+tdigest_reset (struct tdigest *td)
+{
+  td->num_centroids = 0;
+  td->num_buffered = 0;
+  td->count = 0;
+  td->neg_inf = td->pos_inf = 0;
+  td->min = td->max = 0;
+}
+
+size_t _GL_ATTRIBUTE_PURE
+tdigest_memory (const struct tdigest *td)
+{
+  return td->alloc_centroids * (sizeof (accum_t) + sizeof (size_t))
+         + td->alloc_buffer * sizeof (accum_t);
+}
+
+void
+tdigest_free (struct tdigest *td)
+{
+  free (td->means);
+  free (td->weights);
+  free (td->buffer);
+  memset (td, 0, sizeof (*td));
+}
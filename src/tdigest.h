@@ -0,0 +1,100 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __TDIGEST_H__
+#define __TDIGEST_H__
+
+/*
+ Approximate quantiles with a t-digest (Dunning & Ertl, "Computing
+ Extremely Accurate Quantiles Using t-Digests", 2019), in its 'merging'
+ variant.
+
+ The values are summarized by centroids (a mean and a number of values),
+ small near the extremes and larger in the middle: the quantiles are
+ most accurate near 0 and 1 (e.g. the 99th percentile).  The
+ 'compression' parameter bounds the number of centroids (about
+ 'compression'): a larger compression is more accurate, and uses more
+ memory.
+
+ New values are buffered, and merged into the centroids once the buffer
+ holds 2*compression values.  Until then the values are kept as-is, and
+ the quantiles are exact: a digest only approximates groups of more
+ than 2*compression values.
+
+ Infinite values are only counted: they are the first (-inf) and last
+ (+inf) values of the quantiles, but are not merged into the centroids.
+
+ Digests (with the same compression) can be merged.
+ */
+
+struct tdigest
+{
+  /* The centroids, in ascending order of their means */
+  accum_t *means;
+  size_t  *weights;        /* number of values of each centroid */
+  size_t  num_centroids;
+  size_t  alloc_centroids;
+
+  /* The values added since the centroids were last merged */
+  accum_t *buffer;
+  size_t  num_buffered;
+  size_t  alloc_buffer;
+
+  size_t  count;           /* number of values (including infinite) */
+  size_t  neg_inf;         /* number of -inf values */
+  size_t  pos_inf;         /* number of +inf values */
+  accum_t min;             /* of the finite values */
+  accum_t max;
+};
+
+/* Add the value 'x' to the digest 'td' */
+void
+tdigest_add (struct tdigest *td, accum_t x, size_t compression);
+
+/* Add a centroid of 'weight' values with the mean 'mean', which must not
+   be smaller than the mean of the last centroid of 'td', unless infinite
+   (used to restore a digest from its centroids) */
+void
+tdigest_add_centroid (struct tdigest *td, accum_t mean, size_t weight);
+
+/* Add the values summarized by the digest 'src' to 'td' */
+void
+tdigest_merge (struct tdigest *td, const struct tdigest *src,
+               size_t compression);
+
+/* Returns the (approximate) quantile 'q' (0 <= q <= 1) of the values of
+   'td' (which must not be empty), with the same interpolation as
+   'percentile_value' */
+long double
+tdigest_quantile (struct tdigest *td, double q, size_t compression);
+
+/* Remove all the values (keeping the allocated memory) */
+void
+tdigest_reset (struct tdigest *td);
+
+/* Returns the number of bytes allocated by the digest */
+size_t
+tdigest_memory (const struct tdigest *td);
+
+/* Frees the internal structures of the digest (not 'td' itself) */
+void
+tdigest_free (struct tdigest *td);
+
+#endif /* __TDIGEST_H__ */
@@ -24,6 +24,10 @@
 #include <assert.h>
 #include <ctype.h>
 #include <stdbool.h>
+#if defined __SSE2__ && defined __GNUC__
+# include <emmintrin.h>
+# define SPLIT_SSE2 1
+#endif
 
 #include "system.h"
 #ifndef MAX
@@ -34,12 +38,17 @@
 
 #include "text-options.h"
 #include "text-lines.h"
+#include "input-map.h"
+#include "input-threads.h"
 #include "die.h"
 
 void
 line_record_init (struct line_record_t* lr)
 {
   initbuffer (&lr->lbuf);
+  lr->mapped = false;
+  lr->alloc_buffer = NULL;
+  lr->alloc_size = 0;
   lr->alloc_fields = 10 ;
   lr->num_fields = 0;
   lr->fields = XNMALLOC (lr->alloc_fields, struct field_record_t);
@@ -80,6 +89,50 @@ linebuffer_nullify (struct linebuffer *line)
   --line->length;
 }
 
+/* Point 'lbuf' back to the allocated buffer (if it points into the
+   mapped input) */
+static inline void
+line_record_unmap_buffer (struct line_record_t *lr)
+{
+  if (lr->mapped)
+    {
+      lr->lbuf.buffer = lr->alloc_buffer;
+      lr->lbuf.size = lr->alloc_size;
+      lr->lbuf.length = 0;
+      lr->mapped = false;
+    }
+}
+
+/* Point 'lbuf' to 'line' (not copied, followed by the delimiter or a NUL) */
+static void
+line_record_point_to (struct line_record_t *lr, const char *line, size_t len)
+{
+  if (!lr->mapped)
+    {
+      lr->alloc_buffer = lr->lbuf.buffer;
+      lr->alloc_size = lr->lbuf.size;
+      lr->mapped = true;
+    }
+  lr->lbuf.buffer = (char *) line;
+  lr->lbuf.size = len;
+  lr->lbuf.length = len;
+}
+
+/* Read the next line from the mapped input.  The line is not copied:
+   'lbuf' points to it (followed by the delimiter, not a NUL). */
+static bool
+line_record_read_mapped (struct line_record_t *lr, char delimiter)
+{
+  const char *line;
+  size_t len;
+
+  if (!input_map_read_line (delimiter, &line, &len))
+    return false;
+
+  line_record_point_to (lr, line, len);
+  return true;
+}
+
 static inline void
 line_record_reserve_fields (struct line_record_t* lr, const size_t n)
 {
@@ -91,6 +144,144 @@ line_record_reserve_fields (struct line_record_t* lr, const size_t n)
     }
 }
 
+static inline void
+line_record_set_field (struct line_record_t *lr, size_t n,
+                       const char *buf, size_t len)
+{
+  line_record_reserve_fields (lr, n);
+  lr->fields[n].buf = buf;
+  lr->fields[n].len = len;
+}
+
+/*
+ Splitting a line into fields, without trailing comments.
+
+ With SSE2, the line is scanned 16 bytes at a time: one comparison finds
+ all the delimiters (or blanks) in the block, as a bit mask, and the
+ fields are extracted from the set bits.  The remaining (or all, without
+ SSE2) bytes are scanned one by one.
+ */
+
+/* Split on the delimiter 'delim': N delimiters are N+1 fields.
+   Stops after 'max_fields' fields. */
+static void
+split_fields_delim (struct line_record_t *lr, const char *buf, size_t len,
+                    char delim, size_t max_fields)
+{
+  size_t num_fields = 0;
+  size_t pos = 0;
+  const char *field_beg = buf;
+
+  if (len == 0)
+    {
+      lr->num_fields = 0;
+      return;
+    }
+
+#ifdef SPLIT_SSE2
+  const __m128i vdelim = _mm_set1_epi8 (delim);
+  for (; pos + 16 <= len; pos += 16)
+    {
+      const __m128i block = _mm_loadu_si128 ((const __m128i *) (buf + pos));
+      unsigned int mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, vdelim));
+      while (mask)
+        {
+          const char *d = buf + pos + __builtin_ctz (mask);
+          line_record_set_field (lr, num_fields++, field_beg, d - field_beg);
+          if (num_fields == max_fields)
+            goto done;
+          field_beg = d + 1;
+          mask &= mask - 1;
+        }
+    }
+#endif
+
+  for (; pos < len; ++pos)
+    if (buf[pos] == delim)
+      {
+        const char *d = buf + pos;
+        line_record_set_field (lr, num_fields++, field_beg, d - field_beg);
+        if (num_fields == max_fields)
+          goto done;
+        field_beg = d + 1;
+      }
+  line_record_set_field (lr, num_fields++, field_beg, buf + len - field_beg);
+done:
+  lr->num_fields = num_fields;
+}
+
+/* Split on whitespace transitions: each run of non-blanks is a field.
+   Trailing blanks add an empty field, unless 'ignore_trailing_whitespace'.
+   Stops after 'max_fields' fields. */
+static void
+split_fields_blanks (struct line_record_t *lr, const char *buf, size_t len,
+                     bool ignore_trailing_whitespace, size_t max_fields)
+{
+  size_t num_fields = 0;
+  size_t pos = 0;
+  const char *field_beg = NULL;  /* NULL while in blanks */
+
+#ifdef SPLIT_SSE2
+  if (blanks_space_tab)
+    {
+      const __m128i vspace = _mm_set1_epi8 (' ');
+      const __m128i vtab = _mm_set1_epi8 ('\t');
+      unsigned int prev_blank = 1;  /* the line starts "after a blank" */
+
+      for (; pos + 16 <= len; pos += 16)
+        {
+          const __m128i block = _mm_loadu_si128 ((const __m128i *) (buf + pos));
+          const unsigned int blank =
+            _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (block, vspace),
+                                             _mm_cmpeq_epi8 (block, vtab)));
+          /* bit i: byte i-1 is a blank */
+          const unsigned int shifted = ((blank << 1) | prev_blank) & 0xFFFF;
+          /* field starts (blank to non-blank) and ends (the reverse) */
+          unsigned int edges = blank ^ shifted;
+          prev_blank = blank >> 15;
+
+          while (edges)
+            {
+              const char *p = buf + pos + __builtin_ctz (edges);
+              if (field_beg == NULL)
+                field_beg = p;
+              else
+                {
+                  line_record_set_field (lr, num_fields++,
+                                         field_beg, p - field_beg);
+                  if (num_fields == max_fields)
+                    goto done;
+                  field_beg = NULL;
+                }
+              edges &= edges - 1;
+            }
+        }
+    }
+#endif
+
+  for (; pos < len; ++pos)
+    {
+      const bool blank = blanks[to_uchar (buf[pos])];
+      if (field_beg == NULL && !blank)
+        field_beg = buf + pos;
+      else if (field_beg != NULL && blank)
+        {
+          line_record_set_field (lr, num_fields++,
+                                 field_beg, buf + pos - field_beg);
+          if (num_fields == max_fields)
+            goto done;
+          field_beg = NULL;
+        }
+    }
+
+  if (field_beg != NULL)
+    line_record_set_field (lr, num_fields++, field_beg, buf + len - field_beg);
+  else if (len > 0 && !ignore_trailing_whitespace)
+    line_record_set_field (lr, num_fields++, buf + len, 0);
+done:
+  lr->num_fields = num_fields;
+}
+
 static void
 line_record_parse_fields (/* The buffer. May or may not be the one in the
                              following argument */
@@ -108,6 +299,18 @@ line_record_parse_fields (/* The buffer. May or may not be the one in the
   const size_t buflen = lbuf->length;
   const char*  fptr   = lbuf->buffer;
 
+  if (!ignore_trailing_comments)
+    {
+      const size_t max_fields = max_parsed_fields ? max_parsed_fields
+                                                  : SIZE_MAX;
+      if (field_delim != TAB_WHITESPACE)
+        split_fields_delim (lr, fptr, buflen, field_delim, max_fields);
+      else
+        split_fields_blanks (lr, fptr, buflen, ignore_trailing_whitespace,
+                             max_fields);
+      return;
+    }
+
 #define IS_TRAILING_COMMENT \
   (ignore_trailing_comments && (*fptr == '#'))
 
@@ -228,11 +431,23 @@ line_record_fread (struct /* in/out */ line_record_t *lr,
                    bool skip_comments,
                    bool vnlog_prologue)
 {
+  if (input_threads_active (stream))
+    return input_threads_read_line (lr);
+
   while (1)
     {
-      if (readlinebuffer_delim (&lr->lbuf, stream, delimiter) == 0)
-        return false;
-      linebuffer_nullify (&lr->lbuf);
+      if (input_map_active (stream))
+        {
+          if (!line_record_read_mapped (lr, delimiter))
+            return false;
+        }
+      else
+        {
+          line_record_unmap_buffer (lr);
+          if (readlinebuffer_delim (&lr->lbuf, stream, delimiter) == 0)
+            return false;
+          linebuffer_nullify (&lr->lbuf);
+        }
 
       if (vnlog)
         {
@@ -289,18 +504,66 @@ line_record_fread (struct /* in/out */ line_record_t *lr,
       break;
     }
 
+  line_record_parse (lr);
+  return true;
+}
+
+bool
+line_record_load (struct line_record_t *lr, const char *line, size_t len,
+                  bool copy)
+{
+  if (copy)
+    {
+      line_record_reserve_buffer (lr, len + 1);
+      memcpy (lr->lbuf.buffer, line, len);
+      lr->lbuf.buffer[len] = 0;
+      lr->lbuf.length = len;
+    }
+  else
+    line_record_point_to (lr, line, len);
+
+  if (skip_comments && line_record_is_comment (lr))
+    return false;
+
+  line_record_parse (lr);
+  return true;
+}
+
+void
+line_record_parse (struct line_record_t *lr)
+{
   line_record_parse_fields (&lr->lbuf, lr, in_tab,
                             /* Ignore trailing comments only if --vnlog */
                             vnlog && skip_comments,
 
                             /* ignore trailing whitespace only if --vnlog */
                             vnlog);
-  return true;
+}
+
+void
+line_record_add_field (struct line_record_t *lr, const char *buf, size_t len)
+{
+  line_record_reserve_fields (lr, lr->num_fields);
+  lr->fields[lr->num_fields].buf = buf;
+  lr->fields[lr->num_fields].len = len;
+  lr->num_fields++;
+}
+
+void
+line_record_reserve_buffer (struct line_record_t *lr, size_t size)
+{
+  line_record_unmap_buffer (lr);
+  if (lr->lbuf.size < size)
+    {
+      lr->lbuf.buffer = xrealloc (lr->lbuf.buffer, size);
+      lr->lbuf.size = size;
+    }
 }
 
 void
 line_record_free (struct line_record_t* lr)
 {
+  line_record_unmap_buffer (lr);
   freebuffer (&lr->lbuf);
   lr->lbuf.buffer = NULL;
   free (lr->fields);
@@ -308,3 +571,73 @@ line_record_free (struct line_record_t* lr)
   lr->alloc_fields = 0;
   lr->num_fields = 0;
 }
+
+static void
+line_record_reserve_exact (struct line_record_t* lr,
+                           size_t buflen, size_t num_fields)
+{
+  line_record_reserve_buffer (lr, buflen);
+  if (lr->alloc_fields < num_fields)
+    {
+      lr->fields = xnrealloc (lr->fields, num_fields,
+                              sizeof (struct field_record_t));
+      lr->alloc_fields = num_fields;
+    }
+}
+
+void
+line_record_copy (struct line_record_t* dst,
+                  const struct line_record_t* src)
+{
+  const char *base = line_record_buffer (src);
+  const size_t len = line_record_length (src);
+
+  line_record_reserve_exact (dst, len + 1, src->num_fields);
+  memcpy (dst->lbuf.buffer, base, len);
+  dst->lbuf.buffer[len] = 0;
+  dst->lbuf.length = len;
+
+  /* Fields point into the source buffer - re-base them on the copy */
+  for (size_t i = 0; i < src->num_fields; ++i)
+    {
+      dst->fields[i].buf = dst->lbuf.buffer + (src->fields[i].buf - base);
+      dst->fields[i].len = src->fields[i].len;
+    }
+  dst->num_fields = src->num_fields;
+}
+
+void
+line_record_copy_fields (struct line_record_t* dst,
+                         const struct line_record_t* src,
+                         const size_t *cols, size_t num_cols)
+{
+  size_t len = 0;
+  size_t max_col = 0;
+
+  for (size_t i = 0; i < num_cols; ++i)
+    {
+      assert (cols[i] > 0 && cols[i] <= src->num_fields); /* LCOV_EXCL_LINE */
+      len += src->fields[cols[i]-1].len + 1;
+      max_col = MAX (max_col, cols[i]);
+    }
+
+  line_record_reserve_exact (dst, len, max_col);
+  for (size_t i = 0; i < max_col; ++i)
+    {
+      dst->fields[i].buf = "";
+      dst->fields[i].len = 0;
+    }
+
+  char *p = dst->lbuf.buffer;
+  for (size_t i = 0; i < num_cols; ++i)
+    {
+      const struct field_record_t *f = &src->fields[cols[i]-1];
+      memcpy (p, f->buf, f->len);
+      p[f->len] = 0;
+      dst->fields[cols[i]-1].buf = p;
+      dst->fields[cols[i]-1].len = f->len;
+      p += f->len + 1;
+    }
+  dst->lbuf.length = len;
+  dst->num_fields = max_col;
+}
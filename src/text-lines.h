@@ -34,6 +34,13 @@ struct line_record_t
      readlinbuffer_delim */
   struct linebuffer lbuf;
 
+  /* If true, 'lbuf.buffer' points directly into the memory-mapped
+     input (see input-map.h), and must not be modified.  The allocated
+     buffer is then kept in 'alloc_buffer' and 'alloc_size'. */
+  bool mapped;
+  char *alloc_buffer;
+  size_t alloc_size;
+
   /* array of fields. Each valid field is a pointer to 'lbuf' */
   struct field_record_t *fields;
   size_t num_fields;    /* number of fields in this line */
@@ -85,7 +92,45 @@ line_record_fread (struct /* in/out */ line_record_t* lr,
                    FILE *stream, char delimiter, bool skip_comments,
                    bool vnlog_prologue);
 
+/* Set the line of 'lr' to 'line' ('len' bytes, without the delimiter),
+   and split it into fields as line_record_fread does (without vnlog).
+   If 'copy' is false, 'line' is used directly and must remain valid
+   (and be followed by the delimiter or a NUL).
+   Returns false if it's a comment line to skip (--skip-comments). */
+bool
+line_record_load (struct line_record_t *lr, const char *line, size_t len,
+                  bool copy);
+
+/* Split the line in 'lr->lbuf' into fields (as done by line_record_fread).
+   Used for lines which were not read with line_record_fread. */
+void
+line_record_parse (struct line_record_t *lr);
+
+/* Make 'lr->lbuf' an allocated buffer of at least 'size' bytes
+   (e.g. to read a line directly into it). */
+void
+line_record_reserve_buffer (struct line_record_t *lr, size_t size);
+
+/* Append a field to the line record.  'buf' is not copied, and must
+   remain valid as long as the field is used. */
+void
+line_record_add_field (struct line_record_t *lr, const char *buf, size_t len);
+
 void
 line_record_free (struct line_record_t* lr);
 
+/* Copy the line 'src' (buffer and fields) into 'dst'.
+   'dst' must be initialized (or zeroed), and is re-allocated as needed. */
+void
+line_record_copy (struct line_record_t* dst,
+                  const struct line_record_t* src);
+
+/* Copy only the fields listed in 'cols' (1 = first field) from 'src' into
+   'dst', each stored NUL-terminated.  All other fields of 'dst' are empty.
+   Used to keep a compact copy of the key fields of a line. */
+void
+line_record_copy_fields (struct line_record_t* dst,
+                         const struct line_record_t* src,
+                         const size_t *cols, size_t num_cols);
+
 #endif
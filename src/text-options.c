@@ -29,6 +29,7 @@
 
 #include "die.h"
 #include "double-format.h"
+#include "number-format.h"
 #include "text-options.h"
 
 /* The character marking end of line. Default to \n. */
@@ -70,26 +71,26 @@ bool skip_comments = false;
 
 bool vnlog = false;
 
+size_t max_parsed_fields = 0;
+
 #define UCHAR_LIM (UCHAR_MAX + 1)
 bool blanks[UCHAR_LIM];
+bool blanks_space_tab = false;
 
 void
 init_blank_table (void)
 {
   size_t i;
 
+  blanks_space_tab = true;
   for (i = 0; i < UCHAR_LIM; ++i)
     {
       blanks[i] = !! isblank (i);
+      if (blanks[i] != (i == ' ' || i == '\t'))
+        blanks_space_tab = false;
     }
 }
 
-/* Force generation of these inline'd symbols, needed to avoid
-   "undefined reference" when compiling with coverage instrumentation.
-   See: http://stackoverflow.com/a/16245669 */
-void print_field_separator ();
-void print_line_separator ();
-
 
 
 /* Calculate the required size of the output buffer */
@@ -100,6 +101,7 @@ finalize_numeric_output_buffer ()
   long double d = LDBL_MAX;
   int n = snprintf (&c, 1, numeric_output_format, d);
   numeric_output_bufsize = n + 100 ;
+  number_format_init (numeric_output_format);
 }
 
 void
@@ -70,25 +70,20 @@ extern bool skip_comments;
 
 extern bool vnlog;
 
+/* If not zero, input lines are split only up to this field: the other
+   fields are not used (and line_record_num_fields is at most this). */
+extern size_t max_parsed_fields;
+
 #define UCHAR_LIM (UCHAR_MAX + 1)
 extern bool blanks[UCHAR_LIM];
 
+/* true if the only blanks are space and TAB (as in the C locale) */
+extern bool blanks_space_tab;
+
 /* Initializes the 'blanks' table. */
 void
 init_blank_table (void);
 
-static inline void
-print_field_separator ()
-{
-  putchar (out_tab);
-}
-
-static inline void
-print_line_separator ()
-{
-  putchar (eolchar);
-}
-
 
 void
 set_numeric_output_precision (const char* digits);
@@ -34,6 +34,7 @@
 #include "xalloc.h"
 #include "size_max.h"
 
+#include "accum-type.h"
 #include "utils.h"
 
 bool _GL_ATTRIBUTE_PURE
@@ -50,31 +51,119 @@ is_na (const char* value, const size_t len)
 see:
 http://www.gnu.org/software/libc/manual/html_node/Comparison-Functions.html */
 int _GL_ATTRIBUTE_PURE
-cmp_long_double (const void *p1, const void *p2)
+cmp_accum (const void *p1, const void *p2)
 {
-  const long double *a = (const long double *)p1;
-  const long double *b = (const long double *)p2;
+  const accum_t *a = (const accum_t *)p1;
+  const accum_t *b = (const accum_t *)p2;
   return ( *a > *b ) - (*a < *b);
 }
 
-long double _GL_ATTRIBUTE_PURE
-median_value (const long double * const values, size_t n)
+static inline void
+swap_accum (accum_t *a, accum_t *b)
 {
-#if 0
-  return percentile_value (values, n, 2.0/4.0);
-#else
-  /* Equivalent to the above, but slightly faster */
-  return (n&0x01)
-    ?values[n/2]
-    :( (values[n/2-1] + values[n/2]) / 2.0 );
-#endif
+  const accum_t t = *a;
+  *a = *b;
+  *b = t;
+}
+
+/* Below this size, sub-arrays are sorted instead of partitioned */
+#define SELECT_SORT_THRESHOLD 16
+
+/* Move the median of values[a],values[b],values[c] to values[a] */
+static void
+median_of_three (accum_t *values, size_t a, size_t b, size_t c)
+{
+  if (values[b] < values[a])
+    swap_accum (&values[a], &values[b]);
+  if (values[c] < values[b])
+    {
+      swap_accum (&values[b], &values[c]);
+      if (values[b] < values[a])
+        swap_accum (&values[a], &values[b]);
+    }
+  swap_accum (&values[a], &values[b]);
+}
+
+/* Quickselect for several ranks at once: partition values[lo..hi) around
+   a pivot, then continue only into the sides containing requested ranks.
+   Like quicksort, the partitioning stops at values equal to the pivot,
+   so runs of equal values (common in real data) are split evenly.
+   If the partitioning goes too deep (bad pivots), the rest is sorted,
+   bounding the worst case to O(n log n) (as in introselect). */
+static void
+select_ranks_rec (accum_t *values, size_t lo, size_t hi,
+                  const size_t *ranks, size_t num_ranks, size_t depth)
+{
+  while (num_ranks > 0)
+    {
+      if (hi - lo <= SELECT_SORT_THRESHOLD || depth-- == 0)
+        {
+          qsortfl (values + lo, hi - lo);
+          return;
+        }
+
+      median_of_three (values, lo, lo + (hi - lo) / 2, hi - 1);
+      const accum_t pivot = values[lo];
+
+      /* (the bounds checks are needed only for NaNs) */
+      size_t i = lo, j = hi;
+      for (;;)
+        {
+          do
+            ++i;
+          while (i < hi && values[i] < pivot);
+          do
+            --j;
+          while (j > lo && pivot < values[j]);
+          if (i >= j)
+            break;
+          swap_accum (&values[i], &values[j]);
+        }
+      swap_accum (&values[lo], &values[j]);
+
+      /* values[lo..j) <= values[j] <= values(j..hi).
+         ranks are sorted: [0,nl) are left of 'j', [ng,num_ranks) right. */
+      size_t nl = 0;
+      while (nl < num_ranks && ranks[nl] < j)
+        ++nl;
+      size_t ng = nl;
+      while (ng < num_ranks && ranks[ng] == j)
+        ++ng;
+
+      select_ranks_rec (values, lo, j, ranks, nl, depth);
+
+      ranks += ng;
+      num_ranks -= ng;
+      lo = j + 1;
+    }
+}
+
+void
+select_ranks (accum_t *values, size_t n,
+              const size_t *ranks, size_t num_ranks)
+{
+  size_t depth = 0;
+  for (size_t i = n; i > 1; i >>= 1)
+    depth += 2;
+  select_ranks_rec (values, 0, n, ranks, num_ranks, depth);
+}
+
+size_t
+percentile_ranks (size_t n, double percentile, size_t *ranks)
+{
+  const double h = ( (n-1) * percentile ) ;
+  const size_t fh = floor (h);
+
+  ranks[0] = fh;
+  ranks[1] = fh + 1;
+  return (fh + 1 < n) ? 2 : 1;
 }
 
 /* This implementation follows R's summary () and quantile (type=7) functions.
    See discussion here:
    http://tolstoy.newcastle.edu.au/R/e17/help/att-1067/Quartiles_in_R.pdf */
 long double _GL_ATTRIBUTE_PURE
-percentile_value (const long double * const values,
+percentile_value (const accum_t * const values,
                   const size_t n, const double percentile)
 {
   const double h = ( (n-1) * percentile ) ;
@@ -83,163 +172,209 @@ percentile_value (const long double * const values,
   /* Error in the calling parameters, should not happen */
   assert (n>0 && percentile>=0.0 && percentile<=100.0); /* LCOV_EXCL_LINE */
 
-  if (n==1)
-    return values[0];
+  if (fh + 1 >= n)
+    return values[fh];
 
   return values[fh] + (h-fh) * ( values[fh+1] - values[fh] ) ;
 }
 
+size_t
+median_ranks (size_t n, size_t *ranks)
+{
+  ranks[0] = (n-1)/2;
+  ranks[1] = n/2;
+  return (n&0x01) ? 1 : 2;
+}
 
-/* Given a sorted array of doubles, return the MAD value
-   (median absolute deviation), with scale constant 'scale' */
 long double _GL_ATTRIBUTE_PURE
-mad_value (const long double * const values, size_t n, double scale)
+median_value (const accum_t * const values, size_t n)
+{
+#if 0
+  return percentile_value (values, n, 2.0/4.0);
+#else
+  /* Equivalent to the above, but slightly faster */
+  return (n&0x01)
+    ?values[n/2]
+    :( (values[n/2-1] + values[n/2]) / 2.0 );
+#endif
+}
+
+long double
+mad_value (const accum_t * const values, size_t n, double scale)
 {
-  const long double median = median_value (values,n);
-  long double *mads = xnmalloc (n,sizeof (long double));
+  const accum_t median = median_value (values,n);
+  accum_t *mads = xnmalloc (n,sizeof (accum_t));
   long double mad = 0 ;
+  size_t ranks[2];
   for (size_t i=0; i<n; ++i)
-    mads[i] = fabsl (median - values[i]);
-  qsortfl (mads,n);
+    mads[i] = accum_fabs (median - values[i]);
+  select_ranks (mads, n, ranks, median_ranks (n, ranks));
   mad = median_value (mads,n);
   free (mads);
   return mad * scale;
 }
 
-long double _GL_ATTRIBUTE_PURE
-arithmetic_mean_value (const long double * const values, const size_t n)
+void
+moments_add (struct moments *m, accum_t x)
 {
-  long double sum=0;
-  long double mean;
-  for (size_t i = 0; i < n; i++)
-    sum += values[i];
-  mean = sum / n ;
-  return mean;
+  /* Pebay's update formulas: each higher moment is updated using
+     the previous (lower) ones, so update M4, M3, M2 in that order. */
+  const accum_t n1 = m->n;
+  const accum_t n = ++m->n;
+  const accum_t delta = x - m->mean;
+  const accum_t delta_n = delta / n;
+  const accum_t delta_n2 = delta_n * delta_n;
+  const accum_t term1 = delta * delta_n * n1;
+
+  m->mean += delta_n;
+  m->m4 += term1 * delta_n2 * (n*n - 3*n + 3)
+           + 6 * delta_n2 * m->m2 - 4 * delta_n * m->m3;
+  m->m3 += term1 * delta_n * (n - 2) - 3 * delta_n * m->m2;
+  m->m2 += term1;
 }
 
-long double _GL_ATTRIBUTE_PURE
-variance_value (const long double * const values, size_t n, int df)
+void
+moments_merge (struct moments *m, const struct moments *src)
 {
-  long double sum=0;
-  long double mean;
-  long double variance;
+  if (src->n == 0)
+    return;
+  if (m->n == 0)
+    {
+      *m = *src;
+      return;
+    }
 
+  /* Pebay's pairwise formulas (equations 3.1 and 2.2 in the paper) */
+  const accum_t na = m->n;
+  const accum_t nb = src->n;
+  const accum_t n = na + nb;
+  const accum_t delta = src->mean - m->mean;
+  const accum_t delta_n = delta / n;
+  const accum_t delta_n2 = delta_n * delta_n;
+  const accum_t term1 = delta * delta_n * na * nb;
+
+  m->m4 += src->m4 + term1 * delta_n2 * (na*na - na*nb + nb*nb)
+           + 6 * delta_n2 * (na*na * src->m2 + nb*nb * m->m2)
+           + 4 * delta_n * (na * src->m3 - nb * m->m3);
+  m->m3 += src->m3 + term1 * delta_n * (na - nb)
+           + 3 * delta_n * (na * src->m2 - nb * m->m2);
+  m->m2 += src->m2 + term1;
+  m->mean += delta_n * nb;
+  m->n += src->n;
+}
+
+long double _GL_ATTRIBUTE_PURE
+variance_value (const struct moments *m, int df)
+{
   assert (df>=0); /* LCOV_EXCL_LINE */
-  if ( (size_t)df == n )
+  if ( (size_t)df == m->n )
     return nanl ("");
 
-  mean = arithmetic_mean_value (values, n);
+  return m->m2 / ( m->n - df );
+}
 
-  sum = 0 ;
-  for (size_t i = 0; i < n; i++)
-    sum += (values[i] - mean) * (values[i] - mean);
+void
+comoments_add (struct comoments *c, accum_t x, accum_t y)
+{
+  const accum_t n = ++c->n;
+  const accum_t dx = x - c->mean_x;
+  const accum_t dy = y - c->mean_y;
+
+  c->mean_x += dx / n;
+  c->mean_y += dy / n;
+  /* The old difference times the new one (Welford's method) */
+  c->m2_x += dx * (x - c->mean_x);
+  c->m2_y += dy * (y - c->mean_y);
+  c->c_xy += dx * (y - c->mean_y);
+  c->sum_xy += x * y;
+}
 
-  variance = sum / ( n - df );
+void
+comoments_merge (struct comoments *c, const struct comoments *src)
+{
+  if (src->n == 0)
+    return;
+  if (c->n == 0)
+    {
+      *c = *src;
+      return;
+    }
 
-  return variance;
+  const accum_t na = c->n;
+  const accum_t nb = src->n;
+  const accum_t n = na + nb;
+  const accum_t dx = src->mean_x - c->mean_x;
+  const accum_t dy = src->mean_y - c->mean_y;
+  const accum_t f = na * nb / n;
+
+  c->m2_x += src->m2_x + dx * dx * f;
+  c->m2_y += src->m2_y + dy * dy * f;
+  c->c_xy += src->c_xy + dx * dy * f;
+  c->sum_xy += src->sum_xy;
+  c->mean_x += dx * nb / n;
+  c->mean_y += dy * nb / n;
+  c->n += src->n;
 }
 
 long double _GL_ATTRIBUTE_PURE
-covariance_value ( const long double * const valuesA,
-                   const long double * const valuesB, size_t n, int df )
+covariance_value ( const struct comoments *c, int df )
 {
-  long double sum=0;
-  long double meanA, meanB;
-  long double covariance;
-
   assert (df>=0); /* LCOV_EXCL_LINE */
-  if ( (size_t)df == n )
+  if ( (size_t)df == c->n )
     return nanl ("");
 
-  meanA = arithmetic_mean_value (valuesA, n);
-  meanB = arithmetic_mean_value (valuesB, n);
-
-  sum = 0 ;
-  for (size_t i = 0; i < n; i++)
-    sum += (valuesA[i] - meanA) * (valuesB[i] - meanB);
-
-  covariance = sum / ( n - df );
-
-  return covariance;
+  return c->c_xy / ( c->n - df );
 }
 
 long double
-pearson_corr_value ( const long double * const valuesA,
-                     const long double * const valuesB, size_t n, int df)
+pearson_corr_value ( const struct comoments *c, int df)
 {
-  long double meanA, meanB, sumA=0, sumB=0, sumCo=0;
   long double sdA, sdB;
   long double covariance;
   long double cor;
 
   assert (df>=0); /* LCOV_EXCL_LINE */
-  if ( (size_t)df == n )
+  if ( (size_t)df == c->n )
     return nanl ("");
 
-  meanA = arithmetic_mean_value (valuesA, n);
-  meanB = arithmetic_mean_value (valuesB, n);
-
-  for (size_t i = 0; i < n; i++)
-    {
-      const long double a = (valuesA[i] - meanA);
-      const long double b = (valuesB[i] - meanB);
-      sumA += a*a;
-      sumB += b*b;
-      sumCo += a*b;
-    }
-
-  covariance = sumCo/(n-df);
-  sdA = sqrtl (sumA/(n-df));
-  sdB = sqrtl (sumB/(n-df));
+  covariance = c->c_xy/(c->n-df);
+  sdA = sqrtl (c->m2_x/(c->n-df));
+  sdB = sqrtl (c->m2_y/(c->n-df));
 
   cor = covariance / ( sdA * sdB );
   return cor;
 }
 
 long double _GL_ATTRIBUTE_PURE
-dot_product_value ( const long double * const valuesA,
-                    const long double * const valuesB, size_t n )
+dot_product_value ( const struct comoments *c )
 {
-  long double sum=0;
-
-  for (size_t i = 0; i < n; i++)
-    sum += valuesA[i] * valuesB[i];
-
-  return sum;
+  return c->sum_xy;
 }
 
 
 long double
-stdev_value (const long double * const values, size_t n, int df)
+stdev_value (const struct moments *m, int df)
 {
-  return sqrtl ( variance_value ( values, n, df ) );
+  return sqrtl ( variance_value ( m, df ) );
 }
 
 /*
- Given an array of doubles, return the skewness
+ Given the moments of a sequence of values, return the skewness
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double
-skewness_value (const long double * const values, size_t n, int df)
+skewness_value (const struct moments *m, int df)
 {
-  long double moment2=0;
-  long double moment3=0;
-  long double mean;
+  const size_t n = m->n;
+  long double moment2;
+  long double moment3;
   long double skewness;
 
   if (n<=1)
     return nanl ("");
 
-  mean = arithmetic_mean_value (values, n);
-
-  for (size_t i = 0; i < n; i++)
-    {
-      const long double t = (values[i] - mean);
-      moment2 += t*t;
-      moment3 += t*t*t;
-    }
-  moment2 /= n;
-  moment3 /= n;
+  moment2 = m->m2 / n;
+  moment3 = m->m3 / n;
 
   /* can't use 'powl (moment2,3.0/2.0)' - not all systems have powl */
   skewness = moment3 / sqrtl (moment2*moment2*moment2);
@@ -265,10 +400,10 @@ SES_value (size_t n)
 
 /* Skewness Test statistics Z = ( sample skewness / SES ) */
 long double
-skewnessZ_value (const long double * const values, size_t n)
+skewnessZ_value (const struct moments *m)
 {
-  const long double skew = skewness_value (values,n,DF_SAMPLE);
-  const long double SES = SES_value (n);
+  const long double skew = skewness_value (m,DF_SAMPLE);
+  const long double SES = SES_value (m->n);
   if (isnan (skew) || isnan (SES) )
     return nanl ("");
   return skew/SES;
@@ -276,30 +411,22 @@ skewnessZ_value (const long double * const values, size_t n)
 
 
 /*
- Given an array of doubles, return the excess kurtosis
+ Given the moments of a sequence of values, return the excess kurtosis
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double _GL_ATTRIBUTE_PURE
-excess_kurtosis_value (const long double * const values, size_t n, int df)
+excess_kurtosis_value (const struct moments *m, int df)
 {
-  long double moment2=0;
-  long double moment4=0;
-  long double mean;
+  const size_t n = m->n;
+  long double moment2;
+  long double moment4;
   long double excess_kurtosis;
 
   if (n<=1)
     return nanl ("");
 
-  mean = arithmetic_mean_value (values, n);
-
-  for (size_t i = 0; i < n; i++)
-    {
-      const long double t = (values[i] - mean);
-      moment2 += t*t;
-      moment4 += t*t*t*t;
-    }
-  moment2 /= n;
-  moment4 /= n;
+  moment2 = m->m2 / n;
+  moment4 = m->m4 / n;
 
   excess_kurtosis = moment4 / (moment2*moment2) - 3;
 
@@ -330,10 +457,10 @@ SEK_value (size_t n)
 
 /* Kurtosis Test statistics Z = ( sample kurtosis / SEK ) */
 long double
-kurtosisZ_value (const long double * const values, size_t n)
+kurtosisZ_value (const struct moments *m)
 {
-  const long double kurt = excess_kurtosis_value (values,n,DF_SAMPLE);
-  const long double SEK = SEK_value (n);
+  const long double kurt = excess_kurtosis_value (m,DF_SAMPLE);
+  const long double SEK = SEK_value (m->n);
   if (isnan (kurt) || isnan (SEK) )
     return nanl ("");
   return kurt/SEK;
@@ -351,16 +478,17 @@ pchisq_df2 (long double x)
 }
 
 /*
- Given an array of doubles, return the p-Value
+ Given the moments of a sequence of values, return the p-Value
  Of the Jarque-Bera Test for normality
    http://en.wikipedia.org/wiki/Jarque%E2%80%93Bera_test
  Equivalent to R's "jarque.test ()" function in the "moments" library.
  */
 long double
-jarque_bera_pvalue (const long double * const values, size_t n )
+jarque_bera_pvalue (const struct moments *m)
 {
-  const long double k = excess_kurtosis_value (values,n,DF_POPULATION);
-  const long double s = skewness_value (values,n,DF_POPULATION);
+  const size_t n = m->n;
+  const long double k = excess_kurtosis_value (m,DF_POPULATION);
+  const long double s = skewness_value (m,DF_POPULATION);
   const long double jb = (long double)(n*(s*s + k*k/4))/6.0 ;
   const long double pval = 1.0 - pchisq_df2 (jb);
   if (n<=1 || isnan (k) || isnan (s))
@@ -374,10 +502,10 @@ jarque_bera_pvalue (const long double * const values, size_t n )
  where the null-hypothesis is normal distribution.
 */
 long double
-dagostino_pearson_omnibus_pvalue (const long double * const values, size_t n)
+dagostino_pearson_omnibus_pvalue (const struct moments *m)
 {
-  const long double z_skew = skewnessZ_value (values, n);
-  const long double z_kurt = kurtosisZ_value (values, n);
+  const long double z_skew = skewnessZ_value (m);
+  const long double z_kurt = kurtosisZ_value (m);
   const long double DP = z_skew*z_skew + z_kurt*z_kurt;
   const long double pval = 1.0 - pchisq_df2 (DP);
 
@@ -386,50 +514,30 @@ dagostino_pearson_omnibus_pvalue (const long double * const values, size_t n)
   return pval;
 }
 
-static void
-update_best_seq ( enum MODETYPE type, size_t seq_size, long double last_value,
-                  size_t * best_seq_size, long double * best_value)
+/* number of element to skip from each end */
+static size_t
+trimmed_mean_skip (size_t n, const long double trimmed_mean_percent)
 {
-  if ( ((type==MODE) && (seq_size > *best_seq_size))
-       || ((type==ANTIMODE) && (seq_size < *best_seq_size)))
-    {
-      *best_seq_size = seq_size;
-      *best_value = last_value;
-    }
+  return pos_zero (floorl (trimmed_mean_percent * n));
 }
 
-long double _GL_ATTRIBUTE_PURE
-mode_value ( const long double * const values, size_t n, enum MODETYPE type)
+size_t
+trimmed_mean_ranks (size_t n, const long double trimmed_mean_percent,
+                    size_t *ranks)
 {
-  /* not ideal implementation but simple enough */
-  /* Assumes 'values' are already sorted, find the longest sequence */
-  long double last_value = values[0];
-  size_t seq_size=1;
-  size_t best_seq_size= (type==MODE)?1:SIZE_MAX;
-  long double best_value = values[0];
-
-  for (size_t i=1; i<n; i++)
-    {
-      bool eq = (cmp_long_double (&values[i],&last_value)==0);
+  if (trimmed_mean_percent >= 0.5)
+    return median_ranks (n, ranks);
 
-      if (eq)
-        {
-          seq_size++;
-        }
-      else
-        {
-          update_best_seq (type, seq_size, last_value, &best_seq_size,
-                           &best_value);
-          seq_size = 1;
-        }
-      last_value = values[i];
-    }
-  update_best_seq (type, seq_size, last_value, &best_seq_size, &best_value);
-  return best_value;
+  const size_t c = trimmed_mean_skip (n, trimmed_mean_percent);
+  if (c == 0)
+    return 0;
+  ranks[0] = c;
+  ranks[1] = n-c-1;
+  return 2;
 }
 
 long double  _GL_ATTRIBUTE_PURE
-trimmed_mean_value ( const long double * const values, size_t n,
+trimmed_mean_value ( const accum_t * const values, size_t n,
                      const long double trimmed_mean_percent)
 {
   assert (trimmed_mean_percent >= 0); /* LCOV_EXCL_LINE */
@@ -440,10 +548,9 @@ trimmed_mean_value ( const long double * const values, size_t n,
   if (trimmed_mean_percent >= 0.5)
     return median_value (values, n);
 
-  /* number of element to skip from each end */
-  size_t c = pos_zero (floorl (trimmed_mean_percent * n));
+  size_t c = trimmed_mean_skip (n, trimmed_mean_percent);
 
-  long double v = 0;
+  accum_t v = 0;
   for (size_t i=c; i< (n-c); i++)
     v += values[i];
 
@@ -469,10 +576,10 @@ cmpstringp_nocase (const void *p1, const void *p2)
   return strcasecmp (* (char * const *) p1, * (char * const *) p2);
 }
 
-/* Sorts (in-place) an array of long-doubles */
-void qsortfl (long double *values, size_t n)
+/* Sorts (in-place) an array of values */
+void qsortfl (accum_t *values, size_t n)
 {
-  qsort (values, n, sizeof (long double), cmp_long_double);
+  qsort (values, n, sizeof (accum_t), cmp_accum);
 }
 
 bool _GL_ATTRIBUTE_PURE
@@ -482,6 +589,27 @@ hash_compare_strings (void const *x, void const *y)
   return STREQ (x, y) ? true : false;
 }
 
+uint64_t _GL_ATTRIBUTE_PURE
+hash_string (const char *str, size_t len, bool case_sensitive)
+{
+  /* FNV-1a, followed by the finalizer of MurmurHash3
+     (so all the bits depend on all the bytes) */
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i)
+    {
+      const unsigned char c = str[i];
+      h ^= case_sensitive ? c : tolower (c);
+      h *= 0x100000001b3ULL;
+    }
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
 
 static bool
 is_add_on_extension (const char *s, size_t l)
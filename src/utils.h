@@ -43,12 +43,27 @@ bool
 is_na (const char* value, const size_t len);
 
 
-/* Given an array of doubles, return the arithmetic mean value */
-long double
-arithmetic_mean_value (const long double * const values, const size_t n);
+/*
+ Partially sort (in-place) an array of values: for each of the
+ (ascending) 'ranks', the value at that index is moved to where it
+ would be if the array was sorted, with all smaller (or equal) values
+ before it and larger (or equal) values after it.
+ Takes expected linear time for a few ranks.
+ */
+void
+select_ranks (accum_t *values, size_t n,
+              const size_t *ranks, size_t num_ranks);
 
 /*
- Given a sorted array of doubles, return the value of 'percentile'.
+ The order-statistics functions below take an array of doubles which is
+ either sorted, or partially ordered by 'select_ranks' with (at least)
+ the ranks returned by the corresponding '_ranks' function.
+ The '_ranks' functions store (up to two) ascending ranks in 'ranks',
+ and return their number.
+ */
+
+/*
+ Given an array of doubles, return the value of 'percentile'.
  Example of valid 'percentile':
     0.10 = First decile
     0.25 = First quartile
@@ -57,36 +72,43 @@ arithmetic_mean_value (const long double * const values, const size_t n);
     0.99 = 99nt percentile
 */
 long double
-percentile_value (const long double * const values,
+percentile_value (const accum_t * const values,
                   const size_t n, const double percentile);
 
-/* Given a sorted array of doubles, return the value of the median */
+size_t
+percentile_ranks (size_t n, double percentile, size_t *ranks);
+
+/* Given an array of doubles, return the value of the median */
 long double
-median_value (const long double * const values, size_t n);
+median_value (const accum_t * const values, size_t n);
 
-/* Given a sorted array of doubles, return the value of 1st quartile */
+size_t
+median_ranks (size_t n, size_t *ranks);
+
+/* Given an array of doubles, return the value of 1st quartile */
 static inline long double
-quartile1_value (const long double * const values, size_t n)
+quartile1_value (const accum_t * const values, size_t n)
 {
   return percentile_value (values, n, 1.0/4.0);
 }
 
-/* Given a sorted array of doubles, return the value of 3rd quartile */
+/* Given an array of doubles, return the value of 3rd quartile */
 static inline long double
-quartile3_value (const long double * const values, size_t n)
+quartile3_value (const accum_t * const values, size_t n)
 {
   return percentile_value (values, n, 3.0/4.0);
 }
 
-/* Given a sorted array of doubles, return the MAD value
-   (median absolute deviation), with scale constant 'scale' */
+/* Given an array of doubles, return the MAD value
+   (median absolute deviation), with scale constant 'scale'.
+   Uses the median ranks. */
 long double
-mad_value (const long double * const values, size_t n, double scale) ;
+mad_value (const accum_t * const values, size_t n, double scale) ;
 
 
-/* Sorts (in-place) an array of long-doubles */
+/* Sorts (in-place) an array of values */
 void
-qsortfl (long double *values, size_t n);
+qsortfl (accum_t *values, size_t n);
 
 
 enum degrees_of_freedom
@@ -96,61 +118,110 @@ enum degrees_of_freedom
 };
 
 /*
- Given an array of doubles, return the variance value.
+ Central moments of a sequence of values, updated one value at a time
+ (so the values themselves need not be stored).
+ 'm2','m3','m4' are the sums of the 2nd,3rd,4th powers of the
+ differences from the mean.
+ See: P. Pebay, "Formulas for Robust, One-Pass Parallel Computation of
+      Covariances and Arbitrary-Order Statistical Moments" (2008).
+ */
+struct moments
+{
+  size_t n;
+  accum_t mean;
+  accum_t m2;
+  accum_t m3;
+  accum_t m4;
+};
+
+/* Add the value 'x' to the moments 'm' */
+void
+moments_add (struct moments *m, accum_t x);
+
+/* Add the values summarized by the moments 'src' to the moments 'm' */
+void
+moments_merge (struct moments *m, const struct moments *src);
+
+/*
+ Given the moments of a sequence of values, return the variance value.
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double
-variance_value ( const long double * const values, size_t n, int df );
+variance_value ( const struct moments *m, int df );
 
 /*
- Given an two array of doubles, return the covariance value.
+ Co-moments of a sequence of pairs of values (x,y),
+ updated one pair at a time.
+ 'm2_x','m2_y' are the sums of the squared differences from the means,
+ 'c_xy' the sum of the products of the differences from the means.
+ */
+struct comoments
+{
+  size_t n;
+  accum_t mean_x;
+  accum_t mean_y;
+  accum_t m2_x;
+  accum_t m2_y;
+  accum_t c_xy;
+  accum_t sum_xy;
+};
+
+/* Add the pair of values 'x','y' to the co-moments 'c' */
+void
+comoments_add (struct comoments *c, accum_t x, accum_t y);
+
+/* Add the pairs of values summarized by 'src' to the co-moments 'c' */
+void
+comoments_merge (struct comoments *c, const struct comoments *src);
+
+/*
+ Given the co-moments of two sequences of values, return the covariance.
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double
-covariance_value ( const long double * const valuesA,
-                   const long double * const valuesB, size_t n, int df );
+covariance_value ( const struct comoments *c, int df );
 
 /*
- Given an two array of doubles, return the Pearson correlation coefficient
+ Given the co-moments of two sequences of values,
+ return the Pearson correlation coefficient
  */
 long double
-pearson_corr_value ( const long double * const valuesA,
-                     const long double * const valuesB, size_t n, int df);
+pearson_corr_value ( const struct comoments *c, int df );
 
 /*
- Given two columns of doubles, return their scalar product value.
+ Given the co-moments of two sequences of values,
+ return their scalar product value.
  */
 long double
-dot_product_value ( const long double * const valuesA,
-                    const long double * const valuesB, size_t n );
+dot_product_value ( const struct comoments *c );
 
 /*
- Given an array of doubles, return the standard-deviation value.
+ Given the moments of a sequence of values, return the standard-deviation.
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double
-stdev_value ( const long double * const values, size_t n, int df );
+stdev_value ( const struct moments *m, int df );
 
 /*
- Given an array of doubles, return the skewness
+ Given the moments of a sequence of values, return the skewness
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double
-skewness_value ( const long double * const values, size_t n, int df );
+skewness_value ( const struct moments *m, int df );
 
 /* Standard error of skewness (SES), given the sample size 'n' */
 long double
 SES_value ( size_t n );
 
 /* Skewness Test statistics Z = ( sample skewness / SES ) */
-long double skewnessZ_value ( const long double * const values, size_t n);
+long double skewnessZ_value ( const struct moments *m );
 
 /*
- Given an array of doubles, return the excess kurtosis
+ Given the moments of a sequence of values, return the excess kurtosis
  'df' is degrees-of-freedom. Use DF_POPULATION or DF_SAMPLE (see above).
  */
 long double
-excess_kurtosis_value ( const long double * const values, size_t n, int df );
+excess_kurtosis_value ( const struct moments *m, int df );
 
 /* Standard error of kurtisos (SEK), given the sample size 'n' */
 long double
@@ -158,7 +229,7 @@ SEK_value ( size_t n );
 
 /* Kurtosis Test statistics Z = ( sample kurtosis / SEK ) */
 long double
-kurtosisZ_value ( const long double * const values, size_t n);
+kurtosisZ_value ( const struct moments *m );
 
 /*
  Chi-Squared - Cumulative distribution function,
@@ -174,20 +245,21 @@ pchisq_df2 (long double x);
  where the null-hypothesis is normal distribution.
 */
 long double
-dagostino_pearson_omnibus_pvalue (const long double * const values, size_t n);
+dagostino_pearson_omnibus_pvalue (const struct moments *m);
 
 
 
 /*
- Given an array of doubles, return the p-Value
+ Given the moments of a sequence of values, return the p-Value
  Of the Jarque-Bera Test for normality
    http://en.wikipedia.org/wiki/Jarque%E2%80%93Bera_test
  Equivalent to R's "jarque.test ()" function in the "moments" library.
  */
 long double
-jarque_bera_pvalue (const long double * const values, size_t n);
+jarque_bera_pvalue (const struct moments *m);
 
 
+/* The mode/anti-mode values (see 'value_counts_mode') */
 enum MODETYPE
 {
   MODE=1,
@@ -195,16 +267,16 @@ enum MODETYPE
 };
 
 /*
- Given an array of doubles, return the mode/anti-mode values.
+ Given an array of doubles, return the trimmed mean.
+ Needs the ranks from 'trimmed_mean_ranks' (see percentile_value above):
+ the trimmed values are then before and after them.
  */
-long double
-mode_value ( const long double * const values, size_t n, enum MODETYPE type);
+size_t
+trimmed_mean_ranks (size_t n, const long double trimmed_mean_percent,
+                    size_t *ranks);
 
-/*
- Given an array of doubles, return the mode/anti-mode values.
- */
 long double
-trimmed_mean_value ( const long double * const values, size_t n,
+trimmed_mean_value ( const accum_t * const values, size_t n,
                      const long double trimmed_mean_percent);
 
 
@@ -218,11 +290,16 @@ int
 cmpstringp_nocase (const void *p1, const void *p2);
 
 int
-cmp_long_double (const void *p1, const void *p2);
+cmp_accum (const void *p1, const void *p2);
 
 bool
 hash_compare_strings (void const *x, void const *y);
 
+/* Returns a 64-bit hash of the string 'str' (of 'len' bytes),
+   ignoring the case of the letters if 'case_sensitive' is false */
+uint64_t
+hash_string (const char *str, size_t len, bool case_sensitive);
+
 
 /* Return the number of characters FROM THE END of 's'
    that match a guessed file extension.
@@ -0,0 +1,173 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "system.h"
+#include "xalloc.h"
+
+#include "accum-type.h"
+#include "utils.h"
+#include "value-counts.h"
+
+/* A table larger than this is freed by 'value_counts_reset', instead of
+   being cleared: clearing it would cost more than small groups */
+#define VALUE_COUNTS_KEEP_ALLOC 1024
+
+static size_t _GL_ATTRIBUTE_CONST
+value_counts_hash (accum_t x)
+{
+  /* Equal values must have the same hash: all NaNs, 0 and -0.
+     The value is hashed as a double (long double values differing only
+     in their extra precision just collide).  */
+  const double d = isnan (x) ? NAN : is_zero (x) ? 0 : (double) x;
+  uint64_t h;
+  memcpy (&h, &d, sizeof h);
+
+  /* The finalizer of MurmurHash3 */
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/* Compare the values while avoiding '==' (all NaNs are equal) */
+static inline bool
+value_counts_equal (accum_t a, accum_t b)
+{
+  if (isnan (a) || isnan (b))
+    return isnan (a) && isnan (b);
+  return !((a > b) || (a < b));
+}
+
+/* Returns the slot of the value 'x': either its slot, or the empty slot
+   where it would be added */
+static size_t _GL_ATTRIBUTE_PURE
+value_counts_slot (const struct value_counts *vc, accum_t x)
+{
+  const size_t mask = vc->alloc - 1;
+  size_t i = value_counts_hash (x) & mask;
+  while (vc->counts[i] && !value_counts_equal (vc->values[i], x))
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* Double the number of slots */
+static void
+value_counts_grow (struct value_counts *vc)
+{
+  struct value_counts old = *vc;
+
+  vc->alloc = old.alloc ? old.alloc * 2 : 8;
+  vc->values = XNMALLOC (vc->alloc, accum_t);
+  vc->counts = xcalloc (vc->alloc, sizeof (size_t));
+  for (size_t i = 0; i < old.alloc; ++i)
+    if (old.counts[i])
+      {
+        const size_t j = value_counts_slot (vc, old.values[i]);
+        vc->values[j] = old.values[i];
+        vc->counts[j] = old.counts[i];
+      }
+
+  free (old.values);
+  free (old.counts);
+}
+
+void
+value_counts_add (struct value_counts *vc, accum_t x, size_t count)
+{
+  assert (count > 0); /* LCOV_EXCL_LINE */
+
+  if (2 * (vc->num_values + 1) > vc->alloc)
+    value_counts_grow (vc);
+
+  const size_t i = value_counts_slot (vc, x);
+  if (vc->counts[i] == 0)
+    {
+      vc->values[i] = x;
+      vc->num_values++;
+    }
+  else if (fpclassify (x) == FP_ZERO && !signbit (x))
+    /* -0 and 0 are counted together, as 0 (unless all are -0) */
+    vc->values[i] = x;
+  vc->counts[i] += count;
+}
+
+void
+value_counts_merge (struct value_counts *vc, const struct value_counts *src)
+{
+  for (size_t i = 0; i < src->alloc; ++i)
+    if (src->counts[i])
+      value_counts_add (vc, src->values[i], src->counts[i]);
+}
+
+long double _GL_ATTRIBUTE_PURE
+value_counts_mode (const struct value_counts *vc, enum MODETYPE type)
+{
+  assert (vc->num_values > 0); /* LCOV_EXCL_LINE */
+
+  size_t best = SIZE_MAX;
+  for (size_t i = 0; i < vc->alloc; ++i)
+    {
+      const size_t count = vc->counts[i];
+      if (count == 0)
+        continue;
+      if (best == SIZE_MAX
+          || (type == MODE ? count > vc->counts[best]
+                           : count < vc->counts[best])
+          || (count == vc->counts[best] && vc->values[i] < vc->values[best]))
+        best = i;
+    }
+  return vc->values[best];
+}
+
+void
+value_counts_reset (struct value_counts *vc)
+{
+  if (vc->alloc > VALUE_COUNTS_KEEP_ALLOC)
+    value_counts_free (vc);
+  else if (vc->num_values)
+    {
+      memset (vc->counts, 0, vc->alloc * sizeof (size_t));
+      vc->num_values = 0;
+    }
+}
+
+size_t _GL_ATTRIBUTE_PURE
+value_counts_memory (const struct value_counts *vc)
+{
+  return vc->alloc * (sizeof (accum_t) + sizeof (size_t));
+}
+
+void
+value_counts_free (struct value_counts *vc)
+{
+  free (vc->values);
+  free (vc->counts);
+  memset (vc, 0, sizeof (*vc));
+}
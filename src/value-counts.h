@@ -0,0 +1,66 @@
+/* GNU Datamash - perform simple calculation on input data
+
+   Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+
+   This file is part of GNU Datamash.
+
+   GNU Datamash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Datamash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __VALUE_COUNTS_H__
+#define __VALUE_COUNTS_H__
+
+/*
+ The number of occurrences of each distinct value, in a hash table
+ (open addressing, linear probing, at most half full).
+
+ Values are equal as numbers: 0 and -0 are the same value (the first
+ one added is kept), and so are all NaNs.
+ */
+
+struct value_counts
+{
+  accum_t *values; /* the distinct values, by slot */
+  size_t  *counts; /* their numbers of occurrences (0 for an empty slot) */
+  size_t  num_values; /* number of distinct values */
+  size_t  alloc; /* number of slots (a power of two) */
+};
+
+/* Add 'count' occurrences of the value 'x' */
+void
+value_counts_add (struct value_counts *vc, accum_t x, size_t count);
+
+/* Add the values counted by 'src' to 'vc' */
+void
+value_counts_merge (struct value_counts *vc, const struct value_counts *src);
+
+/* Returns the most (MODE) or least (ANTIMODE) common value,
+   the smallest one if several values are as common.
+   'vc' must not be empty. */
+long double
+value_counts_mode (const struct value_counts *vc, enum MODETYPE type);
+
+/* Remove all the values */
+void
+value_counts_reset (struct value_counts *vc);
+
+/* Returns the number of bytes allocated by the hash table */
+size_t
+value_counts_memory (const struct value_counts *vc);
+
+/* Frees the hash table (not 'vc' itself) */
+void
+value_counts_free (struct value_counts *vc);
+
+#endif /* __VALUE_COUNTS_H__ */
@@ -226,6 +226,14 @@ my @Tests =
   ['e106','trimmean:1:2  1',    {IN_PIPE=>""}, {EXIT=>1},
     {ERR=>"$prog: too many parameters for operation 'trimmean'\n"}],
 
+   # values for approxmedian/approxperc operations
+  ['e107','approxperc:101  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid percentile value 101\n"}],
+  ['e108','approxmedian:5  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid compression value 5 (expected 10 <= X <= 100000)\n"}],
+  ['e109','approxperc:90:20:3  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: too many parameters for operation 'approxperc'\n"}],
+
   # Rounding
   ['e110','--round ""', {IN_PIPE=>""}, {EXIT=>1},
     {ERR=>"$prog: missing rounding digits value\n"}],
@@ -275,6 +283,20 @@ my @Tests =
     {ERR=>"$prog: invalid numeric value in line 1 field 1: '1.2.3'\n"}],
   ['e152', 'sum 2', {IN_PIPE=>"1.2\t3.4.5\n"}, {EXIT=>1},
     {ERR=>"$prog: invalid numeric value in line 1 field 2: '3.4.5'\n"}],
+  ['e152.1', 'sum:int 1', {IN_PIPE=>"1\n2.5\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid integer value in line 2 field 1: '2.5'\n"}],
+  ['e152.2', 'sum:int 1', {IN_PIPE=>"999999999999999999\n" x 10}, {EXIT=>1},
+    {ERR=>"$prog: integer overflow in line 10 field 1: " .
+          "'999999999999999999'\n"}],
+  ['e152.2.1', 'max:int 1', {IN_PIPE=>"1\n9223372036854775808\n"},
+    {EXIT=>1},
+    {ERR=>"$prog: invalid integer value in line 2 field 1: " .
+          "'9223372036854775808'\n"}],
+  ['e152.2.2', 'min:int 1', {IN_PIPE=>"-9223372036854775809\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid integer value in line 1 field 1: " .
+          "'-9223372036854775809'\n"}],
+  ['e152.3', 'mean:int 1', {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid parameter int for operation 'mean'\n"}],
 
   # bad seeds
   ['e153', '-S1.1 rand 1',
@@ -286,6 +308,92 @@ my @Tests =
   ['e155', '-Sa rand 1',
     {IN_PIPE=>"1\n"}, {EXIT=>1},
     {ERR=>"$prog: invalid seed\n"}],
+
+  # bad memory limits
+  ['e156', '-s --memory-limit=0 -g 1 count 1',
+    {IN_PIPE=>"1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid memory limit '0'\n"}],
+  ['e157', '-s --memory-limit=10X -g 1 count 1',
+    {IN_PIPE=>"1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid memory limit '10X'\n"}],
+  ['e158', '-s --memory-limit=-5 -g 1 count 1',
+    {IN_PIPE=>"1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid memory limit '-5'\n"}],
+  # errors in spilled lines report the input line number
+  ['e159', '-s --memory-limit=1 -g 1 sum 2',
+    {IN_PIPE=>"a\t1\nb\t2\nc\tx\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid numeric value in line 3 field 2: 'x'\n"}],
+
+  # bad number of threads
+  ['e160', '--threads=0 sum 1',
+    {IN_PIPE=>"1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid number of threads '0'\n"}],
+  ['e161', '--threads=1x sum 1',
+    {IN_PIPE=>"1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid number of threads '1x'\n"}],
+  ['e162', '--threads=257 sum 1',
+    {IN_PIPE=>"1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid number of threads '257'\n"}],
+  # errors in lines split by the threads report the input line number
+  ['e163', '--threads=3 sum 2',
+    {IN_PIPE=>"a\t1\nb\t2\nc\tx\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid numeric value in line 3 field 2: 'x'\n"}],
+
+  # partial results
+  ['e164', '-g 1 --merge-partial sum 2',
+    {IN_PIPE=>"a\t1/3\na\t2/x\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid partial result in line 2 field 2: '2/x'\n"}],
+  ['e165', '-g 1 --merge-partial mean 2',
+    {IN_PIPE=>"a\t1/0x1p+0/3\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid partial result in line 1 field 2: '1/0x1p+0/3'\n"}],
+  ['e166', '-g 1 --merge-partial sum:int 2',
+    {IN_PIPE=>"a\t1/0x1p+0\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid partial result in line 1 field 2: '1/0x1p+0'\n"}],
+  ['e167', '-t+ -g 1 --emit-partial sum 2',
+    {IN_PIPE=>"a+1\n"}, {EXIT=>1},
+    {ERR=>"$prog: --emit-partial cannot be used with the delimiter '+'\n"}],
+  ['e168', '-t. --output-delimiter=: -g 1 --merge-partial sum 2',
+    {IN_PIPE=>"a.1/1\n"}, {EXIT=>1},
+    {ERR=>"$prog: --merge-partial cannot be used with the delimiter '.'\n"}],
+  ['e169', '--emit-partial crosstab 1,2',
+    {IN_PIPE=>"a\tb\n"}, {EXIT=>1},
+    {ERR=>"$prog: --emit-partial requires grouping operations\n"}],
+  ['e170', '--merge-partial md5 1',
+    {IN_PIPE=>"a\n"}, {EXIT=>1},
+    {ERR=>"$prog: --merge-partial requires grouping operations\n"}],
+  ['e171', '--full --emit-partial -g 1 count 1',
+    {IN_PIPE=>"a\n"}, {EXIT=>1},
+    {ERR=>"$prog: --emit-partial cannot be used with --full\n"}],
+
+  # approxcountunique precision
+  ['e172','approxcountunique:3  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid precision value 3 (expected 4 <= X <= 18)\n"}],
+  ['e173','approxcountunique:14:2  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: too many parameters for operation 'approxcountunique'\n"}],
+  ['e174', '-g 1 --merge-partial approxcountunique:4 2',
+    {IN_PIPE=>"a\t1/1/AQ\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid partial result in line 1 field 2: '1/1/AQ'\n"}],
+
+  # topk/approxtopk parameters
+  ['e175','topk:0  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid number of values 0\n"}],
+  ['e176','approxtopk:5:4  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid capacity value 4 (expected 5 <= X <= 1000000)\n"}],
+  ['e177','approxtopk:1:2:3  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: too many parameters for operation 'approxtopk'\n"}],
+  ['e178', '-g 1 --merge-partial topk 2',
+    {IN_PIPE=>"a\t2/1/YQ/1\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid partial result in line 1 field 2: '2/1/YQ/1'\n"}],
+
+  # sample parameters
+  ['e179','sample:0  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: invalid sample size 0\n"}],
+  ['e180','sample:1:2  1',    {IN_PIPE=>""}, {EXIT=>1},
+    {ERR=>"$prog: too many parameters for operation 'sample'\n"}],
+  # sample partial result: fewer strings than the values (up to K)
+  ['e181', '-g 1 --merge-partial sample:2 2',
+    {IN_PIPE=>"a\t3/YQ==\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid partial result in line 1 field 2: '3/YQ=='\n"}],
 );
 
 my $save_temps = $ENV{SAVE_TEMPS};
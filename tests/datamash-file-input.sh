@@ -0,0 +1,126 @@
+#!/bin/sh
+#   Unit Tests for GNU Datamash - perform simple calculation on input data
+
+#    Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+#
+#    This file is part of GNU Datamash.
+#
+#    GNU Datamash is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    GNU Datamash is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+
+##
+## This script tests reading a regular file (redirected to STDIN),
+## which is memory-mapped: the output must be the same as when reading
+## the same input from a pipe.  Likewise when reading the input in
+## background threads (--threads), from a file or a pipe.
+##
+
+. "${test_dir=.}/init.sh"; path_prepend_ ./src
+
+fail=0
+
+## Ensure seq is useable
+openbsd_seq_replacement_
+seq 10 >/dev/null 2>/dev/null \
+    || skip_ "requires a working seq"
+
+# Generate input (the last line without a newline)
+seq 1000 | awk '{ printf "%d\t%d\n", $1 % 10, $1 }' > in1 \
+    || framework_failure_ "generating INPUT failed"
+printf "1\t1001" >> in1 \
+    || framework_failure_ "generating INPUT failed"
+
+# Exactly one page (on most systems), ending with a whitespace-only field
+seq 800 | awk '{ printf "a\t%d\n", $1 }' | head -c 4093 > in2 \
+    || framework_failure_ "generating INPUT failed"
+printf "\t \n" >> in2 \
+    || framework_failure_ "generating INPUT failed"
+
+# A NUL-terminated input
+printf "a\t1\000b\t2\000a\t3" > in3 \
+    || framework_failure_ "generating INPUT failed"
+
+for args in "sum 2" "-g 1 count 2 sum 2" "-s -g 1 median 2 unique 2" \
+            "--header-in -g 1 first 2 last 2" "transpose" "reverse" \
+            "rmdup 1" "check" "--full -g 1 max 2" "-W sum 2" ;
+do
+    for in in in1 in2 ;
+    do
+        cat $in | datamash $args > exp 2>&1
+        datamash $args < $in > out 2>&1
+        compare exp out \
+            || { warn_ "'datamash $args < $in' failed" ; fail=1 ; }
+    done
+done
+
+cat in3 | datamash -z -g 1 sum 2 > exp \
+    || framework_failure_ "'datamash -z -g 1 sum 2' failed"
+datamash -z -g 1 sum 2 < in3 > out \
+    || { warn_ "'datamash -z -g 1 sum 2 < in3' failed" ; fail=1 ; }
+compare exp out || fail=1
+cp exp exp3 || framework_failure_ "copying EXP failed"
+
+# With --threads, the lines are read and split in background threads:
+# the output must be the same, from a file or a pipe
+for args in "sum 2" "-g 1 count 2 sum 2" "-s -g 1 median 2 unique 2" \
+            "--header-in -g 1 first 2 last 2" "transpose" "check" \
+            "--full -g 1 max 2" "-W sum 2" "-C -g 1 sum 2" ;
+do
+    for in in in1 in2 ;
+    do
+        datamash $args < $in > exp 2>&1
+        for threads in 2 3 ;
+        do
+            cat $in | datamash --threads=$threads $args > out 2>&1
+            compare exp out \
+                || { warn_ "'datamash --threads=$threads $args' failed" ; \
+                     fail=1 ; }
+            datamash --threads=$threads $args < $in > out 2>&1
+            compare exp out \
+                || { warn_ "'datamash --threads=$threads $args < $in' failed" ;
+                     fail=1 ; }
+        done
+    done
+done
+
+# An input of several chunks (of 1MiB), whose groups are collected
+# separately by the threads, then merged (in a different order: the last
+# digits of inexact results may differ, and are rounded with -R)
+seq 250000 | awk '{ printf "%d\t%d\t%s\n", $1 % 7, $1 % 1000, \
+                                          ($1 % 3 ? "a" : "b") }' > in5 \
+    || framework_failure_ "generating INPUT failed"
+for args in "-R 6 -s -g 1 sum 2 mean 2 median 2 first 3 last 3 countunique 3" \
+            "-R 6 --keep-order -g 3 min 2 max 2 pstdev 2 pcov 1:2 mode 2" \
+            "-R 6 sum 1 q3 2 svar 2 unique 3" "-s crosstab 1,3 count 2" ;
+do
+    datamash $args < in5 > exp 2>&1
+    cat in5 | datamash --threads=3 $args > out 2>&1
+    compare exp out \
+        || { warn_ "'datamash --threads=3 $args' failed" ; fail=1 ; }
+done
+
+cat in3 | datamash -z --threads=2 -g 1 sum 2 > out \
+    || { warn_ "'datamash -z --threads=2 -g 1 sum 2' failed" ; fail=1 ; }
+compare exp3 out || fail=1
+
+# The input starts at the current offset of STDIN, and the remaining
+# input (none) is left for the next program
+printf "x\n1\n2\n3\n" > in4 \
+    || framework_failure_ "generating INPUT failed"
+printf "x\n6\n" > exp4 \
+    || framework_failure_ "generating EXP4 failed"
+( read x && echo "$x" && datamash sum 1 && cat ) < in4 > out4 \
+    || { warn_ "'datamash sum 1' (after reading one line) failed" ; fail=1 ; }
+compare exp4 out4 || fail=1
+
+Exit $fail
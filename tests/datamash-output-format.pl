@@ -48,6 +48,24 @@ my $in1=<<'EOF';
 0.000005
 EOF
 
+my $in2=<<'EOF';
+a 123456.789
+b -0.0001234
+c 1e-5
+d 12345678901234
+e 123456789012345
+f 0.30000000000000004
+EOF
+
+my $out2=<<'EOF';
+a	123456.789
+b	-0.0001234
+c	1e-05
+d	12345678901234
+e	1.2345678901234e+14
+f	0.3
+EOF
+
 my @Tests =
 (
   # Test Rouding
@@ -65,6 +83,12 @@ my @Tests =
   ['r8', '--round 3 -R 7 sum 1',   {IN_PIPE=>$in1},  {OUT => "1.0000090\n"}],
   ['r9', '--round 7 -R 3 sum 1',   {IN_PIPE=>$in1},  {OUT => "1.000\n"}],
 
+  # Rounding edge cases (ties, negative zero, carry into a new digit)
+  ['r10', '--round 2 sum 1', {IN_PIPE=>"-0.001\n"}, {OUT => "-0.00\n"}],
+  ['r11', '--round 2 sum 1', {IN_PIPE=>"0.125\n"},  {OUT => "0.12\n"}],
+  ['r12', 'sum 1', {IN_PIPE=>"9.999999999999999\n"}, {OUT => "10\n"}],
+  ['r13', '-W -g1 sum 2', {IN_PIPE=>$in2}, {OUT => $out2}],
+
 
   # Test Custom formats: %f
   ['f1', '--format "%07.3f" sum 1',  {IN_PIPE=>$in1},  {OUT => "001.000\n"}],
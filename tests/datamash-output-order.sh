@@ -0,0 +1,59 @@
+#!/bin/sh
+#   Unit Tests for GNU Datamash - perform simple calculation on input data
+
+#    Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+#
+#    This file is part of GNU Datamash.
+#
+#    GNU Datamash is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    GNU Datamash is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+
+##
+## This script tests that the output written before an error appears
+## before the error message, when stdout and stderr are the same file.
+##
+
+. "${test_dir=.}/init.sh"; path_prepend_ ./src
+
+fail=0
+
+## Cross-Compiling portability hack:
+##  under qemu/binfmt, argv[0] (which is used to report errors) will contain
+##  the full path of the binary, if the binary is on the $PATH.
+PROG_ARGV0=$(datamash --foobar 2>&1 | head -n 1 | cut -f1 -d:)
+[ -z "$PROG_ARGV0" ] && PROG_ARGV0="datamash"
+
+## Per-line operations: the rows before the invalid value
+printf '1 1.4\n2 2.6\n3 x\n' > in1 &&
+printf "1\n3\n%s: invalid numeric value in line 3 field 2: 'x'\n" \
+       "$PROG_ARGV0" > exp1 \
+    || framework_failure_ "generating in1/exp1 failed"
+
+## Grouping: the completed groups before the invalid line
+printf 'a 1\na 1\nb 2\nc\n' > in2 &&
+printf '1\t2\n%s: invalid input: field 2 requested, line 4 has only 1 fields\n' \
+       "$PROG_ARGV0" > exp2 \
+    || framework_failure_ "generating in2/exp2 failed"
+
+## NOTE: These runs SHOULD fail, hence the "&&" instead of "||"
+datamash -W round 2 < in1 > out1 2>&1 &&
+  { warn_ "datamash -W round 2 did not fail (it should have failed)" ;
+    fail=1 ; }
+compare exp1 out1 || { warn_ "per-line output after the error" ; fail=1 ; }
+
+datamash -W --no-strict -g 2 count 2 < in2 > out2 2>&1 &&
+  { warn_ "datamash -W --no-strict -g 2 count 2 did not fail " \
+          "(it should have failed)" ; fail=1 ; }
+compare exp2 out2 || { warn_ "grouped output after the error" ; fail=1 ; }
+
+Exit $fail
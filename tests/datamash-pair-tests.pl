@@ -166,6 +166,20 @@ my $in5=<<'EOF';
 3	6
 EOF
 
+# Same number of items in each field, but not on the same lines
+my $in7=<<'EOF';
+1	NA
+NA	4
+3	6
+EOF
+
+# NAs in both fields on the same line
+my $in8=<<'EOF';
+1	2
+NA	NA
+3	6
+EOF
+
 my $in6=<<'EOF';
 x y
 1 0.5
@@ -242,6 +256,10 @@ my @Tests =
   ['dp6', '--narm dotprod 1:2', {IN_PIPE=>$in5}, {EXIT=>1},
     {ERR=>"$prog: input error for operation 'dotprod': " .
           "fields 1,2 have different number of items\n"}],
+  ['c7', '--narm pcov 1:2',     {IN_PIPE=>$in7}, {EXIT=>1},
+    {ERR=>"$prog: input error for operation 'pcov': " .
+          "fields 1,2 have different number of items\n"}],
+  ['c8', '--narm pcov 1:2 dotprod 1:2', {IN_PIPE=>$in8}, {OUT=>"2\t20\n"}],
 );
 
 my $save_temps = $ENV{SAVE_TEMPS};
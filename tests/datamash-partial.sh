@@ -0,0 +1,130 @@
+#!/bin/sh
+#   Unit Tests for GNU Datamash - perform simple calculation on input data
+
+#    Copyright (C) 2026 Timothy Rice <trice@posteo.net>
+#
+#    This file is part of GNU Datamash.
+#
+#    GNU Datamash is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    GNU Datamash is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with GNU Datamash.  If not, see <https://www.gnu.org/licenses/>.
+
+##
+## This script tests partial results: the partial results of separate
+## parts of the input (--emit-partial), combined with --merge-partial,
+## must give the same output as the entire input.
+##
+
+. "${test_dir=.}/init.sh"; path_prepend_ ./src
+
+fail=0
+
+## Ensure seq is useable
+openbsd_seq_replacement_
+seq 10 >/dev/null 2>/dev/null \
+    || skip_ "requires a working seq"
+
+# Generate input, in three parts (some groups only appear in some parts)
+seq 3000 | awk '{ printf "%d\t%d\t%s\t%d\n", $1 % 7, ($1 * 37) % 101 - 50, \
+                  substr("abcde", $1 % 5 + 1, 1), ($1 < 1500 ? $1 % 3 : 7) }' \
+    > in || framework_failure_ "generating INPUT failed"
+sed -n '1,1000p' in > part1 &&
+sed -n '1001,2000p' in > part2 &&
+sed -n '2001,$p' in > part3 \
+    || framework_failure_ "splitting INPUT failed"
+
+for args in "-g 1 count 2 sum 2 min 2 max 2 absmax 2 range 2" \
+            "-g 1 first 3 last 3 unique 3 collapse 3 countunique 3" \
+            "-g 4 approxcountunique 2 approxcountunique:4 1 countunique 1" \
+            "-g 4 topk:3 3 topk 2" "-i -g 1 topk:2 3" \
+            "-R 6 -g 4 mean 2 median 2 q1 2 iqr 2 perc:90 2 mode 2 mad 2" \
+            "-R 6 -g 4,1 pstdev 2 svar 2 sskew 2 pkurt 2 trimmean:0.2 2" \
+            "-R 6 -g 3 pcov 1:2 spearson 1:2 dotprod 2:4 geomean 4" \
+            "-R 6 sum 2 mean 2 sstdev 2" "-i -g 3 sum:int 2 min:int 2" ;
+do
+    datamash -s $args < in > exp \
+        || framework_failure_ "'datamash -s $args' failed"
+    for part in part1 part2 part3 ;
+    do
+        datamash -s --emit-partial $args < $part \
+            || { warn_ "'datamash --emit-partial $args' failed" ; fail=1 ; }
+    done > partial
+
+    datamash -s --merge-partial $args < partial > out \
+        || { warn_ "'datamash --merge-partial $args' failed" ; fail=1 ; }
+    compare exp out || fail=1
+
+    # Partial results of partial results
+    datamash --merge-partial --emit-partial $args < partial \
+        | datamash -s --merge-partial $args > out \
+        || { warn_ "'datamash --merge-partial --emit-partial $args' failed" ;
+             fail=1 ; }
+    compare exp out || fail=1
+
+    cat partial | datamash -s --threads=3 --merge-partial $args > out \
+        || { warn_ "'datamash --threads=3 --merge-partial $args' failed" ;
+             fail=1 ; }
+    compare exp out || fail=1
+done
+
+# Approximate operations: the partial result of the entire input is loaded
+# as-is (the same digest or counts); approximate percentiles are exact
+# with fewer values than 2*compression in all
+for args in "-g 4 approxtopk:3:10 2 approxtopk 3" \
+            "-g 1 approxmedian:10 2 approxperc:90:10 2 approxperc 4" \
+            "-g 1 approxmedian:1000 2 approxperc:90:1000 2" ;
+do
+    datamash -s $args < in > exp \
+        || framework_failure_ "'datamash -s $args' failed"
+    datamash -s --emit-partial $args < in \
+        | datamash --merge-partial $args > out \
+        || { warn_ "'datamash --emit-partial $args' failed" ; fail=1 ; }
+    compare exp out || fail=1
+done
+args="-g 1 approxmedian:1000 2 approxperc:90:1000 2"
+for part in part1 part2 part3 ;
+do
+    datamash -s --emit-partial $args < $part \
+        || { warn_ "'datamash --emit-partial $args' failed" ; fail=1 ; }
+done > partial
+datamash -s --merge-partial $args < partial > out \
+    || { warn_ "'datamash --merge-partial $args' failed" ; fail=1 ; }
+compare exp out || fail=1
+
+# Approximate percentiles of infinite values
+awk '{ if (NR % 23 == 0) $2 = (NR % 2 ? "inf" : "-inf") ; print }' OFS='\t' \
+    in > in-inf || framework_failure_ "generating IN-INF failed"
+for args in "-g 1 approxmedian 2 approxperc:1 2 approxperc:99 2" \
+            "approxmedian:10 2 approxperc:1:10 2 approxperc:99:10 2" ;
+do
+    datamash -s $args < in-inf > exp \
+        || framework_failure_ "'datamash -s $args' failed"
+    datamash -s --emit-partial $args < in-inf \
+        | datamash --merge-partial $args > out \
+        || { warn_ "'datamash --emit-partial $args' failed" ; fail=1 ; }
+    compare exp out || fail=1
+done
+
+# Without --sort, the groups are printed in the order they first appear;
+# the header line of the partial results is kept
+printf "GroupBy(x)\tsum(y)\nb\t5\na\t4\n" > exp \
+    || framework_failure_ "generating EXP failed"
+printf "x\ty\nb\t2\na\t1\n" | datamash -H -g 1 --emit-partial sum 2 \
+    > partial \
+    || { warn_ "'datamash -H --emit-partial sum 2' failed" ; fail=1 ; }
+printf "a\t3\nb\t3\n" | datamash -g 1 --emit-partial sum 2 >> partial \
+    || { warn_ "'datamash --emit-partial sum 2' failed" ; fail=1 ; }
+datamash -H -g 1 --merge-partial sum 2 < partial > out \
+    || { warn_ "'datamash -H --merge-partial sum 2' failed" ; fail=1 ; }
+compare exp out || fail=1
+
+Exit $fail
@@ -53,12 +53,32 @@ EOF
 
 my $out=<<'EOF';
 A	B
-B	A
+B	B
+EOF
+
+my $in_seq=join("", map { "$_\n" } (1..10));
+
+my $in_partial=<<'EOF';
+a	3/YQ==/Yg==
+b	1/Yw==
+a	2/ZA==/ZQ==
 EOF
 
 my @Tests =
 (
   ['r1',  '-W -S0 groupby 1 rand 2',  {IN_PIPE=>$in}, {OUT=>$out}],
+
+  # sample: all the values of groups with at most K values
+  ['s1',  '-W -S0 groupby 1 sample:2 2',  {IN_PIPE=>$in},
+     {OUT=>"A\tA,B\nB\tA,B\n"}],
+  ['s2',  '-S1 sample 1',  {IN_PIPE=>$in_seq},
+     {OUT=>"1,2,3,4,5,6,7,8,9,10\n"}],
+  ['s3',  '-S1 sample:3 1',  {IN_PIPE=>$in_seq}, {OUT=>"1,10,4\n"}],
+  ['s4',  '--header-out -S1 sample:3 1',  {IN_PIPE=>"1\n2\n"},
+     {OUT=>"sample:3(field-1)\n1,2\n"}],
+  ['s5',  '-W -S1 --narm sample:3 1',  {IN_PIPE=>"NA\n"}, {OUT=>"\n"}],
+  ['s6',  '-S1 -g 1 --merge-partial sample:2 2',  {IN_PIPE=>$in_partial},
+     {OUT=>"a\ta,b\nb\tc\n"}],
 );
 
 my $save_temps = $ENV{SAVE_TEMPS};
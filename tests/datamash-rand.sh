@@ -21,7 +21,7 @@
 #    Written by Assaf Gordon
 
 ##
-## This script tests the randomness of the 'rand' operation
+## This script tests the randomness of the 'rand' and 'sample' operations
 ##
 
 . "${test_dir=.}/init.sh"; path_prepend_ ./src
@@ -88,4 +88,40 @@ if [ "$RESULT" -lt "60" ] ; then
 fi
 
 
+##
+## --- Second test ---
+##
+##    select 5 random numbers between 0 and 99 ('sample:5'),
+##    repeat selection for 1000 times.
+##    Each selection should have 5 distinct numbers, and each number
+##    should appear close to 50 times.
+
+INPUT=$(seq 0 99) || framework_failure_ "generating INPUT failed"
+
+for i in $(seq 1000) ;
+do
+  echo "$INPUT" | datamash sample:5 1
+done > out_sample1 || framework_failure_ "test2 failed: datamash error"
+
+RESULT=$(awk -F, '{ n = 0; split("", seen);
+                     for (i = 1; i <= NF; i++) if (!seen[$i]++) n++;
+                     print NF, n }' out_sample1 | sort -u) ||
+    framework_failure_ "test2 failed: error preparing first check"
+
+[ "$RESULT" = "5 5" ] ||
+    { warn_ "test2 failed. RESULT='$RESULT'." ; fail=1 ; }
+
+RESULT=$(cat out_sample1 | tr ',' '\n' |
+             datamash --sort --group 1 count 1 |
+             datamash count 1 min 2) ||
+    framework_failure_ "test2 failed: error preparing second check"
+
+NUMBERS=$(echo "$RESULT" | cut -f1)
+MINCOUNT=$(echo "$RESULT" | cut -f2)
+if [ "$NUMBERS" -ne "100" ] || [ "$MINCOUNT" -lt "20" ] ; then
+  warn_ "Possible uniformity problem in 'sample' operation."
+  echo "--- distinct numbers: $NUMBERS, smallest count: $MINCOUNT ---"
+  fail=1
+fi
+
 Exit $fail
@@ -128,6 +128,13 @@ my $seq22 = c(61,61,61,61,61,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,
 # "Example 2: Size of Rat Litters"
 my $seq23 =  c(rep(1,7),rep(2,33),rep(3,58),rep(4,116),rep(5,125),rep(6,126),
                rep(7,121),rep(8,107),rep(9,56),rep(10,37),rep(11,25),rep(12,4));
+# The same, with infinite values
+my $seq23_inf = c(rep("-inf",10)) . $seq23 . c(rep("inf",10));
+# Values with a large offset: variance and the other central moments
+# must be computed without cancellation errors (equal to those of $seq1)
+my $seq24 = c(1000000001,1000000002,1000000003,1000000004);
+# Descending then ascending values, with duplicates
+my $seq25 = c(reverse(1..40), 1..20);
 
 =pod
 The datamash tests below should return the same results are thes R commands:
@@ -450,6 +457,10 @@ my @Tests =
   ['perc90_12','perc:90 1' ,  {IN_PIPE=>$seq22},  {OUT => "70\n"},],
   ['perc90_13','perc:90 1' ,  {IN_PIPE=>$seq23},  {OUT => "9\n"},],
 
+  # Median, IQR of a larger unsorted sequence
+  ['median_seq25', 'median 1', {IN_PIPE=>$seq25},  {OUT => "15.5\n"}],
+  ['iqr_seq25',    'iqr 1',    {IN_PIPE=>$seq25},  {OUT => "17.25\n"}],
+
   # Test perc:95
   ['perc95_1', 'perc:95 1' ,  {IN_PIPE=>$seq1},   {OUT => "3.85\n"}],
   ['perc95_2', 'perc:95 1' ,  {IN_PIPE=>$seq2},   {OUT => "2.9\n"}],
@@ -487,6 +498,8 @@ my @Tests =
   # Test edge cases: perc:1 and perc:100
   ['perc1_1',  'perc:1 1',    {IN_PIPE=>$seq20},  {OUT => "78\n"},],
   ['perc100_1','perc:100 1',  {IN_PIPE=>$seq20},  {OUT => "120\n"},],
+  ['perc100_2','perc:100 1',  {IN_PIPE=>$seq12_unsorted},  {OUT => "37\n"},],
+  ['perc100_3','perc:100 1',  {IN_PIPE=>$seq25},  {OUT => "40\n"},],
 
   # Sanity check: percentile:50 should be equal to 'median' 'op'
   ['perc50_1','perc:50 1' ,  {IN_PIPE=>$seq20}, {OUT => "100\n"},],
@@ -506,6 +519,27 @@ my @Tests =
   ['perc75_12','perc:75 1' ,  {IN_PIPE=>$seq22},  {OUT => "70\n"},],
   ['perc75_13','perc:75 1' ,  {IN_PIPE=>$seq23},  {OUT => "8\n"},],
 
+  # Approximate percentiles (t-digest): exact with few values...
+  ['aperc95_1', 'approxperc 1',    {IN_PIPE=>$seq1},   {OUT => "3.85\n"}],
+  ['aperc90_1', 'approxperc:90 1', {IN_PIPE=>$seq12_unsorted},
+    {OUT => "30.8\n"}],
+  ['aperc99_1', 'approxperc:99 1', {IN_PIPE=>$seq20},  {OUT => "118.02\n"}],
+  ['amedian_1', 'approxmedian 1',  {IN_PIPE=>$seq21},  {OUT => "37\n"}],
+  # ...approximate with more than 2*compression values
+  ['aperc90_2', 'approxperc:90 1', {IN_PIPE=>$seq23},  {OUT => "9\n"}],
+  ['amedian_2', 'approxmedian 1',  {IN_PIPE=>$seq23},  {OUT => "6\n"}],
+  ['aperc95_2', 'approxperc:95:10 1', {IN_PIPE=>$seq20}, {OUT => "114.941\n"}],
+  ['amedian_3', 'approxmedian:10 1',  {IN_PIPE=>$seq20}, {OUT => "100.386\n"}],
+  ['aperc100_1','approxperc:100:10 1',{IN_PIPE=>$seq20}, {OUT => "120\n"}],
+  # Infinite values are not merged into the centroids
+  ['amedian_inf1', 'approxmedian 1', {IN_PIPE=>$seq23_inf}, {OUT => "6\n"}],
+  ['aperc_inf1', 'approxperc:1 1',   {IN_PIPE=>$seq23_inf}, {OUT => "-inf\n"}],
+  ['aperc_inf2', 'approxperc:2 1',   {IN_PIPE=>$seq23_inf}, {OUT => "1.48\n"}],
+  ['aperc_inf3', 'approxperc:98 1',  {IN_PIPE=>$seq23_inf}, {OUT => "11\n"}],
+  ['aperc_inf4', 'approxperc:99 1',  {IN_PIPE=>$seq23_inf}, {OUT => "inf\n"}],
+  ['aperc_inf5', 'approxmedian 1 approxperc:10 1 approxperc:75 1',
+    {IN_PIPE=>"inf\n-inf\n1\n"}, {OUT => "1\t-inf\tinf\n"}],
+
 
   # Trimmed Mean:0
   ['tmean0_1', 'trimmean:0 1' ,  {IN_PIPE=>$seq1},   {OUT => "2.5\n"}],
@@ -624,6 +658,7 @@ my @Tests =
   ['svar_9', 'svar 1' ,  {IN_PIPE=>$seq21},  {OUT => "927.128\n"},],
   ['svar_10','svar 1' ,  {IN_PIPE=>$seq22},  {OUT => "8.613\n"},],
   ['svar_11','svar 1' ,  {IN_PIPE=>$seq23},  {OUT => "5.178\n"},],
+  ['svar_12','svar 1' ,  {IN_PIPE=>$seq24},  {OUT => "1.666\n"},],
 
   # Test population variance
   ['pvar_1', 'pvar 1' ,  {IN_PIPE=>$seq1},   {OUT => "1.25\n"}],
@@ -637,6 +672,7 @@ my @Tests =
   ['pvar_9', 'pvar 1' ,  {IN_PIPE=>$seq21},  {OUT => "917.857\n"},],
   ['pvar_10','pvar 1' ,  {IN_PIPE=>$seq22},  {OUT => "8.527\n"},],
   ['pvar_11','pvar 1' ,  {IN_PIPE=>$seq23},  {OUT => "5.172\n"},],
+  ['pvar_12','pvar 1' ,  {IN_PIPE=>$seq24},  {OUT => "1.25\n"},],
 
   # Test MAD (Median Absolute Deviation), with default
   # scaling factor of 1.486 for normal distributions
@@ -712,6 +748,7 @@ my @Tests =
   ['pkurt_9', 'pkurt 1' ,  {IN_PIPE=>$seq21},  {OUT => "1.802\n"},],
   ['pkurt_10','pkurt 1' ,  {IN_PIPE=>$seq22},  {OUT => "-0.258\n"},],
   ['pkurt_11','pkurt 1' ,  {IN_PIPE=>$seq23},  {OUT => "-0.480\n"},],
+  ['pkurt_12','pkurt 1' ,  {IN_PIPE=>$seq24},  {OUT => "-1.36\n"},],
 
   # Test Sample Excess Kurtosis
   ['skurt_1', 'skurt 1' ,  {IN_PIPE=>$seq1},   {OUT => "-1.2\n"}],
@@ -718,6 +718,15 @@ my @Tests =
   ['mode12', 'mode 1', {IN_PIPE=>"9\n"},                          {OUT=>"9\n"}],
   ['mode13', 'mode 1',
     {IN_PIPE=>"1\n1\n1\n2\n2\n2\n2\n3\n3\n4\n4\n4\n4\n4\n"},      {OUT=>"4\n"}],
+  # Unsorted values: the smallest of the most common values
+  ['mode14', 'mode 1', {IN_PIPE=>"3\n1\n3\n1.0\n2\n"},             {OUT=>"1\n"}],
+  ['mode15', 'mode 1 antimode 1',
+    {IN_PIPE=>join ("", map { "$_\n" } (reverse (1..1000), 700, 500, 700))},
+    {OUT=>"700\t1\n"}],
+  # -0 and 0 are the same value: 0, unless all are -0
+  ['mode16', 'mode 1', {IN_PIPE=>"-0\n0\n5\n5\n3\n"},            {OUT=>"0\n"}],
+  ['mode17', 'mode 1 antimode 1', {IN_PIPE=>"-0\n-0\n5\n"},
+    {OUT=>"-0\t5\n"}],
 
   # Test antimode operation
   ['antimode01', 'antimode 1', {IN_PIPE=>"1\n1\n2\n"},          {OUT=>"2\n"}],
@@ -747,6 +756,8 @@ my @Tests =
   ['antimode17', 'antimode 1', {IN_PIPE=>"9\n"}, {OUT=>"9\n"}],
   ['antimode18', 'antimode 1',
     {IN_PIPE=>"1\n1\n1\n2\n2\n2\n2\n3\n3\n4\n4\n4\n4\n4\n"}, {OUT=>"3\n"}],
+  ['antimode19', 'antimode 1',
+    {IN_PIPE=>"3\n1\n2\n3\n1.0\n-0\n4\n4\n0\n"},   {OUT=>"2\n"}],
 
 );
 
@@ -197,6 +197,13 @@ A B
 A C
 EOF
 
+# 100000 distinct values, each twice
+my $in_cnt_uniq3 = join ("", map { "u$_\n" } (1..100000, 1..100000));
+
+# 1000 distinct values, then the same in upper case, in separate groups
+my $in_cnt_uniq4 = join ("", (map { "A u$_\nA U$_\n" } (1..1000)),
+                              (map { "B u$_\n" } (1..1000)));
+
 # When using whitespace, the second column is 1,2,3.
 # When using Tab, the second column is 10,20,30.
 my $in_tab1=<<"EOF";
@@ -423,6 +430,35 @@ my @Tests =
   ['b13.1', '-c ^ collapse 1',
     {IN_PIPE=>$in1}, {OUT => "1^2^3^4^5^6^7^5^8^9^10\n"}],
 
+  # Number formats accepted by strtold
+  ['b13.2', 'sum 1', {IN_PIPE=>"+1.5\n.5\n5.\n1e3\n2.5E-2\n000012\n"},
+    {OUT => "1019.025\n"}],
+  ['b13.3', 'sum 1', {IN_PIPE=>"12345678901234567890123\n0x10\n"},
+    {OUT => "1.2345678901235e+22\n"}],
+
+  # Integer values are summed exactly; ':int' prints the exact result
+  ['b13.4', 'sum 1 sum:int 1 min:int 1 max:int 1',
+    {IN_PIPE=>"123456789012345678\n-3\n+4\n"},
+    {OUT => "1.2345678901235e+17\t123456789012345679\t-3\t123456789012345678\n"}],
+  # The whole int64 range, and "-0"
+  ['b13.4.1', 'sum:int 1 min:int 1 max:int 1',
+    {IN_PIPE=>"-9223372036854775808\n9223372036854775807\n-0\n"},
+    {OUT => "-1\t-9223372036854775808\t9223372036854775807\n"}],
+  ['b13.4.2', 'sum:int 1 min:int 1 max:int 1',
+    {IN_PIPE=>"1000000000000000000\n8000000000000000000\n"},
+    {OUT => "9000000000000000000\t1000000000000000000\t" .
+            "8000000000000000000\n"}],
+  # Overflowing int64, or non-integers: continue in floating-point
+  ['b13.5', 'sum 1', {IN_PIPE=>"999999999999999999\n" x 10},
+    {OUT => "1e+19\n"}],
+  ['b13.6', 'sum 1 min 1 max 1', {IN_PIPE=>"3\n-0\n1.5\n4\n"},
+    {OUT => "8.5\t-0\t4\n"}],
+  ['b13.7', '-W -g 1 sum 2 min 2', {IN_PIPE=>"A 2\nA 1.5\nB 3\nB -4\n"},
+    {OUT => "A\t3.5\t1.5\nB\t-1\t-4\n"}],
+  # Compensated summation: the small values are not lost
+  ['b13.8', 'sum 1 mean 1', {IN_PIPE=>"1e20\n0.1\n-1e20\n0.1\n"},
+    {OUT => "0.2\t0.05\n"}],
+
   # on a different architecture, would printf(%Lg) print something else?
   # Use OUT_SUBST to trim output to 1.3 digits
   ['b14', 'mean 1',     {IN_PIPE=>$in1},  {OUT => "5.454\n"},
@@ -490,6 +526,14 @@ my @Tests =
     {ERR=>"$prog: invalid numeric value in line 3 field 2: '3a'\n"}],
   ['e17',  'sum 1' ,  {IN_PIPE=>"1e-20000\n"}, {EXIT=>1},
     {ERR=>"$prog: invalid numeric value in line 1 field 1: '1e-20000'\n"}],
+  ['e17.1', 'sum 1' ,  {IN_PIPE=>"1e\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid numeric value in line 1 field 1: '1e'\n"}],
+  ['e17.2', 'sum 1' ,  {IN_PIPE=>"1.5e+\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid numeric value in line 1 field 1: '1.5e+'\n"}],
+  ['e17.3', 'sum 1' ,  {IN_PIPE=>".\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid numeric value in line 1 field 1: '.'\n"}],
+  ['e17.4', 'sum 1' ,  {IN_PIPE=>"-\n"}, {EXIT=>1},
+    {ERR=>"$prog: invalid numeric value in line 1 field 1: '-'\n"}],
   ['e18',  'sum 0' ,  {IN_PIPE=>"a"}, {EXIT=>1},
     {ERR=>"$prog: invalid field '0' for operation 'sum'\n"}],
   ['e19',  '-- sum -2' ,  {IN_PIPE=>"a"}, {EXIT=>1},
@@ -612,6 +656,12 @@ my @Tests =
   ['g2.1', '-t" " -g1 median 2', {IN_PIPE=>$in_g1}, {OUT=>"A 42.5\n"}],
   ['g3.1', '-t" " -g1 collapse 2', {IN_PIPE=>$in_g1},
     {OUT=>"A 100,10,50,35\n"}],
+  # Several operations sharing the values of the same field
+  ['g2.2', '-t" " -g1 median 2 q1 2 q3 2 mode 2 iqr 2 sum 2',
+    {IN_PIPE=>$in_g2},
+    {OUT=>"A 42.5 28.75 62.5 10 33.75 195\nB 66 60.5 71.5 55 11 198\n"}],
+  ['g2.3', '-W --header-in -g1 median y q1 y mode y', {IN_PIPE=>$in_hdr1},
+    {OUT=>"A\t3\t2\t4\nB\t6\t5.5\t5\nC\t5\t1.75\t1\n"}],
   ['g4.1', '-t" " -g1 count 2',    {IN_PIPE=>$in_g5},
     {OUT=>"A 1\nAA 1\nAAA 1\n"}],
   # Group on the last column
@@ -718,6 +768,40 @@ my @Tests =
     {OUT=>"a 1\nA 3\n"}],
   ['cuq5', '-i -t" " -g 1 countunique 2', {IN_PIPE=>$in_cnt_uniq2},
     {OUT=>"a 2\n"}],
+  ['cuq6', '-t" " -g 1 countunique 2', {IN_PIPE=>$in_cnt_uniq4},
+    {OUT=>"A 2000\nB 1000\n"}],
+  ['cuq7', '-i -t" " -g 1 countunique 2 unique 2',
+    {IN_PIPE=>"A x\n$in_cnt_uniq4"},
+    {OUT=>"A 1001 " . join (",", sort ("x", map { "u$_" } (1..1000))) . "\n"
+          . "B 1000 " . join (",", sort map { "u$_" } (1..1000)) . "\n"}],
+
+  # topk: the most common values, by decreasing count, then as unique
+  ['topk1', '-t" " -g 1 topk 2', {IN_PIPE=>$in_cnt_uniq2},
+    {OUT=>"a B:1\nA B:1,C:1,b:1\n"}],
+  ['topk2', '-i -t" " -g 1 topk 2', {IN_PIPE=>$in_cnt_uniq2},
+    {OUT=>"a B:3,C:1\n"}],
+  ['topk3', 'topk:2 1 topk:1 1', {IN_PIPE=>"c\nb\na\nb\nc\n"},
+    {OUT=>"b:2,c:2\tb:2\n"}],
+  ['topk4', '--header-out topk:2 1 approxtopk 1', {IN_PIPE=>"c\nb\nb\n"},
+    {OUT=>"topk:2(field-1)\tapproxtopk:10(field-1)\nb:2,c:1\tb:2,c:1\n"}],
+  ['topk5', 'topk:2 1', {IN_PIPE=>$in_cnt_uniq3}, {OUT=>"u1:2,u10:2\n"}],
+  # approxtopk: exact while the distinct values fit,
+  # then the counts are low by the subtracted counts
+  ['atopk1', 'approxtopk:2 1', {IN_PIPE=>"c\nb\na\nb\nc\n"},
+    {OUT=>"b:2,c:2\n"}],
+  ['atopk2', 'approxtopk:1:2 1', {IN_PIPE=>"a\na\nb\nc\na\nd\na\n"},
+    {OUT=>"a:3\n"}],
+
+  # approxcountunique: (nearly) exact with few values, then approximate
+  ['acuq1', '-t" " -g 1 approxcountunique 3', {IN_PIPE=>$in_g3},
+    {OUT=>"A 2\nB 2\nC 1\n"}],
+  ['acuq2', '-t" " -g 1 approxcountunique 2', {IN_PIPE=>$in_cnt_uniq2},
+    {OUT=>"a 1\nA 3\n"}],
+  ['acuq3', '-i -t" " -g 1 approxcountunique 2', {IN_PIPE=>$in_cnt_uniq2},
+    {OUT=>"a 2\n"}],
+  ['acuq4', 'approxcountunique 1', {IN_PIPE=>$in1}, {OUT => "10\n"}],
+  ['acuq5', 'countunique 1 approxcountunique 1 approxcountunique:8 1',
+    {IN_PIPE=>$in_cnt_uniq3}, {OUT => "100000\t100085\t105318\n"}],
 
   # Test Tab vs White-space field separator
   ['tab1', "sum 2", {IN_PIPE=>$in_tab1}, {OUT=>"60\n"}],
@@ -738,6 +822,68 @@ my @Tests =
     {OUT=>"A'4\nB'6\n"}],
   ['sort5', '-s -g 1 sum 2 -t "\"" ', {IN_PIPE=>$in_sort_quote2},
     {OUT=>"A\"4\nB\"6\n"}],
+  # Multiple group-by columns, and the input is not sorted by any of them
+  ['sort6', '-t" " -s -g 2,1 count 1', {IN_PIPE=>$in_case_unsorted},
+    {OUT=>"X A 1\nX a 1\nY B 1\nY b 1\nx A 1\nx a 1\n"}],
+  ['sort7', '-t" " -s -z -g 1 sum 2', {IN_PIPE=>"B 3\x00A 1\x00B 4\x00A 2\x00"},
+    {OUT=>"A 3\x00B 7\x00"}],
+  # The input of the groups is not kept in memory, only the keys
+  ['sort8', '-t" " -s --full -g 1 min 3', {IN_PIPE=>$in_case_unsorted},
+    {OUT=>"A X 2 2\nB Y 6 6\na X 1 1\nb Y 4 4\n"},
+    {ERR=>"datamash: Using -f/--full with non-linewise operations is " .
+          "deprecated and will be disabled in a future release.\n"}],
+
+  # Test --memory-limit: with a tiny limit, every group but the first
+  # is spilled to a temporary file (and re-spilled at the next level)
+  ['memlim1', '-t" " -s --memory-limit=1 -g 1 sum 3 last 3',
+    {IN_PIPE=>$in_case_unsorted}, {OUT=>"A 7 5\nB 6 6\na 4 3\nb 4 4\n"}],
+  ['memlim2', '-t" " -s -i --memory-limit=1 -g 1,2 count 1',
+    {IN_PIPE=>$in_case_unsorted}, {OUT=>"a X 4\nb Y 2\n"}],
+  ['memlim3', '-W -s --memory-limit=1K -g 2 unique 3', {IN_PIPE=>$in_sort1},
+    {OUT=>"A\tx\nB\tk,x\nC\tg,j\nD\tj\n"}],
+  ['memlim4', '-t" " --keep-order --memory-limit=1 -g 1 first 3',
+    {IN_PIPE=>$in_case_unsorted}, {OUT=>"a 1\nA 2\nb 4\nB 6\n"}],
+  ['memlim5', '-t" " -s --memory-limit=1 --full -g 1 min 3',
+    {IN_PIPE=>$in_case_unsorted},
+    {OUT=>"A X 2 2\nB Y 6 6\na X 1 1\nb Y 4 4\n"},
+    {ERR=>"datamash: Using -f/--full with non-linewise operations is " .
+          "deprecated and will be disabled in a future release.\n"}],
+  ['memlim6', '-t" " -s --memory-limit=1 crosstab 1,2',
+    {IN_PIPE=>$in_case_unsorted},
+    {OUT=>" X Y x\nA 1 N/A 1\nB N/A 1 N/A\na 1 N/A 1\nb N/A 1 N/A\n"}],
+  # Many runs: merged two at a time, in several passes
+  ['memlim7', '--keep-order --memory-limit=1 -g 1 sum 2',
+    {IN_PIPE=>join ("", map { ($_ % 9) . "\t$_\n" } 1..45)},
+    {OUT=>"1\t95\n2\t100\n3\t105\n4\t110\n5\t115\n6\t120\n" .
+          "7\t125\n8\t130\n0\t135\n"}],
+
+  # Test --keep-order: groups are printed in order of first appearance
+  ['keep-order1', '--keep-order -g 2 unique 3', {IN_PIPE=>$in_sort1},
+    {OUT=>"x\t1,5\nk\t2\nj\t3,4\ng\t6\n"}],
+  ['keep-order2', '-t" " --keep-order -i -g 1 sum 3',
+    {IN_PIPE=>$in_case_unsorted}, {OUT=>"a 11\nb 10\n"}],
+  ['keep-order3', '-t" " --keep-order -g 1 last 3',
+    {IN_PIPE=>$in_case_unsorted}, {OUT=>"a 3\nA 5\nb 4\nB 6\n"}],
+  ['keep-order4', '-t" " --keep-order --header-out -g 1 count 1',
+    {IN_PIPE=>$in_case_unsorted},
+    {OUT=>"GroupBy(field-1) count(field-1)\na 2\nA 2\nb 1\nB 1\n"}],
+
+  # Test --emit-partial: the state of each operation (the number of values,
+  # integers as-is, strings in base64)
+  ['partial1', '-t" " -s -g 1 --emit-partial count 3 sum 3 max 3 first 2 unique 2',
+    {IN_PIPE=>$in_case_unsorted},
+    {OUT=>"A 2 2/7 2/5 2/WA== 2/WA==/eA==\nB 1 1/6 1/6 1/WQ== 1/WQ==\n" .
+          "a 2 2/4 2/3 2/WA== 2/WA==/eA==\nb 1 1/4 1/4 1/WQ== 1/WQ==\n"}],
+  # Test --merge-partial: the states of each group are combined,
+  # the groups printed in order of first appearance
+  ['partial2', '-t" " -g 1 --merge-partial count 3 sum 3 max 3 first 2 unique 2',
+    {IN_PIPE=>"A 2 2/7 2/5 2/WA== 2/WA==/eA==\nb 1 1/4 1/4 1/WQ== 1/WQ==\n" .
+              "A 1 1/-3 1/-3 1/eA== 1/eQ==\n"},
+    {OUT=>"A 3 4 5 X X,x,y\nb 1 4 4 Y Y\n"}],
+  ['partial3', '-t" " -s -g 1 --merge-partial mean 2 median 2',
+    {IN_PIPE=>"B 2/0x1p+2 1/0x1p+3\nA 1/0x1p+0 2/0x1p+1/0x1.8p+1\n" .
+              "A 2/0x1.4p+2 2/0x1p+0/0x1p+2\n"},
+    {OUT=>"A 2 2.5\nB 2 8\n"}],
 
   # Test Case-sensitivity, on sorted input (no 'sort' piping)
   # on both grouping and string operations